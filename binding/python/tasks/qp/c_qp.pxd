@@ -9,7 +9,9 @@ from sch.c_sch cimport *
 cimport tasks.c_tasks as c_tasks
 from libcpp.string cimport string
 from libcpp.vector cimport vector
+from libcpp.utility cimport pair
 from libcpp cimport bool
+from libcpp.memory cimport shared_ptr
 
 cdef extern from "<Tasks/QPContacts.h>" namespace "tasks::qp":
   cdef cppclass FrictionCone:
@@ -22,6 +24,7 @@ cdef extern from "<Tasks/QPContacts.h>" namespace "tasks::qp":
     ContactId(int, int, const string&, const string&, int)
     int r1Index
     int r2Index
+    # ContactBodyName convert to and is assigned from std::string
     string r1BodyName
     string r2BodyName
     int ambiguityId
@@ -86,6 +89,21 @@ cdef extern from "<Tasks/QPContacts.h>" namespace "tasks::qp":
     void computeNormalAccB(const vector[MultiBody]&, const vector[MultiBodyConfig]&)
     vector[MotionVecd] normalAccB(int) const
 
+cdef extern from "<Tasks/QPTrajectory.h>" namespace "tasks::qp":
+  cdef cppclass TrajectoryBuffer:
+    TrajectoryBuffer(double, MatrixXd, MatrixXd) except +
+    int dim() const
+    int nrSamples() const
+    double period() const
+    double duration() const
+    const MatrixXd& vel() const
+    const MatrixXd& accel() const
+    void eval(double, VectorXd&, VectorXd&) const
+
+  cdef cppclass TrajectoryPlayer:
+    bool loaded() const
+    double time() const
+
 cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
   cdef cppclass JointStiffness:
     JointStiffness()
@@ -115,17 +133,23 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     void updateNrVars(const vector[MultiBody]&, SolverData)
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
 
+  cdef cppclass ColumnSegments:
+    bool full()
+    const vector[pair[int, int]]& segments()
+
   cdef cppclass Equality:
     int maxEq()
     int nrEq()
     MatrixXd AEq()
     VectorXd bEq()
+    const ColumnSegments& columnsEq()
 
   cdef cppclass Inequality:
     int maxInEq()
     int nrInEq()
     MatrixXd AInEq()
     VectorXd bInEq()
+    const ColumnSegments& columnsInEq()
 
   cdef cppclass GenInequality:
     int maxGenInEq()
@@ -133,6 +157,7 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     MatrixXd AGenInEq()
     VectorXd LowerGenInEq()
     VectorXd UpperGenInEq()
+    const ColumnSegments& columnsGenInEq()
 
   cdef cppclass Bound:
     int beginVar()
@@ -220,6 +245,9 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     void jointsGains(const vector[MultiBody]&, vector[JointGains])
     void ptUpdate "update"(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
     VectorXd ptEval "eval"()
+    void trajectory(shared_ptr[TrajectoryBuffer], double) except +
+    void clearTrajectory()
+    const TrajectoryPlayer& trajectoryPlayer() const
 
   cdef cppclass CoMTask(HighLevelTask):
     CoMTask(const vector[MultiBody]&, int, const Vector3d&)
@@ -361,6 +389,9 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     void setGains(double, double)
     void refVel(const VectorXd&)
     void refAccel(const VectorXd&)
+    void trajectory(shared_ptr[TrajectoryBuffer], double) except +
+    void clearTrajectory()
+    const TrajectoryPlayer& trajectoryPlayer() const
 
     # SetPointTaskCommon
     VectorXd dimWeight() const
@@ -627,7 +658,6 @@ cdef extern from "<Tasks/QPConstr.h>" namespace "tasks::qp":
     void updatePoint(const int, const Vector2d&)
     void updatePoint(const int, const Vector2d&, const double)
     void updatePoint(const int, const Vector3d&)
-    void computeComponents(const MultiBody&, const MultiBodyConfig&, const SolverData&, const Vector2d&, const double, Jacobian&, const int, const PTransformd&, MatrixXd&, Vector2d&)
     void addToSolver(QPSolver &)
     void addToSolver(const vector[MultiBody]&, QPSolver &)
     void removeFromSolver(QPSolver &)
@@ -6,6 +6,7 @@ cimport tasks.qp.c_qp as c_qp
 
 from libcpp.vector cimport vector
 from libcpp cimport bool as cppbool
+from libcpp.memory cimport shared_ptr
 
 cdef class FrictionCone(object):
   cdef c_qp.FrictionCone impl
@@ -97,6 +98,9 @@ cdef class GazeTask(HighLevelTask):
 cdef class PositionBasedVisServoTask(HighLevelTask):
   cdef c_qp.PositionBasedVisServoTask * impl
 
+cdef class TrajectoryBuffer(object):
+  cdef shared_ptr[c_qp.TrajectoryBuffer] impl
+
 cdef class PostureTask(Task):
   cdef c_qp.PostureTask * impl
   cdef cppbool __own_impl
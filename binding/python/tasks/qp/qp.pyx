@@ -85,6 +85,8 @@ cdef class ContactId(object):
     def __get__(self):
       return self.impl.r1BodyName
     def __set__(self, value):
+      if isinstance(value, unicode):
+        value = value.encode(u'ascii')
       self.impl.r1BodyName = value
   property r2Index:
     def __get__(self):
@@ -95,6 +97,8 @@ cdef class ContactId(object):
     def __get__(self):
       return self.impl.r2BodyName
     def __set__(self, value):
+      if isinstance(value, unicode):
+        value = value.encode(u'ascii')
       self.impl.r2BodyName = value
   property ambiguityId:
     def __get__(self):
@@ -499,6 +503,13 @@ cdef class Constraint(object):
   def update(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs, SolverData sd):
     self.constraint_base.update(deref(mbs.v), deref(mbcs.v), sd.impl)
 
+# None for a nrVars wide matrix, else the list of (begin, size) column segments
+# stored one after the other in the constraint matrix
+cdef ColumnSegmentsFromC(const c_qp.ColumnSegments & cols):
+  if cols.full():
+    return None
+  return cols.segments()
+
 cdef class Equality(Constraint):
   def maxEq(self):
     return self.eq_base.maxEq()
@@ -508,6 +519,8 @@ cdef class Equality(Constraint):
     return MatrixXdFromC(self.eq_base.AEq())
   def bEq(self):
     return VectorXdFromC(self.eq_base.bEq())
+  def columnsEq(self):
+    return ColumnSegmentsFromC(self.eq_base.columnsEq())
 
 cdef class Inequality(Constraint):
   def maxInEq(self):
@@ -518,6 +531,8 @@ cdef class Inequality(Constraint):
     return MatrixXdFromC(self.ineq_base.AInEq())
   def bInEq(self):
     return VectorXdFromC(self.ineq_base.bInEq())
+  def columnsInEq(self):
+    return ColumnSegmentsFromC(self.ineq_base.columnsInEq())
 
 cdef class GenInequality(Constraint):
   def maxGenInEq(self):
@@ -530,6 +545,8 @@ cdef class GenInequality(Constraint):
     return VectorXdFromC(self.genineq_base.LowerGenInEq())
   def UpperGenInEq(self):
     return VectorXdFromC(self.genineq_base.UpperGenInEq())
+  def columnsGenInEq(self):
+    return ColumnSegmentsFromC(self.genineq_base.columnsGenInEq())
 
 cdef class Bound(Constraint):
   def beginVar(self):
@@ -726,6 +743,27 @@ cdef class PositionBasedVisServoTask(HighLevelTask):
   def error(self, PTransformd X_t_s):
     self.impl.error(deref(X_t_s.impl))
 
+cdef class TrajectoryBuffer(object):
+  def __cinit__(self, double period, MatrixXd vel, MatrixXd accel):
+    self.impl.reset(new c_qp.TrajectoryBuffer(period, vel.impl, accel.impl))
+  def dim(self):
+    return self.impl.get().dim()
+  def nrSamples(self):
+    return self.impl.get().nrSamples()
+  def period(self):
+    return self.impl.get().period()
+  def duration(self):
+    return self.impl.get().duration()
+  def vel(self):
+    return MatrixXdFromC(self.impl.get().vel())
+  def accel(self):
+    return MatrixXdFromC(self.impl.get().accel())
+  def eval(self, double t):
+    cdef VectorXd vel = VectorXd.Zero(self.impl.get().dim())
+    cdef VectorXd accel = VectorXd.Zero(self.impl.get().dim())
+    self.impl.get().eval(t, vel.impl, accel.impl)
+    return vel, accel
+
 cdef class PostureTask(Task):
   def __dealloc__(self):
     if self.__own_impl:
@@ -760,6 +798,17 @@ cdef class PostureTask(Task):
     self.impl.ptUpdate(deref(mbs.v), deref(mbcs.v), data.impl)
   def eval(self):
     return VectorXdFromC(self.impl.ptEval())
+  def trajectory(self, TrajectoryBuffer traj, double timeStep):
+    if traj is None:
+      self.impl.clearTrajectory()
+    else:
+      self.impl.trajectory(traj.impl, timeStep)
+  def clearTrajectory(self):
+    self.impl.clearTrajectory()
+  def trajectoryLoaded(self):
+    return self.impl.trajectoryPlayer().loaded()
+  def trajectoryTime(self):
+    return self.impl.trajectoryPlayer().time()
 
 cdef PostureTask PostureTaskFromPtr(c_qp.PostureTask * p):
     cdef PostureTask ret = PostureTask(None, 0, None, 0, 0, skip_alloc = True)
@@ -1239,6 +1288,17 @@ cdef class TrajectoryTask(Task):
     self.impl.refVel(vel.impl)
   def refAccel(self, VectorXd acc):
     self.impl.refAccel(acc.impl)
+  def trajectory(self, TrajectoryBuffer traj, double timeStep):
+    if traj is None:
+      self.impl.clearTrajectory()
+    else:
+      self.impl.trajectory(traj.impl, timeStep)
+  def clearTrajectory(self):
+    self.impl.clearTrajectory()
+  def trajectoryLoaded(self):
+    return self.impl.trajectoryPlayer().loaded()
+  def trajectoryTime(self):
+    return self.impl.trajectoryPlayer().time()
 
 cdef class TargetObjectiveTask(Task):
   def __dealloc__(self):
@@ -2112,9 +2172,6 @@ cdef class ImageConstr(Inequality):
       self.__v3updpt__(pointId, *args)
     else:
       raise TypeError("Wrong arguments passed to ImageConstr updatePoint")
-  # no binding on this function, shouldn't be used in the general case
-#  def computeComponents(...):
-#    self.impl.computeComponents(...)
   def __addToSolver(self, QPSolver solver):
     self.impl.addToSolver(deref(solver.impl))
   def __addToSolverMBS(self, MultiBodyVector mbs, QPSolver solver):
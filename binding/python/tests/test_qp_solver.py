@@ -153,6 +153,59 @@ class TestQPTask(unittest.TestCase):
         self.solver.removeTask(linVelocityTaskSp)
         self.assertEqual(self.solver.nrTasks(), 0)
 
+    def test_trajectory(self):
+        # v(t) = t^2 is a cubic so the Hermite interpolation must be exact
+        period = 0.1
+        vel = eigen.MatrixXd.Zero(3, 4)
+        accel = eigen.MatrixXd.Zero(3, 4)
+        for i in range(4):
+            t = i * period
+            for r in range(3):
+                vel.coeff(r, i, t * t)
+                accel.coeff(r, i, 2 * t)
+        traj = tasks.qp.TrajectoryBuffer(period, vel, accel)
+        self.assertEqual(traj.dim(), 3)
+        self.assertEqual(traj.nrSamples(), 4)
+        self.assertAlmostEqual(traj.duration(), 0.3, delta=1e-12)
+        v, a = traj.eval(0.25)
+        self.assertAlmostEqual(v[0], 0.25 * 0.25, delta=1e-12)
+        self.assertAlmostEqual(a[0], 0.5, delta=1e-12)
+
+        with self.assertRaises(Exception):
+            tasks.qp.TrajectoryBuffer(0, vel, accel)
+
+        posTask = tasks.qp.PositionTask(self.mbs, 0, "b3", eigen.Vector3d.Zero())
+        posTaskTraj = tasks.qp.TrajectoryTask(self.mbs, 0, posTask, 1, 1, 1)
+        postureTask = tasks.qp.PostureTask(self.mbs, 0, [[], [0], [0], [0]], 1, 1)
+        badTraj = tasks.qp.TrajectoryBuffer(
+            period, eigen.MatrixXd.Zero(2, 4), eigen.MatrixXd.Zero(2, 4)
+        )
+        with self.assertRaises(Exception):
+            posTaskTraj.trajectory(badTraj, 0.05)
+
+        posTaskTraj.trajectory(traj, 0.05)
+        postureTask.trajectory(traj, 0.05)
+        self.assertTrue(posTaskTraj.trajectoryLoaded())
+        self.assertTrue(postureTask.trajectoryLoaded())
+        self.solver.addTask(posTaskTraj)
+        self.solver.addTask(postureTask)
+        self.solver.updateTasksNrVars(self.mbs)
+
+        # the trajectories advance with the solver tick without any python call
+        for i in range(3):
+            self.assertTrue(self.solver.solve(self.mbs, self.mbcs))
+        self.assertAlmostEqual(posTaskTraj.trajectoryTime(), 0.1, delta=1e-12)
+        self.assertAlmostEqual(postureTask.trajectoryTime(), 0.1, delta=1e-12)
+
+        posTaskTraj.trajectory(None, 0.05)
+        postureTask.clearTrajectory()
+        self.assertFalse(posTaskTraj.trajectoryLoaded())
+        self.assertFalse(postureTask.trajectoryLoaded())
+
+        self.solver.removeTask(posTaskTraj)
+        self.solver.removeTask(postureTask)
+        self.assertEqual(self.solver.nrTasks(), 0)
+
 
 #
 #
@@ -661,6 +714,10 @@ class TestQPAutoColl(unittest.TestCase):
         solver.nrVars(mbs, [], [])
         solver.updateConstrSize()
 
+        # AInEq only store the robot alphaD columns
+        self.assertEqual(autoCollConstr.columnsInEq(), [(0, mbs[0].nrDof())])
+        self.assertEqual(autoCollConstr.AInEq().cols(), mbs[0].nrDof())
+
         solver.addTask(posTaskSp)
         self.assertEqual(solver.nrTasks(), 1)
 
@@ -0,0 +1,451 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+// associated header
+#include "ADMMQPSolver.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Tasks
+#include "GenQPUtils.h"
+#include "Tasks/QPSolver.h"
+
+namespace tasks
+{
+
+namespace qp
+{
+
+namespace
+{
+
+// KKT matrix regularization of the primal variables
+const double SIGMA = 1e-6;
+// over relaxation parameter
+const double ALPHA = 1.6;
+// rho of the equality lines relatively to the inequality lines rho
+const double RHO_EQ_SCALE = 1e3;
+const double RHO_MIN = 1e-6;
+const double RHO_MAX = 1e6;
+// rho is only adapted every RHO_UPDATE_INTERVAL iterations
+const int RHO_UPDATE_INTERVAL = 25;
+// the infeasibility is only checked every INFEASIBILITY_CHECK_INTERVAL
+// iterations to let the first iterations settle
+const int INFEASIBILITY_CHECK_INTERVAL = 25;
+// relative tolerance of the infeasibility certificates
+const double INFEASIBILITY_TOL = 1e-4;
+// iterates differences smaller than this norm are not certificates
+const double INFEASIBILITY_MIN_NORM = 1e-10;
+
+/// @return true if m1 and m2 store the same coefficients positions.
+bool samePattern(const Eigen::SparseMatrix<double> & m1, const Eigen::SparseMatrix<double> & m2)
+{
+  return m1.rows() == m2.rows() && m1.cols() == m2.cols() && m1.nonZeros() == m2.nonZeros()
+         && std::equal(m1.outerIndexPtr(), m1.outerIndexPtr() + m1.outerSize() + 1, m2.outerIndexPtr())
+         && std::equal(m1.innerIndexPtr(), m1.innerIndexPtr() + m1.nonZeros(), m2.innerIndexPtr());
+}
+
+template<typename Derived>
+double infNorm(const Eigen::MatrixBase<Derived> & v)
+{
+  return v.size() > 0 ? v.template lpNorm<Eigen::Infinity>() : 0.;
+}
+
+} // namespace
+
+ADMMQPSolver::ADMMQPSolver()
+: QTriplets_(), ATriplets_(), KTriplets_(), QFull_(), AFull_(), CFull_(), ALFull_(), AUFull_(), XLFull_(), XUFull_(),
+  Q_(), A_(), K_(), KPrev_(), C_(), L_(), U_(), XL_(), XU_(), kkt_(), x_(), z_(), y_(), rho_(), rhoInv_(), rhs_(),
+  sol_(), zRelax_(), Ax_(), Qx_(), ATy_(), xPrev_(), yPrev_(), dx_(), dy_(), Adx_(), Qdx_(), ATdy_(), XFull_(),
+  nrALines_(0), rhoScalar_(0.1), iter_(0), primalRes_(0.), dualRes_(0.), status_(Status::MaxIterReached)
+{
+}
+
+void ADMMQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+  int maxALines = nrEq + nrInEq + nrGenInEq;
+  ALFull_.resize(maxALines);
+  AUFull_.resize(maxALines);
+
+  XLFull_.resize(nrVars);
+  XUFull_.resize(nrVars);
+
+  CFull_.resize(nrVars);
+
+  if(dependencies_.size())
+  {
+    int reducedNrVars = nrVars - static_cast<int>(dependencies_.size());
+    XL_.resize(reducedNrVars);
+    XU_.resize(reducedNrVars);
+    XFull_.resize(nrVars);
+  }
+}
+
+void ADMMQPSolver::updateMatrix(const std::vector<Task *> & tasks,
+                                const std::vector<Equality *> & eqConstr,
+                                const std::vector<Inequality *> & inEqConstr,
+                                const std::vector<GenInequality *> & genInEqConstr,
+                                const std::vector<Bound *> & boundConstr)
+{
+  const int nrVars = int(XLFull_.rows());
+  const double inf = std::numeric_limits<double>::infinity();
+
+  QTriplets_.clear();
+  ATriplets_.clear();
+  CFull_.setZero();
+  XLFull_.fill(-inf);
+  XUFull_.fill(inf);
+
+  fillQCTriplets(tasks, nrVars, QTriplets_, CFull_);
+
+  nrALines_ = 0;
+  for(Equality * e : eqConstr)
+  {
+    int nrConstr = e->nrEq();
+    fillLinesTriplets(e->AEq(), e->columnsEq(), nrConstr, nrVars, nrALines_, ATriplets_);
+    ALFull_.segment(nrALines_, nrConstr) = e->bEq().head(nrConstr);
+    AUFull_.segment(nrALines_, nrConstr) = e->bEq().head(nrConstr);
+    nrALines_ += nrConstr;
+  }
+  for(Inequality * ie : inEqConstr)
+  {
+    int nrConstr = ie->nrInEq();
+    fillLinesTriplets(ie->AInEq(), ie->columnsInEq(), nrConstr, nrVars, nrALines_, ATriplets_);
+    ALFull_.segment(nrALines_, nrConstr).fill(-inf);
+    AUFull_.segment(nrALines_, nrConstr) = ie->bInEq().head(nrConstr);
+    nrALines_ += nrConstr;
+  }
+  for(GenInequality * gie : genInEqConstr)
+  {
+    int nrConstr = gie->nrGenInEq();
+    fillLinesTriplets(gie->AGenInEq(), gie->columnsGenInEq(), nrConstr, nrVars, nrALines_, ATriplets_);
+    ALFull_.segment(nrALines_, nrConstr) = gie->LowerGenInEq().head(nrConstr);
+    AUFull_.segment(nrALines_, nrConstr) = gie->UpperGenInEq().head(nrConstr);
+    nrALines_ += nrConstr;
+  }
+
+  fillBound(boundConstr, XLFull_, XUFull_);
+
+  if(dependencies_.size())
+  {
+    QFull_.resize(nrVars, nrVars);
+    QFull_.setFromTriplets(QTriplets_.begin(), QTriplets_.end());
+    Q_ = multipliers_.transpose() * QFull_ * multipliers_;
+    C_.noalias() = multipliers_.transpose() * CFull_;
+
+    AFull_.resize(nrALines_, nrVars);
+    AFull_.setFromTriplets(ATriplets_.begin(), ATriplets_.end());
+    Eigen::SparseMatrix<double> A = AFull_ * multipliers_;
+    ATriplets_.clear();
+    for(int c = 0; c < A.outerSize(); ++c)
+    {
+      for(Eigen::SparseMatrix<double>::InnerIterator it(A, c); it; ++it)
+      {
+        ATriplets_.emplace_back(int(it.row()), int(it.col()), it.value());
+      }
+    }
+
+    XL_.fill(-inf);
+    XU_.fill(inf);
+    reduceBound(XLFull_, XL_, XUFull_, XU_, fullToReduced_, reducedToFull_, dependencies_);
+  }
+  else
+  {
+    Q_.resize(nrVars, nrVars);
+    Q_.setFromTriplets(QTriplets_.begin(), QTriplets_.end());
+    C_ = CFull_;
+    XL_ = XLFull_;
+    XU_ = XUFull_;
+  }
+
+  // bounds are added as identity lines after the constraints lines
+  const int solverNrVars = int(Q_.rows());
+  int nrLines = nrALines_;
+  for(int i = 0; i < solverNrVars; ++i)
+  {
+    if(XL_(i) != -inf || XU_(i) != inf) { ATriplets_.emplace_back(nrLines++, i, 1.); }
+  }
+
+  A_.resize(nrLines, solverNrVars);
+  A_.setFromTriplets(ATriplets_.begin(), ATriplets_.end());
+  L_.resize(nrLines);
+  U_.resize(nrLines);
+  L_.head(nrALines_) = ALFull_.head(nrALines_);
+  U_.head(nrALines_) = AUFull_.head(nrALines_);
+  nrLines = nrALines_;
+  for(int i = 0; i < solverNrVars; ++i)
+  {
+    if(XL_(i) != -inf || XU_(i) != inf)
+    {
+      L_(nrLines) = XL_(i);
+      U_(nrLines) = XU_(i);
+      ++nrLines;
+    }
+  }
+}
+
+bool ADMMQPSolver::factorize()
+{
+  const int nrVars = int(Q_.rows());
+  for(Eigen::Index i = 0; i < rho_.size(); ++i) { K_.coeffRef(nrVars + i, nrVars + i) = -rhoInv_(i); }
+  kkt_.factorize(K_);
+  return kkt_.info() == Eigen::Success;
+}
+
+bool ADMMQPSolver::primalInfeasible()
+{
+  const double dyNorm = infNorm(dy_);
+  if(dyNorm < INFEASIBILITY_MIN_NORM) { return false; }
+  const double tol = INFEASIBILITY_TOL * dyNorm;
+
+  ATdy_.noalias() = A_.transpose() * dy_;
+  if(infNorm(ATdy_) > tol) { return false; }
+
+  // an infinite bound can't support a non negligible multiplier
+  double support = 0.;
+  for(Eigen::Index i = 0; i < dy_.size(); ++i)
+  {
+    if(dy_(i) > 0.)
+    {
+      if(U_(i) != std::numeric_limits<double>::infinity()) { support += U_(i) * dy_(i); }
+      else if(dy_(i) > tol) { return false; }
+    }
+    else if(dy_(i) < 0.)
+    {
+      if(L_(i) != -std::numeric_limits<double>::infinity()) { support += L_(i) * dy_(i); }
+      else if(dy_(i) < -tol) { return false; }
+    }
+  }
+  return support < -tol;
+}
+
+bool ADMMQPSolver::dualInfeasible()
+{
+  const double dxNorm = infNorm(dx_);
+  if(dxNorm < INFEASIBILITY_MIN_NORM) { return false; }
+  const double tol = INFEASIBILITY_TOL * dxNorm;
+
+  if(C_.dot(dx_) >= -tol) { return false; }
+  Qdx_.noalias() = Q_ * dx_;
+  if(infNorm(Qdx_) > tol) { return false; }
+
+  // A dx must stay in the recession cone of the bounds
+  Adx_.noalias() = A_ * dx_;
+  for(Eigen::Index i = 0; i < Adx_.size(); ++i)
+  {
+    if(U_(i) != std::numeric_limits<double>::infinity() && Adx_(i) > tol) { return false; }
+    if(L_(i) != -std::numeric_limits<double>::infinity() && Adx_(i) < -tol) { return false; }
+  }
+  return true;
+}
+
+bool ADMMQPSolver::solve()
+{
+  const int nrVars = int(Q_.rows());
+  const int nrLines = int(A_.rows());
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // warm start from the previous solution when the problem size allow it,
+  // the iterates of an infeasible problem diverge and are not reused
+  const bool diverged = status_ == Status::PrimalInfeasible || status_ == Status::DualInfeasible;
+  status_ = Status::MaxIterReached;
+  if(x_.size() != nrVars || diverged)
+  {
+    x_.setZero(nrVars);
+    y_.resize(0);
+  }
+  if(y_.size() != nrLines) { y_.setZero(nrLines); }
+  z_.noalias() = A_ * x_;
+  z_ = z_.cwiseMax(L_).cwiseMin(U_);
+
+  auto setRho = [this, nrLines, inf]() {
+    rho_.resize(nrLines);
+    for(int i = 0; i < nrLines; ++i)
+    {
+      if(L_(i) == U_(i)) { rho_(i) = RHO_EQ_SCALE * rhoScalar_; }
+      else if(L_(i) == -inf && U_(i) == inf) { rho_(i) = RHO_MIN; }
+      else { rho_(i) = rhoScalar_; }
+    }
+    rhoInv_ = rho_.cwiseInverse();
+  };
+  setRho();
+
+  // lower part of the KKT matrix, the rho diagonal is set by factorize
+  KTriplets_.clear();
+  KTriplets_.reserve(static_cast<size_t>(Q_.nonZeros() + A_.nonZeros() + nrVars + nrLines));
+  for(int c = 0; c < Q_.outerSize(); ++c)
+  {
+    for(Eigen::SparseMatrix<double>::InnerIterator it(Q_, c); it; ++it)
+    {
+      if(it.row() >= it.col()) { KTriplets_.emplace_back(int(it.row()), int(it.col()), it.value()); }
+    }
+  }
+  for(int i = 0; i < nrVars; ++i) { KTriplets_.emplace_back(i, i, SIGMA); }
+  for(int c = 0; c < A_.outerSize(); ++c)
+  {
+    for(Eigen::SparseMatrix<double>::InnerIterator it(A_, c); it; ++it)
+    {
+      KTriplets_.emplace_back(nrVars + int(it.row()), int(it.col()), it.value());
+    }
+  }
+  for(int i = 0; i < nrLines; ++i) { KTriplets_.emplace_back(nrVars + i, nrVars + i, -1.); }
+  K_.swap(KPrev_);
+  K_.resize(nrVars + nrLines, nrVars + nrLines);
+  K_.setFromTriplets(KTriplets_.begin(), KTriplets_.end());
+  // the symbolic analysis is only done again when the KKT pattern change,
+  // fillQCTriplets and fillLinesTriplets keep the structural zeros for that
+  if(K_.size() == 0 || !samePattern(K_, KPrev_)) { kkt_.analyzePattern(K_); }
+  iter_ = 0;
+  if(!factorize())
+  {
+    status_ = Status::FactorizationFailed;
+    return false;
+  }
+
+  rhs_.resize(nrVars + nrLines);
+  while(iter_ < admmMaxIter_)
+  {
+    const bool checkInfeasibility = (iter_ + 1) % INFEASIBILITY_CHECK_INTERVAL == 0;
+    if(checkInfeasibility)
+    {
+      xPrev_ = x_;
+      yPrev_ = y_;
+    }
+    rhs_.head(nrVars) = SIGMA * x_ - C_;
+    rhs_.tail(nrLines) = z_ - rhoInv_.cwiseProduct(y_);
+    sol_ = kkt_.solve(rhs_);
+
+    // relaxed z tilde
+    zRelax_ = z_ + rhoInv_.cwiseProduct(sol_.tail(nrLines) - y_);
+    zRelax_ = ALPHA * zRelax_ + (1. - ALPHA) * z_;
+    x_ = ALPHA * sol_.head(nrVars) + (1. - ALPHA) * x_;
+    z_ = (zRelax_ + rhoInv_.cwiseProduct(y_)).cwiseMax(L_).cwiseMin(U_);
+    y_ += rho_.cwiseProduct(zRelax_ - z_);
+    ++iter_;
+
+    Ax_.noalias() = A_ * x_;
+    Qx_.noalias() = Q_ * x_;
+    ATy_.noalias() = A_.transpose() * y_;
+    primalRes_ = infNorm(Ax_ - z_);
+    dualRes_ = infNorm(Qx_ + C_ + ATy_);
+    const double primalScale = std::max(infNorm(Ax_), infNorm(z_));
+    const double dualScale = std::max({infNorm(Qx_), infNorm(ATy_), infNorm(C_)});
+    if(primalRes_ <= admmAbsTolerance_ + admmRelTolerance_ * primalScale
+       && dualRes_ <= admmAbsTolerance_ + admmRelTolerance_ * dualScale)
+    {
+      status_ = Status::Solved;
+      break;
+    }
+
+    if(checkInfeasibility)
+    {
+      dx_ = x_ - xPrev_;
+      dy_ = y_ - yPrev_;
+      if(primalInfeasible())
+      {
+        status_ = Status::PrimalInfeasible;
+        break;
+      }
+      if(dualInfeasible())
+      {
+        status_ = Status::DualInfeasible;
+        break;
+      }
+    }
+
+    // balance the normalized primal and dual residuals
+    if(iter_ % RHO_UPDATE_INTERVAL == 0)
+    {
+      const double eps = 1e-10;
+      double ratio = std::sqrt((primalRes_ / (primalScale + eps)) / (dualRes_ / (dualScale + eps) + eps));
+      if(ratio > 5. || ratio < 0.2)
+      {
+        rhoScalar_ = std::min(std::max(rhoScalar_ * ratio, RHO_MIN), RHO_MAX);
+        setRho();
+        if(!factorize())
+        {
+          status_ = Status::FactorizationFailed;
+          return false;
+        }
+      }
+    }
+  }
+
+  if(dependencies_.size()) { expandResult(x_, XFull_, multipliers_); }
+  return status_ == Status::Solved;
+}
+
+const Eigen::VectorXd & ADMMQPSolver::result() const
+{
+  if(dependencies_.size()) { return XFull_; }
+  return x_;
+}
+
+std::ostream & ADMMQPSolver::errorMsg(const std::vector<rbd::MultiBody> & mbs,
+                                      const std::vector<Task *> & /* tasks */,
+                                      const std::vector<Equality *> & eqConstr,
+                                      const std::vector<Inequality *> & inEqConstr,
+                                      const std::vector<GenInequality *> & genInEqConstr,
+                                      const std::vector<Bound *> & /* boundConstr */,
+                                      std::ostream & out) const
+{
+  out << "admm output: ";
+  switch(status_)
+  {
+    case Status::Solved:
+      out << "converged";
+      break;
+    case Status::MaxIterReached:
+      out << "not converged";
+      break;
+    case Status::PrimalInfeasible:
+      out << "primal infeasible";
+      break;
+    case Status::DualInfeasible:
+      out << "dual infeasible (unbounded)";
+      break;
+    case Status::FactorizationFailed:
+      out << "KKT factorization failed";
+      break;
+  }
+  out << " after " << iter_ << " iterations, primal residual: " << primalRes_ << ", dual residual: " << dualRes_
+      << std::endl;
+
+  // report the most violated constraint line
+  int worstLine = -1;
+  double worstViolation = admmAbsTolerance_;
+  for(int i = 0; i < nrALines_ && i < Ax_.size(); ++i)
+  {
+    double violation = std::max(L_(i) - Ax_(i), Ax_(i) - U_(i));
+    if(violation > worstViolation)
+    {
+      worstViolation = violation;
+      worstLine = i;
+    }
+  }
+  if(worstLine != -1)
+  {
+    int start = 0;
+    int end = 0;
+
+    constrErrorMsg(mbs, result(), worstLine, eqConstr, start, end, out);
+    constrErrorMsg(mbs, result(), worstLine, inEqConstr, start, end, out);
+    constrErrorMsg(mbs, result(), worstLine, genInEqConstr, start, end, out);
+    out << std::endl;
+  }
+  return out;
+}
+
+std::string ADMMQPSolver::name() const
+{
+  return "ADMM";
+}
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+#pragma once
+
+// includes
+// std
+#include <vector>
+
+// Eigen
+#include <Eigen/SparseCholesky>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+
+namespace tasks
+{
+
+namespace qp
+{
+
+/**
+ * GenQPSolver interface implementation with a sparse ADMM QP solver.
+ * The problem is written \f$ L \leq A x \leq U \f$, the bounds being identity
+ * lines of \f$ A \f$, and solved by the operator splitting iterations:
+ * \f{align}
+ * \begin{bmatrix} Q + \sigma I & A^T \\ A & -\rho^{-1} \end{bmatrix}
+ * \begin{bmatrix} \tilde{x} \\ \nu \end{bmatrix} & =
+ * \begin{bmatrix} \sigma x - c \\ z - \rho^{-1} y \end{bmatrix} \\
+ * \tilde{z} & = z + \rho^{-1} (\nu - y) \\
+ * x & \leftarrow \alpha \tilde{x} + (1 - \alpha) x \\
+ * z & \leftarrow \Pi_{[L, U]}(\alpha \tilde{z} + (1 - \alpha) z + \rho^{-1} y) \\
+ * y & \leftarrow y + \rho (\alpha \tilde{z} + (1 - \alpha) z - z)
+ * \f}
+ * The quasi-definite KKT matrix is factorized by a sparse LDLT, its cost
+ * only depend on the non zero coefficients of \f$ Q \f$ and \f$ A \f$.
+ * Its symbolic analysis is only done again when the KKT pattern change.
+ * The previous primal and dual solutions are used as warm start.
+ * The iterations stop early when the differences of two successive iterates
+ * \f$ \delta y \f$ or \f$ \delta x \f$ certify that the problem is primal
+ * or dual infeasible.
+ * The tolerances and the iterations limit are set by
+ * GenQPSolver::admmParameters.
+ */
+class TASKS_DLLAPI ADMMQPSolver : public GenQPSolver
+{
+public:
+  ADMMQPSolver();
+
+  virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
+  virtual void updateMatrix(const std::vector<Task *> & tasks,
+                            const std::vector<Equality *> & eqConstr,
+                            const std::vector<Inequality *> & inEqConstr,
+                            const std::vector<GenInequality *> & genInEqConstr,
+                            const std::vector<Bound *> & boundConstr) override;
+  virtual bool solve() override;
+  virtual const Eigen::VectorXd & result() const override;
+  virtual std::ostream & errorMsg(const std::vector<rbd::MultiBody> & mbs,
+                                  const std::vector<Task *> & tasks,
+                                  const std::vector<Equality *> & eqConstr,
+                                  const std::vector<Inequality *> & inEqConstr,
+                                  const std::vector<GenInequality *> & genInEqConstr,
+                                  const std::vector<Bound *> & boundConstr,
+                                  std::ostream & out) const override;
+  std::string name() const override;
+  int nrIterations() const override { return iter_; }
+
+private:
+  enum class Status
+  {
+    Solved,
+    MaxIterReached,
+    PrimalInfeasible,
+    DualInfeasible,
+    FactorizationFailed
+  };
+
+private:
+  /// Update the KKT matrix \f$ \rho \f$ diagonal and factorize it.
+  bool factorize();
+  /// @return true if \f$ A^T \delta y = 0 \f$ and \f$ U^T \delta y^+ + L^T \delta y^- < 0 \f$.
+  bool primalInfeasible();
+  /// @return true if \f$ Q \delta x = 0 \f$, \f$ c^T \delta x < 0 \f$ and \f$ A \delta x \f$ stays in the bounds.
+  bool dualInfeasible();
+
+private:
+  std::vector<Eigen::Triplet<double>> QTriplets_, ATriplets_, KTriplets_;
+
+  Eigen::SparseMatrix<double> QFull_, AFull_;
+  Eigen::VectorXd CFull_, ALFull_, AUFull_, XLFull_, XUFull_;
+
+  Eigen::SparseMatrix<double> Q_, A_, K_, KPrev_;
+  Eigen::VectorXd C_, L_, U_, XL_, XU_;
+
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> kkt_;
+
+  // x primal solution, z = A x and y dual solution
+  Eigen::VectorXd x_, z_, y_, rho_, rhoInv_;
+  Eigen::VectorXd rhs_, sol_, zRelax_, Ax_, Qx_, ATy_;
+  // infeasibility certificates workspace
+  Eigen::VectorXd xPrev_, yPrev_, dx_, dy_, Adx_, Qdx_, ATdy_;
+  Eigen::VectorXd XFull_;
+
+  int nrALines_;
+  double rhoScalar_;
+  int iter_;
+  double primalRes_, dualRes_;
+  Status status_;
+};
+
+} // namespace qp
+
+} // namespace tasks
@@ -10,6 +10,7 @@
 #include <map>
 
 // Tasks
+#include "ADMMQPSolver.h"
 #include "QLDQPSolver.h"
 
 #ifdef LSSOL_SOLVER_FOUND
@@ -38,7 +39,8 @@ static const std::map<std::string, std::function<GenQPSolver *(void)>> qpFactory
 #ifdef LSSOL_SOLVER_FOUND
     {"LSSOL", allocateQP<LSSOLQPSolver>},
 #endif
-    {"QLD", allocateQP<QLDQPSolver>}};
+    {"QLD", allocateQP<QLDQPSolver>},
+    {"ADMM", allocateQP<ADMMQPSolver>}};
 
 GenQPSolver * createQPSolver(const std::string & name)
 {
@@ -6,10 +6,13 @@
 
 // includes
 // std
+#include <limits>
+#include <utility>
 #include <vector>
 
 // Eigen
 #include <Eigen/Core>
+#include <Eigen/QR>
 #include <Eigen/Sparse>
 
 // Tasks
@@ -36,6 +39,27 @@ inline void fillQC(const std::vector<Task *> & tasks, int nrVars, Eigen::MatrixX
     const Eigen::VectorXd & Ci = tasks[i]->C();
     std::pair<int, int> b = tasks[i]->begin();
 
+    if(tasks[i]->structure() == Task::QStructure::Diagonal)
+    {
+      int r = static_cast<int>(Qi.rows());
+      Q.block(b.first, b.second, r, r).diagonal() += tasks[i]->weight() * Qi.diagonal();
+      C.segment(b.first, r) += tasks[i]->weight() * Ci;
+      continue;
+    }
+
+    const std::vector<int> & vars = tasks[i]->nonZeroVars();
+    if(!vars.empty())
+    {
+      // only add the non zero block
+      const double w = tasks[i]->weight();
+      for(int c : vars)
+      {
+        for(int r : vars) { Q(b.first + r, b.second + c) += w * Qi(r, c); }
+        C(b.first + c) += w * Ci(c);
+      }
+      continue;
+    }
+
     int r = static_cast<int>(Qi.rows());
     int c = static_cast<int>(Qi.cols());
 
@@ -85,6 +109,48 @@ inline void reduceQC(const Eigen::MatrixXd & QFull,
   C.noalias() = M.transpose() * CFull;
 }
 
+/**
+ * Copy the nrLines first lines of a constraint matrix Ai in A starting at line ALine.
+ * When Ai only store some column segments they are scattered in A, the other
+ * columns of A are left untouched (A is set to zero before being filled).
+ */
+inline void fillLines(const Eigen::MatrixXd & Ai,
+                      const ColumnSegments & cols,
+                      int nrLines,
+                      int nrVars,
+                      int ALine,
+                      Eigen::MatrixXd & A,
+                      double sign = 1.)
+{
+  if(cols.full())
+  {
+    A.block(ALine, 0, nrLines, nrVars) = sign * Ai.block(0, 0, nrLines, nrVars);
+    return;
+  }
+
+  int col = 0;
+  for(const std::pair<int, int> & c : cols)
+  {
+    A.block(ALine, c.first, nrLines, c.second) = sign * Ai.block(0, col, nrLines, c.second);
+    col += c.second;
+  }
+}
+
+/// Compute \f$ A_i(line) x \f$ when Ai only store some column segments.
+inline double lineProduct(const Eigen::MatrixXd & Ai, const ColumnSegments & cols, int line, const Eigen::VectorXd & x)
+{
+  if(cols.full()) { return Ai.row(line).dot(x); }
+
+  double res = 0.;
+  int col = 0;
+  for(const std::pair<int, int> & c : cols)
+  {
+    res += Ai.block(line, col, 1, c.second).row(0).dot(x.segment(c.first, c.second));
+    col += c.second;
+  }
+  return res;
+}
+
 // general qp form
 
 /**
@@ -106,7 +172,7 @@ inline int fillEq(const std::vector<Equality *> & eq,
     const Eigen::MatrixXd & Ai = eq[i]->AEq();
     const Eigen::VectorXd & bi = eq[i]->bEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
+    fillLines(Ai, eq[i]->columnsEq(), nrConstr, nrVars, nrALines, A);
     AL.segment(nrALines, nrConstr) = bi.head(nrConstr);
     AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
@@ -135,7 +201,7 @@ inline int fillInEq(const std::vector<Inequality *> & inEq,
     const Eigen::MatrixXd & Ai = inEq[i]->AInEq();
     const Eigen::VectorXd & bi = inEq[i]->bInEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
+    fillLines(Ai, inEq[i]->columnsInEq(), nrConstr, nrVars, nrALines, A);
     AL.segment(nrALines, nrConstr).fill(-std::numeric_limits<double>::infinity());
     AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
@@ -165,7 +231,7 @@ inline int fillGenInEq(const std::vector<GenInequality *> & genInEq,
     const Eigen::VectorXd & ALi = genInEq[i]->LowerGenInEq();
     const Eigen::VectorXd & AUi = genInEq[i]->UpperGenInEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
+    fillLines(Ai, genInEq[i]->columnsGenInEq(), nrConstr, nrVars, nrALines, A);
     AL.segment(nrALines, nrConstr) = ALi.head(nrConstr);
     AU.segment(nrALines, nrConstr) = AUi.head(nrConstr);
 
@@ -191,7 +257,7 @@ inline int fillEq(const std::vector<Equality *> & eq, int nrVars, int nrALines,
     const Eigen::MatrixXd & Ai = eq[i]->AEq();
     const Eigen::VectorXd & bi = eq[i]->bEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
+    fillLines(Ai, eq[i]->columnsEq(), nrConstr, nrVars, nrALines, A);
     b.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
     nrALines += nrConstr;
@@ -218,7 +284,7 @@ inline int fillInEq(const std::vector<Inequality *> & inEq,
     const Eigen::MatrixXd & Ai = inEq[i]->AInEq();
     const Eigen::VectorXd & bi = inEq[i]->bInEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
+    fillLines(Ai, inEq[i]->columnsInEq(), nrConstr, nrVars, nrALines, A);
     b.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
     nrALines += nrConstr;
@@ -228,15 +294,40 @@ inline int fillInEq(const std::vector<Inequality *> & inEq,
 }
 
 /**
- * Fill the \f$ A \f$ matrix and the \f$ b \f$ vectors
- * based on the general inequality constaint list.
+ * Fill the \f$ A_{eq} \f$, \f$ A_{ineq} \f$ matrices and the \f$ b_{eq} \f$,
+ * \f$ b_{ineq} \f$ vectors based on the general inequality constaint list.
+ * Lines with \f$ L = U \f$ are added as one equality line, other lines are
+ * added as \f$ -A x \leq -L \f$ and \f$ A x \leq U \f$ inequality lines
+ * only when the corresponding bound is finite.
+ * Aeq and Aineq must have nrGenInEq more lines and 2 nrGenInEq more lines
+ * than the other constraints.
+ * @return Pair of the new number of equality and inequality lines.
  */
-inline int fillGenInEq(const std::vector<GenInequality *> & genInEq,
-                       int nrVars,
-                       int nrALines,
-                       Eigen::MatrixXd & A,
-                       Eigen::VectorXd & b)
+inline std::pair<int, int> fillGenInEq(const std::vector<GenInequality *> & genInEq,
+                                       int nrVars,
+                                       int nrAeqLines,
+                                       Eigen::MatrixXd & Aeq,
+                                       Eigen::VectorXd & beq,
+                                       int nrAineqLines,
+                                       Eigen::MatrixXd & Aineq,
+                                       Eigen::VectorXd & bineq)
 {
+  auto fillLine = [nrVars](const Eigen::MatrixXd & Ai, const ColumnSegments & cols, int line, int ALine,
+                           Eigen::MatrixXd & A, double sign) {
+    if(cols.full())
+    {
+      A.row(ALine).head(nrVars) = sign * Ai.row(line).head(nrVars);
+      return;
+    }
+
+    int col = 0;
+    for(const std::pair<int, int> & c : cols)
+    {
+      A.row(ALine).segment(c.first, c.second) = sign * Ai.row(line).segment(col, c.second);
+      col += c.second;
+    }
+  };
+
   for(std::size_t i = 0; i < genInEq.size(); ++i)
   {
     // ineq constraint can return a matrix with more line
@@ -245,19 +336,130 @@ inline int fillGenInEq(const std::vector<GenInequality *> & genInEq,
     const Eigen::MatrixXd & Ai = genInEq[i]->AGenInEq();
     const Eigen::VectorXd & ALi = genInEq[i]->LowerGenInEq();
     const Eigen::VectorXd & AUi = genInEq[i]->UpperGenInEq();
+    const ColumnSegments & cols = genInEq[i]->columnsGenInEq();
 
-    A.block(nrALines, 0, nrConstr, nrVars) = -Ai.block(0, 0, nrConstr, nrVars);
-    b.segment(nrALines, nrConstr) = -ALi.head(nrConstr);
+    for(int line = 0; line < nrConstr; ++line)
+    {
+      if(ALi(line) == AUi(line))
+      {
+        fillLine(Ai, cols, line, nrAeqLines, Aeq, 1.);
+        beq(nrAeqLines) = AUi(line);
+        ++nrAeqLines;
+        continue;
+      }
 
-    nrALines += nrConstr;
+      if(ALi(line) != -std::numeric_limits<double>::infinity())
+      {
+        fillLine(Ai, cols, line, nrAineqLines, Aineq, -1.);
+        bineq(nrAineqLines) = -ALi(line);
+        ++nrAineqLines;
+      }
 
-    A.block(nrALines, 0, nrConstr, nrVars) = Ai.block(0, 0, nrConstr, nrVars);
-    b.segment(nrALines, nrConstr) = AUi.head(nrConstr);
+      if(AUi(line) != std::numeric_limits<double>::infinity())
+      {
+        fillLine(Ai, cols, line, nrAineqLines, Aineq, 1.);
+        bineq(nrAineqLines) = AUi(line);
+        ++nrAineqLines;
+      }
+    }
+  }
 
-    nrALines += nrConstr;
+  return {nrAeqLines, nrAineqLines};
+}
+
+// sparse qp form
+
+/**
+ * Fill the \f$ Q \f$ triplets and the \f$ c \f$ vector based on the task
+ * list.
+ * All the coefficients of the task structure are stored, even the zero ones,
+ * so the \f$ Q \f$ pattern only change with the tasks structure.
+ * The diagonal is modified like in fillQC, each diagonal coefficient having
+ * a triplet.
+ */
+inline void fillQCTriplets(const std::vector<Task *> & tasks,
+                           int nrVars,
+                           std::vector<Eigen::Triplet<double>> & Q,
+                           Eigen::VectorXd & C)
+{
+  Eigen::VectorXd diag = Eigen::VectorXd::Zero(nrVars);
+  auto add = [&Q, &diag](int r, int c, double v) {
+    Q.emplace_back(r, c, v);
+    if(r == c) { diag(r) += v; }
+  };
+
+  for(std::size_t i = 0; i < tasks.size(); ++i)
+  {
+    const Eigen::MatrixXd & Qi = tasks[i]->Q();
+    const Eigen::VectorXd & Ci = tasks[i]->C();
+    std::pair<int, int> b = tasks[i]->begin();
+    const double w = tasks[i]->weight();
+    int r = static_cast<int>(Qi.rows());
+
+    if(tasks[i]->structure() == Task::QStructure::Diagonal)
+    {
+      for(int k = 0; k < r; ++k) { add(b.first + k, b.second + k, w * Qi(k, k)); }
+      C.segment(b.first, r) += w * Ci;
+      continue;
+    }
+
+    const std::vector<int> & vars = tasks[i]->nonZeroVars();
+    if(!vars.empty())
+    {
+      for(int c : vars)
+      {
+        for(int l : vars) { add(b.first + l, b.second + c, w * Qi(l, c)); }
+        C(b.first + c) += w * Ci(c);
+      }
+      continue;
+    }
+
+    int c = static_cast<int>(Qi.cols());
+    for(int k = 0; k < c; ++k)
+    {
+      for(int l = 0; l < r; ++l) { add(b.first + l, b.second + k, w * Qi(l, k)); }
+    }
+    C.segment(b.first, r) += w * Ci;
   }
 
-  return nrALines;
+  for(int i = 0; i < nrVars; ++i) { Q.emplace_back(i, i, std::abs(diag(i)) < DIAG_CONSTANT ? DIAG_CONSTANT : 0.); }
+}
+
+/**
+ * Append the coefficients of the nrLines first lines of a constraint matrix Ai
+ * to the A triplets starting at line ALine.
+ * The zero coefficients of the cols segments are also stored so the A pattern
+ * only change with the number of lines and the column segments.
+ */
+inline void fillLinesTriplets(const Eigen::MatrixXd & Ai,
+                              const ColumnSegments & cols,
+                              int nrLines,
+                              int nrVars,
+                              int ALine,
+                              std::vector<Eigen::Triplet<double>> & A)
+{
+  auto fillSegment = [&Ai, nrLines, ALine, &A](int AiCol, int ACol, int size) {
+    for(int c = 0; c < size; ++c)
+    {
+      for(int l = 0; l < nrLines; ++l)
+      {
+        A.emplace_back(ALine + l, ACol + c, Ai(l, AiCol + c));
+      }
+    }
+  };
+
+  if(cols.full())
+  {
+    fillSegment(0, 0, nrVars);
+    return;
+  }
+
+  int col = 0;
+  for(const std::pair<int, int> & c : cols)
+  {
+    fillSegment(col, c.first, c.second);
+    col += c.second;
+  }
 }
 
 /**
@@ -338,6 +540,124 @@ inline void reduceBound(const Eigen::VectorXd & XLFull,
   }
 }
 
+/**
+ * Parametrize the solutions of \f$ A_{eq} x = b_{eq} \f$ as \f$ x = x_0 + Z y \f$
+ * with \f$ Z \f$ an orthonormal basis of the \f$ A_{eq} \f$ null space.
+ * Use a column pivoting QR decomposition of \f$ A_{eq}^T \f$, redundant
+ * equality lines are ignored.
+ * @param qr Decomposition workspace.
+ * @param Q Workspace to store the QR orthogonal matrix.
+ * @param tol Tolerance on \f$ \| A_{eq} x_0 - b_{eq} \| \f$ relative to
+ * \f$ 1 + \| b_{eq} \| \f$.
+ * @return Rank of \f$ A_{eq} \f$ or -1 if the redundant lines are
+ * inconsistent and \f$ x_0 \f$ is not a solution.
+ */
+template<typename MatrixType, typename VectorType>
+inline int nullSpaceParametrization(const MatrixType & Aeq,
+                                    const VectorType & beq,
+                                    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> & qr,
+                                    Eigen::MatrixXd & Q,
+                                    Eigen::MatrixXd & Z,
+                                    Eigen::VectorXd & x0,
+                                    double tol = 1e-8)
+{
+  const int nrVars = static_cast<int>(Aeq.cols());
+  // Aeq^T P = Q R so Aeq x = beq become R^T Q^T x = P^T beq
+  qr.compute(Aeq.transpose());
+  const int rank = static_cast<int>(qr.rank());
+  Q = qr.householderQ();
+  Z = Q.rightCols(nrVars - rank);
+
+  Eigen::VectorXd Pb = qr.colsPermutation().transpose() * beq;
+  x0.noalias() = Q.leftCols(rank)
+                 * qr.matrixR().topLeftCorner(rank, rank).triangularView<Eigen::Upper>().transpose().solve(
+                     Pb.head(rank));
+  if((Aeq * x0 - beq).norm() > tol * (1. + beq.norm())) { return -1; }
+  return rank;
+}
+
+/**
+ * Label the variables by connected component of the coupling graph.
+ * Two variables are coupled when they share a non zero term of \f$ Q \f$,
+ * a non zero line of \f$ A_{eq} \f$ or \f$ A_{ineq} \f$ or when they
+ * have the same non negative group.
+ * @param groups Group of each variable, can be empty.
+ * @param parent Union find workspace.
+ * @param component Component index of each variable, components are numbered
+ * by order of their first variable.
+ * @return Number of components.
+ */
+template<typename MatrixType>
+inline int variableComponents(const Eigen::MatrixXd & Q,
+                              const MatrixType & Aeq,
+                              const MatrixType & Aineq,
+                              const std::vector<int> & groups,
+                              std::vector<int> & parent,
+                              std::vector<int> & component)
+{
+  const int nrVars = static_cast<int>(Q.rows());
+  parent.resize(static_cast<size_t>(nrVars));
+  for(int i = 0; i < nrVars; ++i) { parent[static_cast<size_t>(i)] = i; }
+
+  auto find = [&parent](int i) {
+    while(parent[static_cast<size_t>(i)] != i)
+    {
+      parent[static_cast<size_t>(i)] = parent[static_cast<size_t>(parent[static_cast<size_t>(i)])];
+      i = parent[static_cast<size_t>(i)];
+    }
+    return i;
+  };
+  auto unite = [&parent, &find](int i, int j) {
+    i = find(i);
+    j = find(j);
+    // keep the smallest index as root to number the components in order
+    if(i < j) { parent[static_cast<size_t>(j)] = i; }
+    else if(j < i) { parent[static_cast<size_t>(i)] = j; }
+  };
+  auto uniteLines = [nrVars, &unite](const MatrixType & A) {
+    for(Eigen::Index l = 0; l < A.rows(); ++l)
+    {
+      int first = -1;
+      for(int i = 0; i < nrVars; ++i)
+      {
+        if(A(l, i) == 0.) { continue; }
+        if(first == -1) { first = i; }
+        else { unite(first, i); }
+      }
+    }
+  };
+
+  std::vector<int> groupFirst;
+  for(int i = 0; i < static_cast<int>(groups.size()); ++i)
+  {
+    int g = groups[static_cast<size_t>(i)];
+    if(g < 0) { continue; }
+    if(static_cast<int>(groupFirst.size()) <= g) { groupFirst.resize(static_cast<size_t>(g) + 1, -1); }
+    if(groupFirst[static_cast<size_t>(g)] == -1) { groupFirst[static_cast<size_t>(g)] = i; }
+    else { unite(groupFirst[static_cast<size_t>(g)], i); }
+  }
+
+  for(int c = 0; c < nrVars; ++c)
+  {
+    for(int r = 0; r < c; ++r)
+    {
+      if(Q(r, c) != 0. || Q(c, r) != 0.) { unite(r, c); }
+    }
+  }
+  uniteLines(Aeq);
+  uniteLines(Aineq);
+
+  int nrComponents = 0;
+  component.resize(static_cast<size_t>(nrVars));
+  for(int i = 0; i < nrVars; ++i)
+  {
+    int root = find(i);
+    if(root == i) { component[static_cast<size_t>(i)] = nrComponents++; }
+    else { component[static_cast<size_t>(i)] = component[static_cast<size_t>(root)]; }
+  }
+  return nrComponents;
+}
+
 /**
  * Return the full variable from the reduced variable
  */
@@ -355,21 +675,22 @@ std::ostream & printConstr(const Eigen::VectorXd & result, T * constr, int line,
 template<>
 inline std::ostream & printConstr(const Eigen::VectorXd & result, Equality * constr, int line, std::ostream & out)
 {
-  out << constr->AEq().row(line) * result << " = " << constr->bEq()(line);
+  out << lineProduct(constr->AEq(), constr->columnsEq(), line, result) << " = " << constr->bEq()(line);
   return out;
 }
 
 template<>
 inline std::ostream & printConstr(const Eigen::VectorXd & result, Inequality * constr, int line, std::ostream & out)
 {
-  out << constr->AInEq().row(line) * result << " <= " << constr->bInEq()(line);
+  out << lineProduct(constr->AInEq(), constr->columnsInEq(), line, result) << " <= " << constr->bInEq()(line);
   return out;
 }
 
 template<>
 inline std::ostream & printConstr(const Eigen::VectorXd & result, GenInequality * constr, int line, std::ostream & out)
 {
-  out << constr->LowerGenInEq()(line) << " <= " << constr->AGenInEq().row(line) * result
+  out << constr->LowerGenInEq()(line) << " <= "
+      << lineProduct(constr->AGenInEq(), constr->columnsGenInEq(), line, result)
       << " <= " << constr->UpperGenInEq()(line);
   return out;
 }
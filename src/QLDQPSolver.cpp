@@ -6,6 +6,17 @@
 #include "QLDQPSolver.h"
 
 // includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+
 // Tasks
 #include "GenQPUtils.h"
 #include "Tasks/QPSolver.h"
@@ -16,15 +27,152 @@ namespace tasks
 namespace qp
 {
 
+namespace
+{
+
+/// Synchronization point of a fixed number of threads.
+class Barrier
+{
+public:
+  explicit Barrier(int nrThreads) : nrThreads_(nrThreads), nrWaiting_(0), generation_(0) {}
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned long long generation = generation_;
+    if(++nrWaiting_ == nrThreads_)
+    {
+      nrWaiting_ = 0;
+      ++generation_;
+      cv_.notify_all();
+    }
+    else { cv_.wait(lock, [this, generation]() { return generation != generation_; }); }
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int nrThreads_, nrWaiting_;
+  unsigned long long generation_;
+};
+
+/**
+ * QL0001 keeps its machine precision in a COMMON block and f2c builds of it
+ * use static locals, so the QLD solves of the whole process are serialized
+ * unless eigen-qld is known to be reentrant (QLD_REENTRANT CMake option).
+ */
+template<typename... Args>
+bool qldSolve(Eigen::QLD & qld, Args &&... args)
+{
+#ifndef TASKS_QLD_REENTRANT
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+#endif
+  return qld.solve(std::forward<Args>(args)...);
+}
+
+} // namespace
+
+/**
+ * Persistent threads that run the tasks of a parallel solve.
+ * Each task has its own thread so the tasks can wait for each other.
+ */
+class QLDQPSolver::WorkerPool
+{
+public:
+  WorkerPool() : task_(nullptr), nrTasks_(0), nrRunning_(0), generation_(0), stop_(false) {}
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    startCv_.notify_all();
+    for(std::thread & t : threads_) { t.join(); }
+  }
+
+  /// Run task(k) for k in [0, nrTasks), the task 0 is run by the calling thread.
+  void run(int nrTasks, const std::function<void(int)> & task)
+  {
+    // generation_ is only written by the calling thread
+    while(int(threads_.size()) < nrTasks - 1)
+    {
+      threads_.emplace_back(&WorkerPool::work, this, int(threads_.size()) + 1, generation_);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      nrTasks_ = nrTasks;
+      nrRunning_ = nrTasks - 1;
+      ++generation_;
+    }
+    startCv_.notify_all();
+    task(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCv_.wait(lock, [this]() { return nrRunning_ == 0; });
+  }
+
+private:
+  void work(int k, unsigned long long generation)
+  {
+    while(true)
+    {
+      const std::function<void(int)> * task = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        startCv_.wait(lock, [this, generation]() { return stop_ || generation != generation_; });
+        if(stop_) { return; }
+        generation = generation_;
+        if(k >= nrTasks_) { continue; }
+        task = task_;
+      }
+      (*task)(k);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --nrRunning_;
+      }
+      doneCv_.notify_one();
+    }
+  }
+
+private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable startCv_, doneCv_;
+  const std::function<void(int)> * task_;
+  int nrTasks_, nrRunning_;
+  unsigned long long generation_;
+  bool stop_;
+};
+
 QLDQPSolver::QLDQPSolver()
 : qld_(), Aeq_(), Aineq_(), beq_(), bineq_(), AeqFull_(), AineqFull_(), XL_(), XU_(), XLFull_(), XUFull_(), Q_(), C_(),
-  QFull_(), CFull_(), nrAeqLines_(0), nrAineqLines_(0)
+  QFull_(), CFull_(), nrAeqLines_(0), nrAineqLines_(0), eqQR_(), eqQ_(), Z_(), QZ_(), QY_(), AineqY_(), x0_(), CY_(),
+  bineqY_(), XLY_(), XUY_(), XEq_(), eqReduced_(false), maxAineqYLines_(0), qldNrVars_(-1), qldNrEq_(-1),
+  qldNrInEq_(-1), subProblems_(), groups_(), parent_(), component_(), eqComponent_(), inEqComponent_(), XDec_(),
+  decomposed_(false), nrSubProblems_(1), workers_(new WorkerPool), consensusProblems_(), partition_(), localIndex_(),
+  z_(), zPrev_(), copies_(), rhsZ_(), QSparse_(), copiesDiag_(), M_(), zLLT_(), rho_(1.)
+{
+}
+
+QLDQPSolver::~QLDQPSolver() = default;
+
+void QLDQPSolver::qldProblem(int nrVars, int nrEq, int nrInEq)
 {
+  if(nrVars != qldNrVars_ || nrEq != qldNrEq_ || nrInEq != qldNrInEq_)
+  {
+    qld_.problem(nrVars, nrEq, nrInEq);
+    qldNrVars_ = nrVars;
+    qldNrEq_ = nrEq;
+    qldNrInEq_ = nrInEq;
+  }
 }
 
 void QLDQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
 {
-  int maxAeqLines = nrEq;
+  // general inequality lines are split between equality and inequality lines
+  int maxAeqLines = nrEq + nrGenInEq;
   int maxAineqLines = nrInEq + nrGenInEq * 2;
 
   AeqFull_.resize(maxAeqLines, nrVars);
@@ -54,9 +202,12 @@ void QLDQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
 
     XFull_.resize(nrVars);
 
-    qld_.problem(reducedNrVars, maxAeqLines, maxAineqLines);
+    qldProblem(reducedNrVars, maxAeqLines, maxAineqLines);
   }
-  else { qld_.problem(nrVars, maxAeqLines, maxAineqLines); }
+  else { qldProblem(nrVars, maxAeqLines, maxAineqLines); }
+
+  // each variable bound can become two inequality lines in the null space
+  maxAineqYLines_ = maxAineqLines + 2 * nrVars;
 }
 
 void QLDQPSolver::updateMatrix(const std::vector<Task *> & tasks,
@@ -80,7 +231,8 @@ void QLDQPSolver::updateMatrix(const std::vector<Task *> & tasks,
   nrAeqLines_ = fillEq(eqConstr, nrVars, nrAeqLines_, AeqFull_, beq_);
   nrAineqLines_ = 0;
   nrAineqLines_ = fillInEq(inEqConstr, nrVars, nrAineqLines_, AineqFull_, bineq_);
-  nrAineqLines_ = fillGenInEq(genInEqConstr, nrVars, nrAineqLines_, AineqFull_, bineq_);
+  std::tie(nrAeqLines_, nrAineqLines_) =
+      fillGenInEq(genInEqConstr, nrVars, nrAeqLines_, AeqFull_, beq_, nrAineqLines_, AineqFull_, bineq_);
 
   fillBound(boundConstr, XLFull_, XUFull_);
   fillQC(tasks, nrVars, QFull_, CFull_);
@@ -101,26 +253,519 @@ void QLDQPSolver::updateMatrix(const std::vector<Task *> & tasks,
 
 bool QLDQPSolver::solve()
 {
+  const bool dependencies = !dependencies_.empty();
+  const Eigen::MatrixXd & Q = dependencies ? Q_ : QFull_;
+  const Eigen::VectorXd & C = dependencies ? C_ : CFull_;
+  const Eigen::MatrixXd & Aeq = dependencies ? Aeq_ : AeqFull_;
+  const Eigen::MatrixXd & Aineq = dependencies ? Aineq_ : AineqFull_;
+  const Eigen::VectorXd & XL = dependencies ? XL_ : XLFull_;
+  const Eigen::VectorXd & XU = dependencies ? XU_ : XUFull_;
+  const int nrVars = int(Q.rows());
+
   bool success = false;
-  if(dependencies_.size())
+  eqReduced_ = false;
+  decomposed_ = false;
+  nrSubProblems_ = 1;
+  // the exact decomposition is tried before the consensus
+  if(decomposition_)
+  {
+    success = solveDecomposed(Q, C, Aeq.topRows(nrAeqLines_), beq_.head(nrAeqLines_), Aineq.topRows(nrAineqLines_),
+                              bineq_.head(nrAineqLines_), XL, XU);
+  }
+
+  if(!decomposed_ && consensus_)
+  {
+    success = solveConsensus(Q, C, Aeq.topRows(nrAeqLines_), beq_.head(nrAeqLines_), Aineq.topRows(nrAineqLines_),
+                             bineq_.head(nrAineqLines_), XL, XU);
+  }
+
+  if(!decomposed_ && nullSpaceReduction_ && nrAeqLines_ > 0)
+  {
+    success = solveReduced(Q, C, Aeq.topRows(nrAeqLines_), beq_.head(nrAeqLines_), Aineq.topRows(nrAineqLines_),
+                           bineq_.head(nrAineqLines_), XL, XU);
+  }
+
+  // the full problem is solved when the reduction is disabled, when the
+  // equalities fix all the variables or when they are inconsistent
+  if(!decomposed_ && !eqReduced_)
+  {
+    qldProblem(nrVars, int(Aeq.rows()), int(Aineq.rows()));
+    success = qldSolve(qld_, Q, C, Aeq.topRows(nrAeqLines_), beq_.head(nrAeqLines_), Aineq.topRows(nrAineqLines_),
+                       bineq_.head(nrAineqLines_), XL, XU, false, 1e-6);
+  }
+
+  if(dependencies) { expandResult(decomposed_ ? XDec_ : (eqReduced_ ? XEq_ : qld_.result()), XFull_, multipliers_); }
+  return success;
+}
+
+bool QLDQPSolver::SubProblem::solve()
+{
+  const int nrVars = int(vars.size());
+  // QLD is only reallocated when the sub-problem grow
+  if(nrVars != qldNrVars || nrEq > qldNrEq || nrInEq > qldNrInEq)
+  {
+    qldNrVars = nrVars;
+    qldNrEq = std::max(nrEq, qldNrEq);
+    qldNrInEq = std::max(nrInEq, qldNrInEq);
+    qld.problem(qldNrVars, qldNrEq, qldNrInEq);
+  }
+  return qldSolve(qld, Q, C, Aeq.topRows(nrEq), beq.head(nrEq), Aineq.topRows(nrInEq), bineq.head(nrInEq), XL, XU,
+                  false, 1e-6);
+}
+
+bool QLDQPSolver::solveDecomposed(const Eigen::MatrixXd & Q,
+                                  const Eigen::VectorXd & C,
+                                  const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                                  const Eigen::Ref<const Eigen::VectorXd> & beq,
+                                  const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                                  const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                                  const Eigen::VectorXd & XL,
+                                  const Eigen::VectorXd & XU)
+{
+  const int nrVars = int(Q.rows());
+
+  solverGroups();
+  const int nrComponents = variableComponents(Q, Aeq, Aineq, groups_, parent_, component_);
+  if(nrComponents < 2) { return false; }
+
+  // lines without non zero coefficient are not sent to any sub-problem,
+  // the full problem is solved if they are violated to report the failure
+  auto lineComponent = [this, nrVars](const Eigen::Ref<const Eigen::MatrixXd> & A, Eigen::Index line) {
+    for(int i = 0; i < nrVars; ++i)
+    {
+      if(A(line, i) != 0.) { return component_[static_cast<size_t>(i)]; }
+    }
+    return -1;
+  };
+  eqComponent_.resize(static_cast<size_t>(Aeq.rows()));
+  for(Eigen::Index l = 0; l < Aeq.rows(); ++l)
+  {
+    eqComponent_[static_cast<size_t>(l)] = lineComponent(Aeq, l);
+    if(eqComponent_[static_cast<size_t>(l)] == -1 && std::abs(beq(l)) > 1e-8) { return false; }
+  }
+  inEqComponent_.resize(static_cast<size_t>(Aineq.rows()));
+  for(Eigen::Index l = 0; l < Aineq.rows(); ++l)
+  {
+    inEqComponent_[static_cast<size_t>(l)] = lineComponent(Aineq, l);
+    if(inEqComponent_[static_cast<size_t>(l)] == -1 && bineq(l) < -1e-8) { return false; }
+  }
+  decomposed_ = true;
+
+  while(int(subProblems_.size()) < nrComponents) { subProblems_.emplace_back(new SubProblem); }
+  for(int k = 0; k < nrComponents; ++k)
   {
-    success = qld_.solve(Q_, C_, Aeq_.block(0, 0, nrAeqLines_, int(Aeq_.cols())), beq_.segment(0, nrAeqLines_),
-                         Aineq_.block(0, 0, nrAineqLines_, int(Aineq_.cols())), bineq_.segment(0, nrAineqLines_), XL_,
-                         XU_, false, 1e-6);
-    expandResult(qld_.result(), XFull_, multipliers_);
+    SubProblem & sp = *subProblems_[static_cast<size_t>(k)];
+    sp.vars.clear();
+    sp.nrEq = 0;
+    sp.nrInEq = 0;
   }
-  else
+  for(int i = 0; i < nrVars; ++i)
   {
-    success = qld_.solve(QFull_, CFull_, AeqFull_.block(0, 0, nrAeqLines_, int(AeqFull_.cols())),
-                         beq_.segment(0, nrAeqLines_), AineqFull_.block(0, 0, nrAineqLines_, int(AineqFull_.cols())),
-                         bineq_.segment(0, nrAineqLines_), XLFull_, XUFull_, false, 1e-6);
+    subProblems_[static_cast<size_t>(component_[static_cast<size_t>(i)])]->vars.push_back(i);
   }
+  for(int c : eqComponent_)
+  {
+    if(c != -1) { ++subProblems_[static_cast<size_t>(c)]->nrEq; }
+  }
+  for(int c : inEqComponent_)
+  {
+    if(c != -1) { ++subProblems_[static_cast<size_t>(c)]->nrInEq; }
+  }
+
+  for(int k = 0; k < nrComponents; ++k)
+  {
+    SubProblem & sp = *subProblems_[static_cast<size_t>(k)];
+    const int n = int(sp.vars.size());
+    sp.Q.resize(n, n);
+    sp.C.resize(n);
+    sp.XL.resize(n);
+    sp.XU.resize(n);
+    for(int j = 0; j < n; ++j)
+    {
+      const int vj = sp.vars[static_cast<size_t>(j)];
+      for(int i = 0; i < n; ++i) { sp.Q(i, j) = Q(sp.vars[static_cast<size_t>(i)], vj); }
+      sp.C(j) = C(vj);
+      sp.XL(j) = XL(vj);
+      sp.XU(j) = XU(vj);
+    }
+    sp.Aeq.resize(sp.nrEq, n);
+    sp.beq.resize(sp.nrEq);
+    sp.Aineq.resize(sp.nrInEq, n);
+    sp.bineq.resize(sp.nrInEq);
+    sp.nrEq = 0;
+    sp.nrInEq = 0;
+  }
+
+  auto fillLines = [this](const Eigen::Ref<const Eigen::MatrixXd> & A, const Eigen::Ref<const Eigen::VectorXd> & b,
+                          const std::vector<int> & lineComp, bool eq) {
+    for(std::size_t l = 0; l < lineComp.size(); ++l)
+    {
+      if(lineComp[l] == -1) { continue; }
+      SubProblem & sp = *subProblems_[static_cast<size_t>(lineComp[l])];
+      Eigen::MatrixXd & spA = eq ? sp.Aeq : sp.Aineq;
+      Eigen::VectorXd & spb = eq ? sp.beq : sp.bineq;
+      int & line = eq ? sp.nrEq : sp.nrInEq;
+      for(std::size_t i = 0; i < sp.vars.size(); ++i) { spA(line, Eigen::Index(i)) = A(Eigen::Index(l), sp.vars[i]); }
+      spb(line) = b(Eigen::Index(l));
+      ++line;
+    }
+  };
+  fillLines(Aeq, beq, eqComponent_, true);
+  fillLines(Aineq, bineq, inEqComponent_, false);
+
+  nrSubProblems_ = nrComponents;
+  workers_->run(nrComponents, [this](int k) {
+    SubProblem & sp = *subProblems_[static_cast<size_t>(k)];
+    sp.success = sp.solve();
+  });
+
+  bool success = true;
+  XDec_.resize(nrVars);
+  for(int k = 0; k < nrComponents; ++k)
+  {
+    const SubProblem & sp = *subProblems_[static_cast<size_t>(k)];
+    success = success && sp.success;
+    const Eigen::VectorXd & x = sp.qld.result();
+    for(std::size_t i = 0; i < sp.vars.size(); ++i) { XDec_(sp.vars[i]) = x(Eigen::Index(i)); }
+  }
+  return success;
+}
+
+bool QLDQPSolver::solveReduced(const Eigen::MatrixXd & Q,
+                               const Eigen::VectorXd & C,
+                               const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                               const Eigen::Ref<const Eigen::VectorXd> & beq,
+                               const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                               const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                               const Eigen::VectorXd & XL,
+                               const Eigen::VectorXd & XU)
+{
+  const int nrVars = int(Q.rows());
+  // inconsistent equalities are reported by the full solve
+  const int rank = nullSpaceParametrization(Aeq, beq, eqQR_, eqQ_, Z_, x0_);
+  if(rank < 0) { return false; }
+  const int nrYVars = nrVars - rank;
+  if(nrYVars == 0) { return false; }
+  eqReduced_ = true;
+
+  // x = x0 + Z y
+  // min 1/2 y^T Z^T Q Z y + y^T Z^T (Q x0 + C)
+  QZ_.noalias() = Q * Z_;
+  QY_.noalias() = Z_.transpose() * QZ_;
+  CY_.noalias() = QZ_.transpose() * x0_;
+  CY_.noalias() += Z_.transpose() * C;
+
+  // Aineq Z y <= bineq - Aineq x0
+  AineqY_.resize(maxAineqYLines_, nrYVars);
+  bineqY_.resize(maxAineqYLines_);
+  int nrLines = int(Aineq.rows());
+  AineqY_.topRows(nrLines).noalias() = Aineq * Z_;
+  bineqY_.head(nrLines) = bineq;
+  bineqY_.head(nrLines).noalias() -= Aineq * x0_;
+
+  // XL - x0 <= Z y <= XU - x0
+  for(int i = 0; i < nrVars; ++i)
+  {
+    if(XL(i) != -std::numeric_limits<double>::infinity())
+    {
+      AineqY_.row(nrLines) = -Z_.row(i);
+      bineqY_(nrLines) = x0_(i) - XL(i);
+      ++nrLines;
+    }
+    if(XU(i) != std::numeric_limits<double>::infinity())
+    {
+      AineqY_.row(nrLines) = Z_.row(i);
+      bineqY_(nrLines) = XU(i) - x0_(i);
+      ++nrLines;
+    }
+  }
+  XLY_.setConstant(nrYVars, -std::numeric_limits<double>::infinity());
+  XUY_.setConstant(nrYVars, std::numeric_limits<double>::infinity());
+
+  qldProblem(nrYVars, 0, maxAineqYLines_);
+  bool success = qldSolve(qld_, QY_, CY_, AineqY_.topRows(0), bineqY_.head(0), AineqY_.topRows(nrLines),
+                          bineqY_.head(nrLines), XLY_, XUY_, false, 1e-6);
+
+  XEq_ = x0_;
+  XEq_.noalias() += Z_ * qld_.result();
   return success;
 }
 
+void QLDQPSolver::solverGroups()
+{
+  // groups are given on the full variables
+  groups_.clear();
+  if(int(variableGroups_.size()) == int(QFull_.rows()))
+  {
+    if(dependencies_.empty()) { groups_ = variableGroups_; }
+    else
+    {
+      groups_.resize(reducedToFull_.size());
+      for(std::size_t i = 0; i < reducedToFull_.size(); ++i)
+      {
+        groups_[i] = variableGroups_[static_cast<size_t>(reducedToFull_[i])];
+      }
+    }
+  }
+}
+
+bool QLDQPSolver::solveConsensus(const Eigen::MatrixXd & Q,
+                                 const Eigen::VectorXd & C,
+                                 const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                                 const Eigen::Ref<const Eigen::VectorXd> & beq,
+                                 const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                                 const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                                 const Eigen::VectorXd & XL,
+                                 const Eigen::VectorXd & XU)
+{
+  // Scaled consensus ADMM on min 1/2 z^T Q z + z^T C s.t. x_k = E_k z, x_k in S_k
+  // with E_k selecting the variables of the partition k and the copies it need
+  // to handle the constraint lines starting on its variables.
+  // x_k = proj_S_k(E_k z - u_k) are solved in parallel by QLD
+  // (Q + rho sum E_k^T E_k) z = -C + rho sum E_k^T (x_k + u_k)
+  // u_k += x_k - E_k z
+  const int nrVars = int(Q.rows());
+
+  // one partition by group, variables without group have their own partition
+  solverGroups();
+  if(groups_.empty()) { return false; }
+  int nrPartitions = 0;
+  std::vector<int> groupPartition;
+  partition_.resize(static_cast<size_t>(nrVars));
+  for(int i = 0; i < nrVars; ++i)
+  {
+    int g = groups_[static_cast<size_t>(i)];
+    if(g < 0)
+    {
+      partition_[static_cast<size_t>(i)] = nrPartitions++;
+      continue;
+    }
+    if(static_cast<int>(groupPartition.size()) <= g) { groupPartition.resize(static_cast<size_t>(g) + 1, -1); }
+    if(groupPartition[static_cast<size_t>(g)] == -1) { groupPartition[static_cast<size_t>(g)] = nrPartitions++; }
+    partition_[static_cast<size_t>(i)] = groupPartition[static_cast<size_t>(g)];
+  }
+  if(nrPartitions < 2) { return false; }
+
+  // each line is handled by the partition of its first variable,
+  // violated lines without non zero coefficient are reported by the full problem
+  auto lineOwner = [this, nrVars](const Eigen::Ref<const Eigen::MatrixXd> & A, Eigen::Index line) {
+    for(int i = 0; i < nrVars; ++i)
+    {
+      if(A(line, i) != 0.) { return partition_[static_cast<size_t>(i)]; }
+    }
+    return -1;
+  };
+  eqComponent_.resize(static_cast<size_t>(Aeq.rows()));
+  for(Eigen::Index l = 0; l < Aeq.rows(); ++l)
+  {
+    eqComponent_[static_cast<size_t>(l)] = lineOwner(Aeq, l);
+    if(eqComponent_[static_cast<size_t>(l)] == -1 && std::abs(beq(l)) > 1e-8) { return false; }
+  }
+  inEqComponent_.resize(static_cast<size_t>(Aineq.rows()));
+  for(Eigen::Index l = 0; l < Aineq.rows(); ++l)
+  {
+    inEqComponent_[static_cast<size_t>(l)] = lineOwner(Aineq, l);
+    if(inEqComponent_[static_cast<size_t>(l)] == -1 && bineq(l) < -1e-8) { return false; }
+  }
+
+  // the previous consensus is used as warm start while the partitions don't change
+  bool warm = z_.size() == nrVars && int(consensusProblems_.size()) == nrPartitions;
+  while(int(consensusProblems_.size()) < nrPartitions) { consensusProblems_.emplace_back(new SubProblem); }
+  consensusProblems_.resize(static_cast<size_t>(nrPartitions));
+
+  localIndex_.assign(static_cast<size_t>(nrVars), -1);
+  copies_.setZero(nrVars);
+  std::vector<int> prevVars;
+  for(int k = 0; k < nrPartitions; ++k)
+  {
+    SubProblem & sp = *consensusProblems_[static_cast<size_t>(k)];
+    prevVars.swap(sp.vars);
+    sp.vars.clear();
+    auto addVar = [this, &sp](int i) {
+      if(localIndex_[static_cast<size_t>(i)] == -1)
+      {
+        localIndex_[static_cast<size_t>(i)] = int(sp.vars.size());
+        sp.vars.push_back(i);
+      }
+    };
+    for(int i = 0; i < nrVars; ++i)
+    {
+      if(partition_[static_cast<size_t>(i)] == k) { addVar(i); }
+    }
+    auto addLinesVars = [nrVars, k, &addVar](const Eigen::Ref<const Eigen::MatrixXd> & A,
+                                             const std::vector<int> & owner, int & nrLines) {
+      nrLines = 0;
+      for(std::size_t l = 0; l < owner.size(); ++l)
+      {
+        if(owner[l] != k) { continue; }
+        ++nrLines;
+        for(int i = 0; i < nrVars; ++i)
+        {
+          if(A(Eigen::Index(l), i) != 0.) { addVar(i); }
+        }
+      }
+    };
+    addLinesVars(Aeq, eqComponent_, sp.nrEq);
+    addLinesVars(Aineq, inEqComponent_, sp.nrInEq);
+
+    const int n = int(sp.vars.size());
+    sp.Q.setIdentity(n, n);
+    sp.C.resize(n);
+    sp.XL.resize(n);
+    sp.XU.resize(n);
+    for(int i = 0; i < n; ++i)
+    {
+      sp.XL(i) = XL(sp.vars[static_cast<size_t>(i)]);
+      sp.XU(i) = XU(sp.vars[static_cast<size_t>(i)]);
+    }
+
+    auto fillLines = [this, nrVars, k, &sp](const Eigen::Ref<const Eigen::MatrixXd> & A,
+                                            const Eigen::Ref<const Eigen::VectorXd> & b, const std::vector<int> & owner,
+                                            Eigen::MatrixXd & spA, Eigen::VectorXd & spb, int nrLines) {
+      spA.setZero(nrLines, Eigen::Index(sp.vars.size()));
+      spb.resize(nrLines);
+      int line = 0;
+      for(std::size_t l = 0; l < owner.size(); ++l)
+      {
+        if(owner[l] != k) { continue; }
+        for(int i = 0; i < nrVars; ++i)
+        {
+          if(A(Eigen::Index(l), i) != 0.) { spA(line, localIndex_[static_cast<size_t>(i)]) = A(Eigen::Index(l), i); }
+        }
+        spb(line) = b(Eigen::Index(l));
+        ++line;
+      }
+    };
+    fillLines(Aeq, beq, eqComponent_, sp.Aeq, sp.beq, sp.nrEq);
+    fillLines(Aineq, bineq, inEqComponent_, sp.Aineq, sp.bineq, sp.nrInEq);
+
+    for(int i : sp.vars)
+    {
+      copies_(i) += 1.;
+      localIndex_[static_cast<size_t>(i)] = -1;
+    }
+    if(sp.vars != prevVars) { warm = false; }
+  }
+
+  if(!warm)
+  {
+    z_.setZero(nrVars);
+    rho_ = consensusRho_;
+    for(std::unique_ptr<SubProblem> & sp : consensusProblems_) { sp->u.setZero(Eigen::Index(sp->vars.size())); }
+  }
+
+  std::vector<Eigen::Triplet<double>> diag;
+  diag.reserve(static_cast<size_t>(nrVars));
+  for(int i = 0; i < nrVars; ++i) { diag.emplace_back(i, i, copies_(i)); }
+  copiesDiag_.resize(nrVars, nrVars);
+  copiesDiag_.setFromTriplets(diag.begin(), diag.end());
+  QSparse_ = Q.sparseView();
+  M_ = QSparse_ + rho_ * copiesDiag_;
+  zLLT_.compute(M_);
+  if(zLLT_.info() != Eigen::Success) { return false; }
+
+  int iter = 0;
+  bool stop = false, converged = false;
+  double uScale = 1.;
+  // done by the calling thread while the other threads wait
+  auto zUpdate = [&]() {
+    bool projected = true;
+    rhsZ_ = -C;
+    for(const std::unique_ptr<SubProblem> & sp : consensusProblems_)
+    {
+      projected = projected && sp->success;
+      const Eigen::VectorXd & x = sp->qld.result();
+      for(std::size_t i = 0; i < sp->vars.size(); ++i)
+      {
+        rhsZ_(sp->vars[i]) += rho_ * (x(Eigen::Index(i)) + sp->u(Eigen::Index(i)));
+      }
+    }
+    zPrev_ = z_;
+    z_ = zLLT_.solve(rhsZ_);
+
+    double primal = 0.;
+    for(const std::unique_ptr<SubProblem> & sp : consensusProblems_)
+    {
+      const Eigen::VectorXd & x = sp->qld.result();
+      for(std::size_t i = 0; i < sp->vars.size(); ++i)
+      {
+        primal += std::pow(x(Eigen::Index(i)) - z_(sp->vars[i]), 2);
+      }
+    }
+    primal = std::sqrt(primal);
+    const double dual = rho_ * std::sqrt(copies_.dot((z_ - zPrev_).cwiseAbs2()));
+
+    ++iter;
+    converged = primal <= consensusTolerance_ && dual <= consensusTolerance_;
+    stop = converged || !projected || iter >= consensusMaxIter_;
+
+    // balance the primal and dual residuals
+    uScale = 1.;
+    if(!stop && (primal > 10. * dual || dual > 10. * primal))
+    {
+      double rho = primal > dual ? 2. * rho_ : 0.5 * rho_;
+      uScale = rho_ / rho;
+      rho_ = rho;
+      M_ = QSparse_ + rho_ * copiesDiag_;
+      zLLT_.factorize(M_);
+    }
+  };
+
+  Barrier barrier(nrPartitions);
+  auto work = [&](int k) {
+    SubProblem & sp = *consensusProblems_[static_cast<size_t>(k)];
+    sp.success = true;
+    while(true)
+    {
+      for(std::size_t i = 0; i < sp.vars.size(); ++i)
+      {
+        sp.C(Eigen::Index(i)) = sp.u(Eigen::Index(i)) - z_(sp.vars[i]);
+      }
+      sp.success = sp.solve() && sp.success;
+      barrier.wait();
+      if(k == 0) { zUpdate(); }
+      barrier.wait();
+      const Eigen::VectorXd & x = sp.qld.result();
+      for(std::size_t i = 0; i < sp.vars.size(); ++i)
+      {
+        sp.u(Eigen::Index(i)) = uScale * (sp.u(Eigen::Index(i)) + x(Eigen::Index(i)) - z_(sp.vars[i]));
+      }
+      if(stop) { break; }
+    }
+  };
+
+  workers_->run(nrPartitions, work);
+
+  // the full problem is solved when the consensus fails,
+  // the next consensus is then started from scratch
+  if(!converged)
+  {
+    z_.resize(0);
+    return false;
+  }
+  decomposed_ = true;
+  nrSubProblems_ = nrPartitions;
+  // each variable is taken from the partition that own it rather than from
+  // the average z, so the lines that only involve the variables of one
+  // partition are satisfied to the QLD precision
+  XDec_.resize(nrVars);
+  for(int k = 0; k < nrPartitions; ++k)
+  {
+    const SubProblem & sp = *consensusProblems_[static_cast<size_t>(k)];
+    const Eigen::VectorXd & x = sp.qld.result();
+    for(std::size_t i = 0; i < sp.vars.size(); ++i)
+    {
+      if(partition_[static_cast<size_t>(sp.vars[i])] == k) { XDec_(sp.vars[i]) = x(Eigen::Index(i)); }
+    }
+  }
+  return true;
+}
+
 const Eigen::VectorXd & QLDQPSolver::result() const
 {
   if(dependencies_.size()) { return XFull_; }
+  else if(decomposed_) { return XDec_; }
+  else if(eqReduced_) { return XEq_; }
   else { return qld_.result(); }
 }
 
@@ -140,6 +785,11 @@ std::string QLDQPSolver::name() const
   return "QLD";
 }
 
+int QLDQPSolver::nrSubProblems() const
+{
+  return nrSubProblems_;
+}
+
 } // namespace qp
 
 } // namespace tasks
@@ -5,6 +5,14 @@
 #pragma once
 
 // includes
+// std
+#include <memory>
+#include <vector>
+
+// Eigen
+#include <Eigen/QR>
+#include <Eigen/SparseCholesky>
+
 // eigen-qld
 #include <eigen-qld/QLD.h>
 
@@ -24,6 +32,7 @@ class TASKS_DLLAPI QLDQPSolver : public GenQPSolver
 {
 public:
   QLDQPSolver();
+  virtual ~QLDQPSolver() override;
 
   virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
   virtual void updateMatrix(const std::vector<Task *> & tasks,
@@ -41,6 +50,65 @@ public:
                                   const std::vector<Bound *> & boundConstr,
                                   std::ostream & out) const override;
   std::string name() const override;
+  int nrSubProblems() const override;
+
+private:
+  /// Only reallocate QLD when the problem size change.
+  void qldProblem(int nrVars, int nrEq, int nrInEq);
+  /// Solve the problem in the Aeq null space, the result is stored in XEq_.
+  bool solveReduced(const Eigen::MatrixXd & Q,
+                    const Eigen::VectorXd & C,
+                    const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                    const Eigen::Ref<const Eigen::VectorXd> & beq,
+                    const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                    const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                    const Eigen::VectorXd & XL,
+                    const Eigen::VectorXd & XU);
+  /// Solve each independent sub-problem in a worker thread, the result is stored in XDec_.
+  bool solveDecomposed(const Eigen::MatrixXd & Q,
+                       const Eigen::VectorXd & C,
+                       const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                       const Eigen::Ref<const Eigen::VectorXd> & beq,
+                       const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                       const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                       const Eigen::VectorXd & XL,
+                       const Eigen::VectorXd & XU);
+  /**
+   * Solve the problem by consensus ADMM between the variable groups, the result
+   * is stored in XDec_ only when the consensus converges.
+   */
+  bool solveConsensus(const Eigen::MatrixXd & Q,
+                      const Eigen::VectorXd & C,
+                      const Eigen::Ref<const Eigen::MatrixXd> & Aeq,
+                      const Eigen::Ref<const Eigen::VectorXd> & beq,
+                      const Eigen::Ref<const Eigen::MatrixXd> & Aineq,
+                      const Eigen::Ref<const Eigen::VectorXd> & bineq,
+                      const Eigen::VectorXd & XL,
+                      const Eigen::VectorXd & XU);
+  /// Fill groups_ with the group of each solver variable.
+  void solverGroups();
+
+private:
+  /// Persistent threads running the sub-problems, see QLDQPSolver.cpp.
+  class WorkerPool;
+
+  /// Part of the problem solved by the decomposition or the consensus.
+  struct SubProblem
+  {
+    SubProblem() : nrEq(0), nrInEq(0), qldNrVars(-1), qldNrEq(-1), qldNrInEq(-1), success(false) {}
+
+    bool solve();
+
+    Eigen::QLD qld;
+    std::vector<int> vars;
+    Eigen::MatrixXd Q, Aeq, Aineq;
+    Eigen::VectorXd C, beq, bineq, XL, XU;
+    // consensus scaled multipliers
+    Eigen::VectorXd u;
+    int nrEq, nrInEq;
+    int qldNrVars, qldNrEq, qldNrInEq;
+    bool success;
+  };
 
 private:
   Eigen::QLD qld_;
@@ -66,6 +134,31 @@ private:
 
   int nrAeqLines_;
   int nrAineqLines_;
+
+  // null space reduction, y is the variable in the equality null space
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> eqQR_;
+  Eigen::MatrixXd eqQ_, Z_, QZ_, QY_, AineqY_;
+  Eigen::VectorXd x0_, CY_, bineqY_, XLY_, XUY_, XEq_;
+  bool eqReduced_;
+  int maxAineqYLines_;
+  int qldNrVars_, qldNrEq_, qldNrInEq_;
+
+  // decomposition in independent sub-problems
+  std::vector<std::unique_ptr<SubProblem>> subProblems_;
+  std::vector<int> groups_, parent_, component_, eqComponent_, inEqComponent_;
+  // result of the decomposition or of the consensus
+  Eigen::VectorXd XDec_;
+  bool decomposed_;
+  int nrSubProblems_;
+  std::unique_ptr<WorkerPool> workers_;
+
+  // consensus ADMM, z is the consensus variable
+  std::vector<std::unique_ptr<SubProblem>> consensusProblems_;
+  std::vector<int> partition_, localIndex_;
+  Eigen::VectorXd z_, zPrev_, copies_, rhsZ_;
+  Eigen::SparseMatrix<double> QSparse_, copiesDiag_, M_;
+  Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> zLLT_;
+  double rho_;
 };
 
 } // namespace qp
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+// associated header
+#include "Tasks/QPCollisionPairs.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+// boost
+#include <boost/math/constants/constants.hpp>
+
+// RBDyn
+#include <RBDyn/FK.h>
+#include <RBDyn/MultiBody.h>
+#include <RBDyn/MultiBodyConfig.h>
+
+// Tasks
+#include "Tasks/Bounds.h"
+#include "Tasks/QPConstr.h"
+
+namespace tasks
+{
+
+namespace qp
+{
+
+SelfCollisionPairs::SelfCollisionPairs(const rbd::MultiBody & mb, std::vector<BodyPrimitive> primitives)
+: parent_(mb.parents()), moving_(static_cast<size_t>(mb.nrBodies())), primitives_(std::move(primitives)),
+  bodyIndex_(), pairs_(), unsupportedPairs_()
+{
+  // in RBDyn the joint i is the joint supporting the body i
+  for(int i = 0; i < mb.nrBodies(); ++i) { moving_[static_cast<size_t>(i)] = mb.joint(i).dof() > 0; }
+
+  bodyIndex_.reserve(primitives_.size());
+  for(const BodyPrimitive & bp : primitives_)
+  {
+    int bIndex = mb.bodyIndexByName(bp.bodyName);
+    if(std::find(bodyIndex_.begin(), bodyIndex_.end(), bIndex) != bodyIndex_.end())
+    {
+      std::ostringstream str;
+      str << "body " << bp.bodyName << " has more than one collision primitive";
+      throw std::domain_error(str.str());
+    }
+    bodyIndex_.push_back(bIndex);
+  }
+}
+
+const std::vector<SelfCollisionPair> & SelfCollisionPairs::generate(int minJointDist)
+{
+  minJointDist = std::max(minJointDist, 1);
+  pairs_.clear();
+  unsupportedPairs_.clear();
+  for(std::size_t i = 0; i < primitives_.size(); ++i)
+  {
+    for(std::size_t j = i + 1; j < primitives_.size(); ++j)
+    {
+      if(movingJointsBetween(bodyIndex_[i], bodyIndex_[j]) < minJointDist) { continue; }
+      if(hasAnalyticDistance(primitives_[i].primitive.type, primitives_[j].primitive.type))
+      {
+        pairs_.emplace_back(primitives_[i].bodyName, primitives_[j].bodyName);
+      }
+      else { unsupportedPairs_.emplace_back(primitives_[i].bodyName, primitives_[j].bodyName); }
+    }
+  }
+  return unsupportedPairs_;
+}
+
+void SelfCollisionPairs::filterUnreachable(const rbd::MultiBody & mb,
+                                           const rbd::MultiBodyConfig & mbcInit,
+                                           const QBound & bound,
+                                           int nrSamples,
+                                           double margin,
+                                           unsigned int seed)
+{
+  const double pi = boost::math::constants::pi<double>();
+
+  // find the sampling interval of each joint parameter,
+  // the root joint and mimic joints are not sampled
+  std::vector<std::vector<std::pair<double, double>>> ranges(static_cast<size_t>(mb.nrJoints()));
+  for(int i = 1; i < mb.nrJoints(); ++i)
+  {
+    const rbd::Joint & j = mb.joint(i);
+    if(j.isMimic()) { continue; }
+
+    // quaternion parameters are sampled on the unit sphere
+    int start = (j.type() == rbd::Joint::Spherical || j.type() == rbd::Joint::Free) ? 4 : 0;
+    for(int k = start; k < j.params(); ++k)
+    {
+      double l = -std::numeric_limits<double>::infinity();
+      double u = std::numeric_limits<double>::infinity();
+      if(static_cast<int>(bound.lQBound.size()) > i && static_cast<int>(bound.lQBound[i].size()) > k)
+      {
+        l = bound.lQBound[i][k];
+        u = bound.uQBound[i][k];
+      }
+      if(!std::isfinite(l) || !std::isfinite(u))
+      {
+        if(j.type() != rbd::Joint::Rev)
+        {
+          std::ostringstream str;
+          str << "joint " << j.name() << " must have finite limits to be sampled";
+          throw std::domain_error(str.str());
+        }
+        l = std::max(l, -pi);
+        u = std::min(u, pi);
+      }
+      ranges[static_cast<size_t>(i)].emplace_back(l, u);
+    }
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> pairsIndex;
+  pairsIndex.reserve(pairs_.size());
+  for(const SelfCollisionPair & p : pairs_)
+  {
+    pairsIndex.emplace_back(primitiveIndex(p.body1), primitiveIndex(p.body2));
+  }
+  std::vector<bool> reachable(pairs_.size(), false);
+
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unit(0., 1.);
+  std::normal_distribution<double> normal;
+  rbd::MultiBodyConfig mbc(mbcInit);
+  Eigen::Vector3d p1, p2;
+  for(int s = 0; s <= nrSamples; ++s)
+  {
+    // the first sample is mbcInit
+    if(s > 0)
+    {
+      for(int i = 1; i < mb.nrJoints(); ++i)
+      {
+        const rbd::Joint & j = mb.joint(i);
+        if(j.isMimic()) { continue; }
+        std::vector<double> & q = mbc.q[static_cast<size_t>(i)];
+        const auto & range = ranges[static_cast<size_t>(i)];
+        int start = j.params() - static_cast<int>(range.size());
+        if(start == 4)
+        {
+          Eigen::Vector4d quat(normal(gen), normal(gen), normal(gen), normal(gen));
+          quat.normalize();
+          for(int k = 0; k < 4; ++k) { q[static_cast<size_t>(k)] = quat(k); }
+        }
+        for(std::size_t k = 0; k < range.size(); ++k)
+        {
+          q[static_cast<size_t>(start) + k] = range[k].first + unit(gen) * (range[k].second - range[k].first);
+        }
+      }
+      for(int i = 1; i < mb.nrJoints(); ++i)
+      {
+        const rbd::Joint & j = mb.joint(i);
+        if(j.isMimic())
+        {
+          int mimicIndex = mb.jointIndexByName(j.mimicName());
+          mbc.q[static_cast<size_t>(i)][0] =
+              j.mimicMultiplier() * mbc.q[static_cast<size_t>(mimicIndex)][0] + j.mimicOffset();
+        }
+      }
+    }
+    rbd::forwardKinematics(mb, mbc);
+
+    for(std::size_t p = 0; p < pairsIndex.size(); ++p)
+    {
+      if(reachable[p]) { continue; }
+      const BodyPrimitive & bp1 = primitives_[pairsIndex[p].first];
+      const BodyPrimitive & bp2 = primitives_[pairsIndex[p].second];
+      const sva::PTransformd & X_0_b1 = mbc.bodyPosW[static_cast<size_t>(bodyIndex_[pairsIndex[p].first])];
+      const sva::PTransformd & X_0_b2 = mbc.bodyPosW[static_cast<size_t>(bodyIndex_[pairsIndex[p].second])];
+      double dist = primitiveDistance(bp1.primitive, bp1.X_b_p * X_0_b1, bp2.primitive, bp2.X_b_p * X_0_b2, p1, p2);
+      reachable[p] = dist < margin;
+    }
+  }
+
+  std::vector<SelfCollisionPair> filtered;
+  for(std::size_t p = 0; p < pairs_.size(); ++p)
+  {
+    if(reachable[p]) { filtered.push_back(pairs_[p]); }
+  }
+  pairs_ = std::move(filtered);
+}
+
+const std::vector<SelfCollisionPair> & SelfCollisionPairs::pairs() const
+{
+  return pairs_;
+}
+
+const std::vector<SelfCollisionPair> & SelfCollisionPairs::unsupportedPairs() const
+{
+  return unsupportedPairs_;
+}
+
+void SelfCollisionPairs::save(const std::string & filename) const
+{
+  std::ofstream file(filename);
+  if(!file) { throw std::runtime_error("Can't open " + filename + " for writing"); }
+  for(const SelfCollisionPair & p : pairs_) { file << p.body1 << " " << p.body2 << std::endl; }
+}
+
+void SelfCollisionPairs::load(const std::string & filename)
+{
+  std::ifstream file(filename);
+  if(!file) { throw std::runtime_error("Can't open " + filename + " for reading"); }
+
+  std::vector<SelfCollisionPair> loaded;
+  std::string b1, b2;
+  while(file >> b1 >> b2)
+  {
+    try
+    {
+      const BodyPrimitive & bp1 = primitives_[primitiveIndex(b1)];
+      const BodyPrimitive & bp2 = primitives_[primitiveIndex(b2)];
+      if(!hasAnalyticDistance(bp1.primitive.type, bp2.primitive.type))
+      {
+        throw std::domain_error("no analytic distance between " + b1 + " and " + b2 + " primitives");
+      }
+    }
+    catch(const std::domain_error & e)
+    {
+      throw std::runtime_error(filename + ": " + e.what());
+    }
+    loaded.emplace_back(b1, b2);
+  }
+  pairs_ = std::move(loaded);
+}
+
+int SelfCollisionPairs::addToConstraint(CollisionConstr & constr,
+                                        const std::vector<rbd::MultiBody> & mbs,
+                                        int rIndex,
+                                        int firstCollId,
+                                        double di,
+                                        double ds,
+                                        double damping,
+                                        double dampingOff) const
+{
+  int collId = firstCollId;
+  for(const SelfCollisionPair & p : pairs_)
+  {
+    const BodyPrimitive & bp1 = primitives_[primitiveIndex(p.body1)];
+    const BodyPrimitive & bp2 = primitives_[primitiveIndex(p.body2)];
+    constr.addCollision(mbs, collId, rIndex, bp1.bodyName, bp1.primitive, bp1.X_b_p, rIndex, bp2.bodyName,
+                        bp2.primitive, bp2.X_b_p, di, ds, damping, dampingOff);
+    ++collId;
+  }
+  return collId;
+}
+
+std::size_t SelfCollisionPairs::primitiveIndex(const std::string & bodyName) const
+{
+  for(std::size_t i = 0; i < primitives_.size(); ++i)
+  {
+    if(primitives_[i].bodyName == bodyName) { return i; }
+  }
+  throw std::domain_error("body " + bodyName + " has no collision primitive");
+}
+
+int SelfCollisionPairs::movingJointsBetween(int b1, int b2) const
+{
+  // walk up from the deepest body until reaching the common ancestor
+  auto depth = [this](int b) {
+    int d = 0;
+    for(; parent_[static_cast<size_t>(b)] != -1; b = parent_[static_cast<size_t>(b)]) { ++d; }
+    return d;
+  };
+
+  int d1 = depth(b1), d2 = depth(b2);
+  int nrMoving = 0;
+  auto up = [this, &nrMoving](int & b, int & d) {
+    if(moving_[static_cast<size_t>(b)]) { ++nrMoving; }
+    b = parent_[static_cast<size_t>(b)];
+    --d;
+  };
+  while(d1 > d2) { up(b1, d1); }
+  while(d2 > d1) { up(b2, d2); }
+  while(b1 != b2)
+  {
+    up(b1, d1);
+    up(b2, d2);
+  }
+  return nrMoving;
+}
+
+} // namespace qp
+
+} // namespace tasks
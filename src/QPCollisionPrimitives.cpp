@@ -0,0 +1,349 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+// associated header
+#include "Tasks/QPCollisionPrimitives.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+namespace
+{
+
+/// Squared norm below which two points are considered to be the same.
+constexpr double distEpsilon = 1e-16;
+
+/// Return the world position of a point expressed in the X_0_p frame.
+Eigen::Vector3d toWorld(const sva::PTransformd & X_0_p, const Eigen::Vector3d & p)
+{
+  return X_0_p.translation() + X_0_p.rotation().transpose() * p;
+}
+
+/// Return any unit vector orthogonal to v (v must not be null).
+Eigen::Vector3d anyOrthogonal(const Eigen::Vector3d & v)
+{
+  Eigen::Vector3d o = v.cross(Eigen::Vector3d::UnitX());
+  if(o.squaredNorm() < 1e-12) { o = v.cross(Eigen::Vector3d::UnitY()); }
+  return o.normalized();
+}
+
+/**
+ * Closest points between segments [a1, b1] and [a2, b2].
+ * Sphere are treated as degenerated segment.
+ * See Ericson, Real-Time Collision Detection, 5.1.9.
+ */
+void closestSegmentSegment(const Eigen::Vector3d & a1,
+                           const Eigen::Vector3d & b1,
+                           const Eigen::Vector3d & a2,
+                           const Eigen::Vector3d & b2,
+                           Eigen::Vector3d & c1,
+                           Eigen::Vector3d & c2)
+{
+  const Eigen::Vector3d d1 = b1 - a1;
+  const Eigen::Vector3d d2 = b2 - a2;
+  const Eigen::Vector3d r = a1 - a2;
+  const double a = d1.squaredNorm();
+  const double e = d2.squaredNorm();
+  const double f = d2.dot(r);
+
+  double s = 0., t = 0.;
+  if(a <= distEpsilon && e <= distEpsilon) {}
+  else if(a <= distEpsilon)
+  {
+    t = std::min(std::max(f / e, 0.), 1.);
+  }
+  else
+  {
+    const double c = d1.dot(r);
+    if(e <= distEpsilon) { s = std::min(std::max(-c / a, 0.), 1.); }
+    else
+    {
+      const double b = d1.dot(d2);
+      const double denom = a * e - b * b;
+      // parallel segments give denom == 0, any s is then valid
+      s = denom > 0. ? std::min(std::max((b * f - c * e) / denom, 0.), 1.) : 0.;
+      t = (b * s + f) / e;
+      if(t < 0.)
+      {
+        t = 0.;
+        s = std::min(std::max(-c / a, 0.), 1.);
+      }
+      else if(t > 1.)
+      {
+        t = 1.;
+        s = std::min(std::max((b - c) / a, 0.), 1.);
+      }
+    }
+  }
+
+  c1 = a1 + d1 * s;
+  c2 = a2 + d2 * t;
+}
+
+/// Sphere and capsule are handled as a segment [a, b] swept by a sphere.
+void toSegment(const CollisionPrimitive & prim,
+               const sva::PTransformd & X_0_p,
+               Eigen::Vector3d & a,
+               Eigen::Vector3d & b)
+{
+  const Eigen::Vector3d axis = X_0_p.rotation().row(2).transpose() * prim.halfLength;
+  a = X_0_p.translation() - axis;
+  b = X_0_p.translation() + axis;
+}
+
+double roundRound(const CollisionPrimitive & prim1,
+                  const sva::PTransformd & X_0_p1,
+                  const CollisionPrimitive & prim2,
+                  const sva::PTransformd & X_0_p2,
+                  Eigen::Vector3d & p1,
+                  Eigen::Vector3d & p2)
+{
+  Eigen::Vector3d a1, b1, a2, b2, c1, c2;
+  toSegment(prim1, X_0_p1, a1, b1);
+  toSegment(prim2, X_0_p2, a2, b2);
+  closestSegmentSegment(a1, b1, a2, b2, c1, c2);
+
+  Eigen::Vector3d n = c1 - c2;
+  const double centerDist = n.norm();
+  if(centerDist * centerDist > distEpsilon) { n /= centerDist; }
+  else
+  {
+    // segments are intersecting, use a direction orthogonal to the first one
+    Eigen::Vector3d axis = b1 - a1;
+    if(axis.squaredNorm() <= distEpsilon) { axis = b2 - a2; }
+    n = axis.squaredNorm() <= distEpsilon ? Eigen::Vector3d::UnitZ() : anyOrthogonal(axis);
+  }
+
+  p1 = c1 - prim1.radius * n;
+  p2 = c2 + prim2.radius * n;
+  return centerDist - prim1.radius - prim2.radius;
+}
+
+/**
+ * Closest point of the segment [a, a + u] to an axis aligned box of half size h
+ * centered at the origin.
+ * The squared distance is a piecewise quadratic of the segment parameter with
+ * at most 6 breakpoints, each piece is minimized in closed form.
+ * @return Segment parameter of the closest point.
+ */
+double closestSegmentBoxParam(const Eigen::Vector3d & a, const Eigen::Vector3d & u, const Eigen::Vector3d & h)
+{
+  double breaks[8];
+  int nrBreaks = 0;
+  breaks[nrBreaks++] = 0.;
+  for(int i = 0; i < 3; ++i)
+  {
+    if(std::abs(u(i)) > 0.)
+    {
+      for(double bound : {-h(i), h(i)})
+      {
+        double t = (bound - a(i)) / u(i);
+        if(t > 0. && t < 1.) { breaks[nrBreaks++] = t; }
+      }
+    }
+  }
+  breaks[nrBreaks++] = 1.;
+  std::sort(breaks, breaks + nrBreaks);
+
+  double bestT = 0.;
+  double bestF = std::numeric_limits<double>::infinity();
+  for(int k = 0; k + 1 < nrBreaks; ++k)
+  {
+    const double t0 = breaks[k], t1 = breaks[k + 1];
+    const double mid = 0.5 * (t0 + t1);
+    // f(t) = A t^2 + B t + C on [t0, t1]
+    double A = 0., B = 0., C = 0.;
+    for(int i = 0; i < 3; ++i)
+    {
+      const double sMid = a(i) + mid * u(i);
+      double off = 0.;
+      if(sMid > h(i)) { off = a(i) - h(i); }
+      else if(sMid < -h(i)) { off = a(i) + h(i); }
+      else { continue; }
+      A += u(i) * u(i);
+      B += 2. * u(i) * off;
+      C += off * off;
+    }
+    const double t = A > 0. ? std::min(std::max(-B / (2. * A), t0), t1) : t0;
+    const double f = (A * t + B) * t + C;
+    if(f < bestF)
+    {
+      bestF = f;
+      bestT = t;
+    }
+  }
+  return bestT;
+}
+
+/// Penetration depth of a point inside an axis aligned box of half size h.
+double boxDepth(const Eigen::Vector3d & p, const Eigen::Vector3d & h)
+{
+  return (h - p.cwiseAbs()).minCoeff();
+}
+
+double roundBox(const CollisionPrimitive & round,
+                const sva::PTransformd & X_0_r,
+                const CollisionPrimitive & box,
+                const sva::PTransformd & X_0_b,
+                Eigen::Vector3d & pr,
+                Eigen::Vector3d & pb)
+{
+  const Eigen::Matrix3d & E_b_0 = X_0_b.rotation();
+  const Eigen::Vector3d & h = box.halfExtents;
+
+  // express the segment in the box frame
+  Eigen::Vector3d a, b;
+  toSegment(round, X_0_r, a, b);
+  a = E_b_0 * (a - X_0_b.translation());
+  b = E_b_0 * (b - X_0_b.translation());
+  const Eigen::Vector3d u = b - a;
+
+  double t = closestSegmentBoxParam(a, u, h);
+  Eigen::Vector3d q = a + t * u;
+  Eigen::Vector3d qBox = q.cwiseMax(-h).cwiseMin(h);
+  Eigen::Vector3d n = q - qBox;
+  double dist = n.norm();
+
+  if(dist * dist > distEpsilon)
+  {
+    n /= dist;
+    dist -= round.radius;
+  }
+  else
+  {
+    // segment is inside the box: look for the deepest segment point.
+    // The depth is the minimum of the 6 affine functions h_i -+ (a_i + t u_i)
+    // so its maximum is reached at a segment end or where two of them cross.
+    // Flat depth regions are resolved toward the point nearest to the box center
+    // to keep the selected face stable.
+    const double uNorm2 = u.squaredNorm();
+    const double tc = uNorm2 > distEpsilon ? std::min(std::max(-a.dot(u) / uNorm2, 0.), 1.) : 0.;
+    // depth plane k is off(k) + t*slope(k)
+    Eigen::Matrix<double, 6, 1> off, slope;
+    off << h - a, h + a;
+    slope << -u, u;
+
+    double candidates[2 + 15];
+    int nrCandidates = 0;
+    candidates[nrCandidates++] = 0.;
+    candidates[nrCandidates++] = 1.;
+    for(int k = 0; k < 6; ++k)
+    {
+      for(int l = k + 1; l < 6; ++l)
+      {
+        const double dSlope = slope(k) - slope(l);
+        if(std::abs(dSlope) > 0.)
+        {
+          const double t = (off(l) - off(k)) / dSlope;
+          if(t > 0. && t < 1.) { candidates[nrCandidates++] = t; }
+        }
+      }
+    }
+
+    double bestT = tc;
+    double bestDepth = boxDepth(a + tc * u, h);
+    for(int k = 0; k < nrCandidates; ++k)
+    {
+      const double t = candidates[k];
+      const double depth = boxDepth(a + t * u, h);
+      if(depth > bestDepth + 1e-12 || (depth > bestDepth - 1e-12 && std::abs(t - tc) < std::abs(bestT - tc)))
+      {
+        bestDepth = depth;
+        bestT = t;
+      }
+    }
+    q = a + bestT * u;
+
+    int axis = 0;
+    const double depth = (h - q.cwiseAbs()).minCoeff(&axis);
+    n.setZero();
+    n(axis) = q(axis) >= 0. ? 1. : -1.;
+    qBox = q;
+    qBox(axis) = n(axis) * h(axis);
+    dist = -depth - round.radius;
+  }
+
+  // back to world frame
+  n = E_b_0.transpose() * n;
+  pb = toWorld(X_0_b, qBox);
+  pr = toWorld(X_0_b, q) - round.radius * n;
+  return dist;
+}
+
+} // namespace
+
+/**
+ *													CollisionPrimitive
+ */
+
+CollisionPrimitive::CollisionPrimitive()
+: type(Type::Sphere), radius(0.), halfLength(0.), halfExtents(Eigen::Vector3d::Zero())
+{
+}
+
+CollisionPrimitive CollisionPrimitive::sphere(double radius)
+{
+  CollisionPrimitive p;
+  p.type = Type::Sphere;
+  p.radius = radius;
+  return p;
+}
+
+CollisionPrimitive CollisionPrimitive::capsule(double length, double radius)
+{
+  CollisionPrimitive p;
+  p.type = Type::Capsule;
+  p.radius = radius;
+  p.halfLength = length / 2.;
+  return p;
+}
+
+CollisionPrimitive CollisionPrimitive::box(const Eigen::Vector3d & size)
+{
+  CollisionPrimitive p;
+  p.type = Type::Box;
+  p.halfExtents = size / 2.;
+  return p;
+}
+
+bool hasAnalyticDistance(CollisionPrimitive::Type t1, CollisionPrimitive::Type t2)
+{
+  return !(t1 == CollisionPrimitive::Type::Box && t2 == CollisionPrimitive::Type::Box);
+}
+
+double primitiveDistance(const CollisionPrimitive & prim1,
+                         const sva::PTransformd & X_0_p1,
+                         const CollisionPrimitive & prim2,
+                         const sva::PTransformd & X_0_p2,
+                         Eigen::Vector3d & p1,
+                         Eigen::Vector3d & p2)
+{
+  using Type = CollisionPrimitive::Type;
+  if(!hasAnalyticDistance(prim1.type, prim2.type))
+  {
+    throw std::domain_error("No analytic distance between two boxes");
+  }
+
+  if(prim2.type == Type::Box) { return roundBox(prim1, X_0_p1, prim2, X_0_p2, p1, p2); }
+  if(prim1.type == Type::Box)
+  {
+    // swapping the witness points keep p1 - p2 = d n with n going from prim2 to prim1
+    return roundBox(prim2, X_0_p2, prim1, X_0_p1, p2, p1);
+  }
+  return roundRound(prim1, X_0_p1, prim2, X_0_p2, p1, p2);
+}
+
+} // namespace qp
+
+} // namespace tasks
@@ -7,7 +7,10 @@
 
 // includes
 // std
+#include <cassert>
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 
 // RBDyn
 #include <RBDyn/MultiBody.h>
@@ -20,6 +23,7 @@
 
 // Tasks
 #include "Tasks/Bounds.h"
+#include "Tasks/Tasks.h"
 #include "utils.h"
 
 namespace tasks
@@ -54,8 +58,7 @@ JointLimitsConstr::JointLimitsConstr(const std::vector<rbd::MultiBody> & mbs,
                                      double step)
 : robotIndex_(robotIndex), alphaDBegin_(-1),
   alphaDOffset_(mbs[robotIndex].joint(0).dof() > 1 ? mbs[robotIndex].joint(0).dof() : 0), step_(step), qMin_(), qMax_(),
-  qVec_(), alphaVec_(), lower_(), upper_(), alphaDLower_(), alphaDUpper_(), alphaDDLower_(), alphaDDUpper_(),
-  prevAlphaD_()
+  lower_(), upper_(), alphaDLower_(), alphaDUpper_(), alphaDDLower_(), alphaDDUpper_()
 {
   assert(std::size_t(robotIndex_) < mbs.size() && robotIndex_ >= 0);
 
@@ -66,8 +69,6 @@ JointLimitsConstr::JointLimitsConstr(const std::vector<rbd::MultiBody> & mbs,
   int nrVars = mb.nrDof() - alphaDOffset_;
   qMin_.resize(nrVars);
   qMax_.resize(nrVars);
-  qVec_.resize(mb.nrParams());
-  alphaVec_.resize(mb.nrDof());
   alphaDLower_.resize(mb.nrDof());
   alphaDUpper_.resize(mb.nrDof());
   alphaDLower_.setConstant(-std::numeric_limits<double>::infinity());
@@ -76,8 +77,6 @@ JointLimitsConstr::JointLimitsConstr(const std::vector<rbd::MultiBody> & mbs,
   alphaDDUpper_.resize(mb.nrDof());
   alphaDDLower_.setConstant(-std::numeric_limits<double>::infinity());
   alphaDDUpper_.setConstant(std::numeric_limits<double>::infinity());
-  prevAlphaD_.resize(mb.nrDof());
-  prevAlphaD_.setZero();
 
   // if first joint is not managed remove it
   if(alphaDOffset_ != 0)
@@ -107,27 +106,25 @@ void JointLimitsConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs
 }
 
 void JointLimitsConstr::update(const std::vector<rbd::MultiBody> & /* mbs */,
-                               const std::vector<rbd::MultiBodyConfig> & mbcs,
-                               const SolverData & /* data */)
+                               const std::vector<rbd::MultiBodyConfig> & /* mbcs */,
+                               const SolverData & data)
 {
-  const rbd::MultiBodyConfig & mbc = mbcs[robotIndex_];
+  const Eigen::VectorXd & q = data.qVec(robotIndex_);
+  const Eigen::VectorXd & alpha = data.alphaVec(robotIndex_);
+  const Eigen::VectorXd & prevAlphaD = data.alphaDVec(robotIndex_);
 
   double dts = step_ * step_ * 0.5;
 
   int vars = int(qMin_.rows());
 
-  rbd::paramToVector(mbc.q, qVec_);
-  rbd::paramToVector(mbc.alpha, alphaVec_);
-  rbd::paramToVector(mbc.alphaD, prevAlphaD_);
-
-  lower_.noalias() = qMin_ - qVec_.tail(vars) - alphaVec_.tail(vars) * step_;
+  lower_.noalias() = qMin_ - q.tail(vars) - alpha.tail(vars) * step_;
   lower_ /= dts;
 
-  upper_.noalias() = qMax_ - qVec_.tail(vars) - alphaVec_.tail(vars) * step_;
+  upper_.noalias() = qMax_ - q.tail(vars) - alpha.tail(vars) * step_;
   upper_ /= dts;
 
-  lower_ = lower_.cwiseMax(alphaDLower_).cwiseMax(alphaDDLower_ + prevAlphaD_);
-  upper_ = upper_.cwiseMin(alphaDUpper_).cwiseMin(alphaDDUpper_ + prevAlphaD_);
+  lower_ = lower_.cwiseMax(alphaDLower_).cwiseMax(alphaDDLower_ + prevAlphaD);
+  upper_ = upper_.cwiseMin(alphaDUpper_).cwiseMin(alphaDDUpper_ + prevAlphaD);
 }
 
 std::string JointLimitsConstr::nameBound() const
@@ -204,23 +201,54 @@ DamperJointLimitsConstr::DamperJointLimitsConstr(const std::vector<rbd::MultiBod
                                                  double securityPercent,
                                                  double damperOffset,
                                                  double step)
-: robotIndex_(robotIndex), alphaDBegin_(-1), data_(), lower_(mbs[robotIndex].nrDof()), upper_(mbs[robotIndex].nrDof()),
+: robotIndex_(robotIndex), alphaDBegin_(-1), qParam_(), alphaDPos_(), min_(), max_(), minVel_(), maxVel_(), iDist_(),
+  sDist_(), damping_(), state_(), newState_(), jointQ_(), jointAlpha_(), lowDist_(), uppDist_(), dist_(), damper_(),
+  jointLower_(), jointUpper_(), lower_(mbs[robotIndex].nrDof()), upper_(mbs[robotIndex].nrDof()),
   alphaDLower_(mbs[robotIndex].nrDof()), alphaDUpper_(mbs[robotIndex].nrDof()), alphaDDLower_(mbs[robotIndex].nrDof()),
-  alphaDDUpper_(mbs[robotIndex].nrDof()), prevAlphaD_(mbs[robotIndex].nrDof()), step_(step), damperOff_(damperOffset)
+  alphaDDUpper_(mbs[robotIndex].nrDof()), step_(step), damperOff_(damperOffset)
 {
   assert(std::size_t(robotIndex_) < mbs.size() && robotIndex_ >= 0);
 
   const rbd::MultiBody & mb = mbs[robotIndex_];
 
+  int nrJoints = 0;
   for(int i = 0; i < mb.nrJoints(); ++i)
+  {
+    if(mb.joint(i).dof() == 1) { ++nrJoints; }
+  }
+
+  qParam_.resize(nrJoints);
+  alphaDPos_.resize(nrJoints);
+  min_.resize(nrJoints);
+  max_.resize(nrJoints);
+  minVel_.resize(nrJoints);
+  maxVel_.resize(nrJoints);
+  for(int i = 0, k = 0; i < mb.nrJoints(); ++i)
   {
     if(mb.joint(i).dof() == 1)
     {
-      double dist = (qBound.uQBound[i][0] - qBound.lQBound[i][0]);
-      data_.emplace_back(qBound.lQBound[i][0], qBound.uQBound[i][0], aBound.lAlphaBound[i][0], aBound.uAlphaBound[i][0],
-                         dist * interPercent, dist * securityPercent, mb.jointPosInDof(i), i);
+      qParam_[k] = mb.jointPosInParam(i);
+      alphaDPos_[k] = mb.jointPosInDof(i);
+      min_[k] = qBound.lQBound[i][0];
+      max_[k] = qBound.uQBound[i][0];
+      minVel_[k] = aBound.lAlphaBound[i][0];
+      maxVel_[k] = aBound.uAlphaBound[i][0];
+      ++k;
     }
   }
+  iDist_ = (max_ - min_) * interPercent;
+  sDist_ = (max_ - min_) * securityPercent;
+  damping_.setZero(nrJoints);
+  state_.setConstant(nrJoints, Free);
+  newState_.resize(nrJoints);
+  jointQ_.resize(nrJoints);
+  jointAlpha_.resize(nrJoints);
+  lowDist_.resize(nrJoints);
+  uppDist_.resize(nrJoints);
+  dist_.resize(nrJoints);
+  damper_.resize(nrJoints);
+  jointLower_.resize(nrJoints);
+  jointUpper_.resize(nrJoints);
 
   rbd::paramToVector(aBound.lAlphaBound, lower_);
   rbd::paramToVector(aBound.uAlphaBound, upper_);
@@ -234,7 +262,6 @@ DamperJointLimitsConstr::DamperJointLimitsConstr(const std::vector<rbd::MultiBod
   rbd::paramToVector(aDDBound.uAlphaDDBound, alphaDDUpper_);
   alphaDDLower_ *= step_;
   alphaDDUpper_ *= step_;
-  prevAlphaD_.setZero();
 }
 
 void DamperJointLimitsConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
@@ -243,53 +270,52 @@ void DamperJointLimitsConstr::updateNrVars(const std::vector<rbd::MultiBody> & /
 }
 
 void DamperJointLimitsConstr::update(const std::vector<rbd::MultiBody> & /* mbs */,
-                                     const std::vector<rbd::MultiBodyConfig> & mbcs,
-                                     const SolverData & /* data */)
+                                     const std::vector<rbd::MultiBodyConfig> & /* mbcs */,
+                                     const SolverData & data)
 {
-  const rbd::MultiBodyConfig & mbc = mbcs[robotIndex_];
-  rbd::paramToVector(mbc.alphaD, prevAlphaD_);
+  const Eigen::VectorXd & q = data.qVec(robotIndex_);
+  const Eigen::VectorXd & alpha = data.alphaVec(robotIndex_);
+  const Eigen::VectorXd & prevAlphaD = data.alphaDVec(robotIndex_);
 
-  for(DampData & d : data_)
+  for(int k = 0; k < qParam_.size(); ++k)
   {
-    double ld = mbc.q[d.jointIndex][0] - d.min;
-    double ud = d.max - mbc.q[d.jointIndex][0];
-    double alpha = mbc.alpha[d.jointIndex][0];
-
-    lower_[d.alphaDBegin] = (d.minVel - alpha) / step_;
-    upper_[d.alphaDBegin] = (d.maxVel - alpha) / step_;
-
-    if(ld < d.iDist)
-    {
-      // damper(dist) < alpha
-      // dist > 0 -> negative < alpha -> joint angle can decrease
-      // dist < 0 -> positive < alpha -> joint angle must increase
-      if(d.state != DampData::Low)
-      {
-        d.damping = std::abs(computeDamping(alpha, ld, d.iDist, d.sDist)) + damperOff_;
-        d.state = DampData::Low;
-      }
-
-      double damper = -computeDamper(ld, d.iDist, d.sDist, d.damping);
-      lower_[d.alphaDBegin] = std::max((damper - alpha) / step_, lower_[d.alphaDBegin]);
-    }
-    else if(ud < d.iDist)
-    {
-      // alpha < damper(dist)
-      // dist > 0 -> alpha < positive -> joint angle can increase
-      // dist < 0 -> alpha < negative -> joint angle must decrease
-      if(d.state != DampData::Upp)
-      {
-        d.damping = std::abs(computeDamping(alpha, ud, d.iDist, d.sDist)) + damperOff_;
-        d.state = DampData::Upp;
-      }
+    jointQ_[k] = q[qParam_[k]];
+    jointAlpha_[k] = alpha[alphaDPos_[k]];
+  }
 
-      double damper = computeDamper(ud, d.iDist, d.sDist, d.damping);
-      upper_[d.alphaDBegin] = std::min((damper - alpha) / step_, upper_[d.alphaDBegin]);
-    }
-    else { d.state = DampData::Free; }
+  lowDist_ = jointQ_ - min_;
+  uppDist_ = max_ - jointQ_;
+  jointLower_ = (minVel_ - jointAlpha_) / step_;
+  jointUpper_ = (maxVel_ - jointAlpha_) / step_;
+
+  // the lower damper has the priority when both are active
+  newState_.setConstant(Free);
+  newState_ = (uppDist_ < iDist_).select(int(Upp), newState_);
+  newState_ = (lowDist_ < iDist_).select(int(Low), newState_);
+  dist_ = (newState_ == int(Low)).select(lowDist_, uppDist_);
+
+  // the damping is computed when entering a damper zone to avoid speed jump
+  damping_ = (newState_ != state_ && newState_ != int(Free))
+                 .select(((iDist_ - sDist_) / (dist_ - sDist_) * jointAlpha_).abs() + damperOff_, damping_);
+  state_ = newState_;
+  damper_ = damping_ * ((dist_ - sDist_) / (iDist_ - sDist_));
+
+  // Low: -damper(dist) < alpha
+  // dist > 0 -> negative < alpha -> joint angle can decrease
+  // dist < 0 -> positive < alpha -> joint angle must increase
+  jointLower_ = (state_ == int(Low)).select(jointLower_.max((-damper_ - jointAlpha_) / step_), jointLower_);
+  // Upp: alpha < damper(dist)
+  // dist > 0 -> alpha < positive -> joint angle can increase
+  // dist < 0 -> alpha < negative -> joint angle must decrease
+  jointUpper_ = (state_ == int(Upp)).select(jointUpper_.min((damper_ - jointAlpha_) / step_), jointUpper_);
+
+  for(int k = 0; k < alphaDPos_.size(); ++k)
+  {
+    lower_[alphaDPos_[k]] = jointLower_[k];
+    upper_[alphaDPos_[k]] = jointUpper_[k];
   }
-  lower_ = lower_.cwiseMax(alphaDLower_).cwiseMax(alphaDDLower_ + prevAlphaD_);
-  upper_ = upper_.cwiseMin(alphaDUpper_).cwiseMin(alphaDDUpper_ + prevAlphaD_);
+  lower_ = lower_.cwiseMax(alphaDLower_).cwiseMax(alphaDDLower_ + prevAlphaD);
+  upper_ = upper_.cwiseMin(alphaDUpper_).cwiseMin(alphaDDUpper_ + prevAlphaD);
 }
 
 std::string DamperJointLimitsConstr::nameBound() const
@@ -374,12 +400,36 @@ CollisionConstr::CollData::CollData(std::vector<BodyCollData> bcds,
 {
 }
 
+CollisionConstr::CollData::CollData(std::vector<BodyCollData> bcds,
+                                    int collId,
+                                    std::vector<PrimitiveData> prims,
+                                    double di,
+                                    double ds,
+                                    double damp,
+                                    double dampOff)
+: pair(), primitives(std::move(prims)), distance(2 * di), normVecDist(Eigen::Vector3d::Zero()), di(di), ds(ds),
+  damping(damp), bodies(std::move(bcds)), dampingType(damping > 0. ? DampingType::Hard : DampingType::Free),
+  dampingOff(dampOff), collId(collId)
+{
+}
+
+CollisionConstr::PrimitiveData::PrimitiveData(const rbd::MultiBody & mb,
+                                              int rI,
+                                              const std::string & bName,
+                                              const CollisionPrimitive & prim,
+                                              const sva::PTransformd & X)
+: primitive(prim), X_op_o(X), rIndex(rI), bIndex(mb.bodyIndexByName(bName))
+{
+}
+
 CollisionConstr::CollisionConstr(const std::vector<rbd::MultiBody> & mbs, double step)
-: dataVec_(), step_(step), nrActivated_(0), totalAlphaD_(-1), AInEq_(), bInEq_(), fullJac_(), distJac_()
+: dataVec_(), step_(step), nrActivated_(0), AInEq_(), bInEq_(), fullJac_(), distJac_(), robotDof_(),
+  robotAlphaDBegin_(), robotCol_(), cols_()
 {
   int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
   fullJac_.resize(1, maxDof);
   distJac_.resize(1, maxDof);
+  for(const rbd::MultiBody & mb : mbs) { robotDof_.push_back(mb.nrDof()); }
 }
 
 void CollisionConstr::addCollision(const std::vector<rbd::MultiBody> & mbs,
@@ -415,6 +465,52 @@ void CollisionConstr::addCollision(const std::vector<rbd::MultiBody> & mbs,
   dataVec_.emplace_back(std::move(bodies), collId, body1, body2, di, ds, damping, dampingOff);
 }
 
+void CollisionConstr::addCollision(const std::vector<rbd::MultiBody> & mbs,
+                                   int collId,
+                                   int r1Index,
+                                   const std::string & r1BodyName,
+                                   const CollisionPrimitive & prim1,
+                                   const sva::PTransformd & X_op1_o1,
+                                   int r2Index,
+                                   const std::string & r2BodyName,
+                                   const CollisionPrimitive & prim2,
+                                   const sva::PTransformd & X_op2_o2,
+                                   double di,
+                                   double ds,
+                                   double damping,
+                                   double dampingOff,
+                                   const Eigen::VectorXd & r1Selector,
+                                   const Eigen::VectorXd & r2Selector)
+{
+  if(!hasAnalyticDistance(prim1.type, prim2.type))
+  {
+    std::ostringstream str;
+    str << "No analytic distance for the collision " << collId << " between " << r1BodyName << " and "
+        << r2BodyName;
+    throw std::domain_error(str.str());
+  }
+
+  const rbd::MultiBody & mb1 = mbs[static_cast<size_t>(r1Index)];
+  const rbd::MultiBody & mb2 = mbs[static_cast<size_t>(r2Index)];
+  std::vector<BodyCollData> bodies;
+  if(mb1.nrDof() > 0)
+  {
+    assert(r1Selector.size() == 0 || r1Selector.size() == mb1.nrDof());
+    bodies.emplace_back(mb1, r1Index, r1BodyName, nullptr, X_op1_o1, r1Selector);
+  }
+  if(mb2.nrDof() > 0)
+  {
+    assert(r2Selector.size() == 0 || r2Selector.size() == mb2.nrDof());
+    bodies.emplace_back(mb2, r2Index, r2BodyName, nullptr, X_op2_o2, r1Index == r2Index ? r1Selector : r2Selector);
+  }
+
+  // the primitives of fixed robots are also placed at each update
+  std::vector<PrimitiveData> prims;
+  prims.emplace_back(mb1, r1Index, r1BodyName, prim1, X_op1_o1);
+  prims.emplace_back(mb2, r2Index, r2BodyName, prim2, X_op2_o2);
+  dataVec_.emplace_back(std::move(bodies), collId, std::move(prims), di, ds, damping, dampingOff);
+}
+
 bool CollisionConstr::rmCollision(int collId)
 {
   auto it =
@@ -448,14 +544,38 @@ void CollisionConstr::reset()
 
 void CollisionConstr::updateNrCollisions()
 {
-  AInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()), nrVars_);
+  robotCol_.assign(robotDof_.size(), -1);
+  for(const CollData & d : dataVec_)
+  {
+    for(const BodyCollData & bcd : d.bodies) { robotCol_[static_cast<size_t>(bcd.rIndex)] = 0; }
+  }
+
+  // only the alphaD of the involved robots are stored in AInEq_,
+  // a robot column is only added along with its segment so they always agree
+  // and AInEq_ has no column until updateNrVars give the alphaD positions
+  int nrCols = 0;
+  cols_.clear();
+  for(std::size_t r = 0; r < robotCol_.size(); ++r)
+  {
+    if(robotCol_[r] == -1) { continue; }
+    if(r >= robotAlphaDBegin_.size())
+    {
+      robotCol_[r] = -1;
+      continue;
+    }
+    robotCol_[r] = nrCols;
+    cols_.add(robotAlphaDBegin_[r], robotDof_[r]);
+    nrCols += robotDof_[r];
+  }
+
+  AInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()), nrCols);
   bInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()));
 }
 
-void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mb */, const SolverData & data)
+void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data)
 {
-  totalAlphaD_ = data.totalAlphaD();
-  nrVars_ = data.nrVars();
+  robotAlphaDBegin_.resize(mbs.size());
+  for(std::size_t r = 0; r < mbs.size(); ++r) { robotAlphaDBegin_[r] = data.alphaDBegin(static_cast<int>(r)); }
   updateNrCollisions();
 }
 
@@ -471,18 +591,30 @@ void CollisionConstr::update(const std::vector<rbd::MultiBody> & mbs,
   nrActivated_ = 0;
   for(CollData & d : dataVec_)
   {
-    // update moving hull position
-    for(BodyCollData & bcd : d.bodies)
+    if(d.pair)
     {
-      const rbd::MultiBodyConfig & mbc = mbcs[static_cast<size_t>(bcd.rIndex)];
-      bcd.hull->setTransformation(tosch(bcd.X_op_o * mbc.bodyPosW[static_cast<size_t>(bcd.bIndex)]));
-    }
+      // update moving hull position
+      for(BodyCollData & bcd : d.bodies)
+      {
+        const rbd::MultiBodyConfig & mbc = mbcs[static_cast<size_t>(bcd.rIndex)];
+        bcd.hull->setTransformation(tosch(bcd.X_op_o * mbc.bodyPosW[static_cast<size_t>(bcd.bIndex)]));
+      }
 
-    d.distance = d.pair->getClosestPoints(pb1Tmp, pb2Tmp);
-    d.distance = d.distance >= 0 ? std::sqrt(d.distance) : -std::sqrt(-d.distance);
+      d.distance = d.pair->getClosestPoints(pb1Tmp, pb2Tmp);
+      d.distance = d.distance >= 0 ? std::sqrt(d.distance) : -std::sqrt(-d.distance);
 
-    d.p1 << pb1Tmp[0], pb1Tmp[1], pb1Tmp[2];
-    d.p2 << pb2Tmp[0], pb2Tmp[1], pb2Tmp[2];
+      d.p1 << pb1Tmp[0], pb1Tmp[1], pb1Tmp[2];
+      d.p2 << pb2Tmp[0], pb2Tmp[1], pb2Tmp[2];
+    }
+    else
+    {
+      const PrimitiveData & pd1 = d.primitives[0];
+      const PrimitiveData & pd2 = d.primitives[1];
+      d.distance = primitiveDistance(
+          pd1.primitive, pd1.X_op_o * mbcs[static_cast<size_t>(pd1.rIndex)].bodyPosW[static_cast<size_t>(pd1.bIndex)],
+          pd2.primitive, pd2.X_op_o * mbcs[static_cast<size_t>(pd2.rIndex)].bodyPosW[static_cast<size_t>(pd2.bIndex)],
+          d.p1, d.p2);
+    }
 
     Eigen::Vector3d normVecDist = (d.p1 - d.p2) / (d.distance != 0 ? d.distance : sch::epsilon);
 
@@ -517,7 +649,7 @@ void CollisionConstr::update(const std::vector<rbd::MultiBody> & mbs,
 
       double sign = 1.;
       bInEq_(nrActivated_) = dampers;
-      AInEq_.block(nrActivated_, 0, 1, totalAlphaD_).setZero();
+      AInEq_.row(nrActivated_).setZero();
       for(std::size_t i = 0; i < d.bodies.size(); ++i)
       {
         BodyCollData & bcd = d.bodies[i];
@@ -538,14 +670,15 @@ void CollisionConstr::update(const std::vector<rbd::MultiBody> & mbs,
         double jqdnd = pSpeed.dot(dnf * step_);
         double jdqdn = pNormalAcc.dot(nf * step_);
 
+        assert(robotCol_[static_cast<size_t>(bcd.rIndex)] != -1);
         if(bcd.selector.size() == 0)
         {
-          AInEq_.block(nrActivated_, data.alphaDBegin(bcd.rIndex), 1, mb.nrDof()).noalias() -=
+          AInEq_.block(nrActivated_, robotCol_[static_cast<size_t>(bcd.rIndex)], 1, mb.nrDof()).noalias() -=
               fullJac_.block(0, 0, 1, mb.nrDof());
         }
         else
         {
-          AInEq_.block(nrActivated_, data.alphaDBegin(bcd.rIndex), 1, mb.nrDof()).noalias() -=
+          AInEq_.block(nrActivated_, robotCol_[static_cast<size_t>(bcd.rIndex)], 1, mb.nrDof()).noalias() -=
               fullJac_.block(0, 0, 1, mb.nrDof()) * bcd.selector.asDiagonal();
         }
         bInEq_(nrActivated_) += sign * (jqdn + jqdnd + jdqdn);
@@ -575,8 +708,12 @@ std::string CollisionConstr::descInEq(const std::vector<rbd::MultiBody> & mbs, i
   int curLine = 0;
   for(CollData & d : dataVec_)
   {
-    double dist = d.pair->getDistance();
-    dist = dist >= 0 ? std::sqrt(dist) : -std::sqrt(-dist);
+    double dist = d.distance;
+    if(d.pair)
+    {
+      dist = d.pair->getDistance();
+      dist = dist >= 0 ? std::sqrt(dist) : -std::sqrt(-dist);
+    }
     if(dist < d.di)
     {
       if(curLine == line)
@@ -621,6 +758,11 @@ const Eigen::VectorXd & CollisionConstr::bInEq() const
   return bInEq_;
 }
 
+const ColumnSegments & CollisionConstr::columnsInEq() const
+{
+  return cols_;
+}
+
 double CollisionConstr::computeDamping(const std::vector<rbd::MultiBody> & mbs,
                                        const std::vector<rbd::MultiBodyConfig> & mbcs,
                                        const CollData & cd,
@@ -671,7 +813,7 @@ CoMIncPlaneConstr::PlaneData::PlaneData(int planeId,
 }
 
 CoMIncPlaneConstr::CoMIncPlaneConstr(const std::vector<rbd::MultiBody> & mbs, int robotIndex, double step)
-: robotIndex_(robotIndex), alphaDBegin_(-1), dataVec_(), step_(step), nrVars_(0), nrActivated_(0), activated_(0),
+: robotIndex_(robotIndex), alphaDBegin_(-1), dataVec_(), step_(step), cols_(), nrActivated_(0), activated_(0),
   jacCoM_(mbs[static_cast<size_t>(robotIndex)]), selector_(Eigen::VectorXd::Ones(jacCoM_.jacobian().cols())), AInEq_(),
   bInEq_()
 {
@@ -731,14 +873,14 @@ void CoMIncPlaneConstr::reset()
 
 void CoMIncPlaneConstr::updateNrPlanes()
 {
-  AInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()), nrVars_);
+  AInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()), jacCoM_.jacobian().cols());
   bInEq_.setZero(static_cast<Eigen::DenseIndex>(dataVec_.size()));
 }
 
 void CoMIncPlaneConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
 {
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
-  nrVars_ = data.nrVars();
+  cols_.set(alphaDBegin_, static_cast<int>(jacCoM_.jacobian().cols()));
   updateNrPlanes();
 }
 
@@ -747,10 +889,10 @@ void CoMIncPlaneConstr::update(const std::vector<rbd::MultiBody> & mbs,
                                const SolverData & data)
 {
   const rbd::MultiBody & mb = mbs[static_cast<size_t>(robotIndex_)];
-  const rbd::MultiBodyConfig & mbc = mbcs[static_cast<size_t>(robotIndex_)];
   assert(selector_.size() == mb.nrDof());
 
-  Eigen::Vector3d com = rbd::computeCoM(mb, mbc);
+  const CentroidalData & centroidal = data.centroidalCoM(mbs, mbcs, robotIndex_);
+  const Eigen::Vector3d & com = centroidal.com;
 
   for(std::size_t i = 0; i < dataVec_.size(); ++i)
   {
@@ -770,9 +912,9 @@ void CoMIncPlaneConstr::update(const std::vector<rbd::MultiBody> & mbs,
   nrActivated_ = 0;
   if(!activated_.empty())
   {
-    const Eigen::MatrixXd & jacComMat = jacCoM_.jacobian(mb, mbc);
-    Eigen::Vector3d comSpeed = jacCoM_.velocity(mb, mbc);
-    Eigen::Vector3d comNormalAcc = jacCoM_.normalAcceleration(mb, mbc, data.normalAccB(robotIndex_));
+    const Eigen::MatrixXd & jacComMat = centroidal.comJac;
+    const Eigen::Vector3d & comSpeed = centroidal.comVelocity;
+    const Eigen::Vector3d & comNormalAcc = centroidal.comNormalAcc;
 
     for(std::size_t i : activated_)
     {
@@ -793,8 +935,7 @@ void CoMIncPlaneConstr::update(const std::vector<rbd::MultiBody> & mbs,
       double dampers = d.damping * ((d.dist - d.ds) / (d.di - d.ds));
 
       // -dt*normal^T*J_com
-      AInEq_.block(nrActivated_, alphaDBegin_, 1, mb.nrDof()).noalias() = -(step_ * d.normal.transpose()) * jacComMat;
-      AInEq_.block(nrActivated_, alphaDBegin_, 1, mb.nrDof()).noalias() =
+      AInEq_.block(nrActivated_, 0, 1, mb.nrDof()).noalias() =
           -(step_ * d.normal.transpose()) * jacComMat * selector_.asDiagonal();
 
       // dampers + ddot + dt*normal^T*J*qdot
@@ -858,6 +999,11 @@ const Eigen::VectorXd & CoMIncPlaneConstr::bInEq() const
   return bInEq_;
 }
 
+const ColumnSegments & CoMIncPlaneConstr::columnsInEq() const
+{
+  return cols_;
+}
+
 /**
  *													GripperTorqueConstr
  */
@@ -870,7 +1016,7 @@ GripperTorqueConstr::GripperData::GripperData(const ContactId & cId,
 {
 }
 
-GripperTorqueConstr::GripperTorqueConstr() : dataVec_(), AInEq_(), bInEq_() {}
+GripperTorqueConstr::GripperTorqueConstr() : dataVec_(), cols_(), AInEq_(), bInEq_() {}
 
 void GripperTorqueConstr::addGripper(const ContactId & cId,
                                      double torqueLimit,
@@ -902,39 +1048,36 @@ void GripperTorqueConstr::reset()
 void GripperTorqueConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
 {
   using namespace Eigen;
-  AInEq_.setZero(dataVec_.size(), data.nrVars());
+  cols_.set(data.bilateralBegin(), data.nrBiLambda());
+  AInEq_.setZero(dataVec_.size(), data.nrBiLambda());
   bInEq_.setZero(dataVec_.size());
 
   int line = 0;
   int nrUni = int(data.unilateralContacts().size());
   for(const GripperData & gd : dataVec_)
   {
-    for(std::size_t bi = 0; bi < data.bilateralContacts().size(); ++bi)
+    // only bilateral contacts are considered
+    // if the contact is not found the AInEq_ and BInEq_ line stay at zero
+    int cIndex = data.contactIndex(gd.contactId);
+    if(cIndex < nrUni || cIndex >= int(data.allContacts().size())) { continue; }
+
+    const BilateralContact & bc = data.allContacts()[cIndex];
+    int col = data.lambdaBegin(cIndex) - data.bilateralBegin();
+    // Torque applied on the gripper motor
+    // Sum_i^nrF  T_i·( p_i^T_o x f_i)
+    for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
     {
-      const BilateralContact & bc = data.bilateralContacts()[bi];
-
-      if(bc.contactId == gd.contactId)
+      Vector3d T_o_p = bc.r1Points[i] - gd.origin;
+      for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
       {
-        int col = data.lambdaBegin(int(bi) + nrUni);
-        // Torque applied on the gripper motor
-        // Sum_i^nrF  T_i·( p_i^T_o x f_i)
-        for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
-        {
-          Vector3d T_o_p = bc.r1Points[i] - gd.origin;
-          for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
-          {
-            // we use abs because the contact force cannot apply
-            // negative torque on the gripper
-            AInEq_(line, col) = std::abs(gd.axis.transpose() * (T_o_p.cross(bc.r1Cones[i].generators[j])));
-            ++col;
-          }
-        }
-        bInEq_(line) = gd.torqueLimit;
-        ++line;
-        break;
+        // we use abs because the contact force cannot apply
+        // negative torque on the gripper
+        AInEq_(line, col) = std::abs(gd.axis.transpose() * (T_o_p.cross(bc.r1Cones[i].generators[j])));
+        ++col;
       }
-      // if the bodyId is not found the AInEq_ and BInEq_ line stay at zero
     }
+    bInEq_(line) = gd.torqueLimit;
+    ++line;
   }
 }
 
@@ -974,13 +1117,18 @@ const Eigen::VectorXd & GripperTorqueConstr::bInEq() const
   return bInEq_;
 }
 
+const ColumnSegments & GripperTorqueConstr::columnsInEq() const
+{
+  return cols_;
+}
+
 /**
  *															BoundedSpeedConstr
  */
 
 BoundedSpeedConstr::BoundedSpeedConstr(const std::vector<rbd::MultiBody> & mbs, int robotIndex, double timeStep)
-: robotIndex_(robotIndex), cont_(), fullJac_(6, mbs[robotIndex_].nrDof()), A_(), lower_(), upper_(), nrVars_(0),
-  timeStep_(timeStep)
+: robotIndex_(robotIndex), cont_(), jacMat_(6, mbs[robotIndex_].nrDof()), fullJac_(6, mbs[robotIndex_].nrDof()), A_(),
+  lower_(), upper_(), cols_(), timeStep_(timeStep)
 {
 }
 
@@ -1036,7 +1184,7 @@ void BoundedSpeedConstr::updateBoundedSpeeds()
 void BoundedSpeedConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
 {
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
-  nrVars_ = data.nrVars();
+  cols_.set(alphaDBegin_, static_cast<int>(fullJac_.cols()));
   updateNrEq();
 }
 
@@ -1059,9 +1207,11 @@ void BoundedSpeedConstr::update(const std::vector<rbd::MultiBody> & mbs,
     int rows = int(cont_[i].dof.rows());
 
     // AEq
-    const MatrixXd & jac = cont_[i].jac.bodyJacobian(mb, mbc);
+    auto jac = jacMat_.leftCols(cont_[i].jac.dof());
+    jacobianFromSweep(mb, cont_[i].jac, data.motionSubspaceW(robotIndex_),
+                      cont_[i].bodyPoint * mbc.bodyPosW[cont_[i].body], jac);
     cont_[i].jac.fullJacobian(mb, jac, fullJac_);
-    A_.block(index, alphaDBegin_, rows, mb.nrDof()).noalias() = cont_[i].dof * fullJac_;
+    A_.block(index, 0, rows, mb.nrDof()).noalias() = cont_[i].dof * fullJac_;
 
     // BEq
     Vector6d speed = cont_[i].jac.bodyVelocity(mb, mbc).vector();
@@ -1112,12 +1262,17 @@ const Eigen::VectorXd & BoundedSpeedConstr::UpperGenInEq() const
   return upper_;
 }
 
+const ColumnSegments & BoundedSpeedConstr::columnsGenInEq() const
+{
+  return cols_;
+}
+
 void BoundedSpeedConstr::updateNrEq()
 {
   int nrEq = 0;
   for(const BoundedSpeedData & c : cont_) { nrEq += int(c.dof.rows()); }
 
-  A_.setZero(nrEq, nrVars_);
+  A_.setZero(nrEq, fullJac_.cols());
   lower_.setZero(nrEq);
   upper_.setZero(nrEq);
 }
@@ -1126,8 +1281,6 @@ void BoundedSpeedConstr::updateNrEq()
  *													ImageConstr
  */
 
-ImageConstr::PointData::PointData(const Eigen::Vector2d & pt, const double d) : point2d(pt), depthEstimate(d) {}
-
 ImageConstr::RobotPointData::RobotPointData(const std::string & bn, const sva::PTransformd & X, const rbd::Jacobian & j)
 : bName(bn), X_b_p(X), jac(j)
 {
@@ -1139,34 +1292,26 @@ ImageConstr::ImageConstr(const std::vector<rbd::MultiBody> & mbs,
                          const sva::PTransformd & X_b_gaze,
                          double step,
                          double constrDirection)
-: dataVec_(), dataVecRob_(), robotIndex_(robotIndex), bodyIndex_(mbs[robotIndex].bodyIndexByName(bName)),
-  alphaDBegin_(-1), nrVars_(0), step_(step), accelFactor_(0.5 * step * step), nrActivated_(0),
-  jac_(mbs[robotIndex], bName), X_b_gaze_(X_b_gaze),
-  L_img_(new Eigen::Matrix<double, 2, 6>(Eigen::Matrix<double, 2, 6>::Zero())),
-  surfaceVelocity_(new Eigen::Matrix<double, 6, 1>(Eigen::Matrix<double, 6, 1>::Zero())),
-  L_Z_dot_(new Eigen::Matrix<double, 1, 6>(Eigen::Matrix<double, 1, 6>::Zero())),
-  L_img_dot_(new Eigen::Matrix<double, 2, 6>(Eigen::Matrix<double, 2, 6>::Zero())),
-  speed_(new Eigen::Vector2d(Eigen::Vector2d::Zero())), normalAcc_(new Eigen::Vector2d(Eigen::Vector2d::Zero())),
-  jacMat_(2, mbs[robotIndex].nrDof()), iDistMin_(new Eigen::Vector2d(Eigen::Vector2d::Zero())),
-  iDistMax_(new Eigen::Vector2d(Eigen::Vector2d::Zero())), sDistMin_(new Eigen::Vector2d(Eigen::Vector2d::Zero())),
-  sDistMax_(new Eigen::Vector2d(Eigen::Vector2d::Zero())), damping_(0.), dampingOffset_(0.), ineqInversion_(1),
-  constrDirection_(constrDirection), AInEq_(), bInEq_()
+: points2d_(2, 0), depthEstimates_(), dataVecRob_(), robotIndex_(robotIndex),
+  bodyIndex_(mbs[robotIndex].bodyIndexByName(bName)), alphaDBegin_(-1), cols_(), step_(step),
+  accelFactor_(0.5 * step * step), nrActivated_(0), jac_(mbs[robotIndex], bName), X_b_gaze_(X_b_gaze),
+  iDistMin_(new Eigen::Vector2d(Eigen::Vector2d::Zero())), iDistMax_(new Eigen::Vector2d(Eigen::Vector2d::Zero())),
+  sDistMin_(new Eigen::Vector2d(Eigen::Vector2d::Zero())), sDistMax_(new Eigen::Vector2d(Eigen::Vector2d::Zero())),
+  damping_(0.), dampingOffset_(0.), ineqInversion_(1), constrDirection_(constrDirection), LAct_(), shortJacAct_(),
+  fullJacAct_(), AInEq_(), bInEq_()
 {
 }
 
 ImageConstr::ImageConstr(const ImageConstr & rhs)
-: dataVec_(rhs.dataVec_), dataVecRob_(rhs.dataVecRob_), robotIndex_(rhs.robotIndex_), bodyIndex_(rhs.bodyIndex_),
-  alphaDBegin_(rhs.alphaDBegin_), nrVars_(rhs.nrVars_), step_(rhs.step_), accelFactor_(rhs.accelFactor_),
-  nrActivated_(rhs.nrActivated_), jac_(rhs.jac_), X_b_gaze_(rhs.X_b_gaze_),
-  L_img_(new Eigen::Matrix<double, 2, 6>(*rhs.L_img_)),
-  surfaceVelocity_(new Eigen::Matrix<double, 6, 1>(*rhs.surfaceVelocity_)),
-  L_Z_dot_(new Eigen::Matrix<double, 1, 6>(*rhs.L_Z_dot_)),
-  L_img_dot_(new Eigen::Matrix<double, 2, 6>(*rhs.L_img_dot_)), speed_(new Eigen::Vector2d(*rhs.speed_)),
-  normalAcc_(new Eigen::Vector2d(*rhs.normalAcc_)), jacMat_(rhs.jacMat_),
+: points2d_(rhs.points2d_), depthEstimates_(rhs.depthEstimates_), dataVecRob_(rhs.dataVecRob_),
+  robotIndex_(rhs.robotIndex_), bodyIndex_(rhs.bodyIndex_), alphaDBegin_(rhs.alphaDBegin_), cols_(rhs.cols_),
+  step_(rhs.step_), accelFactor_(rhs.accelFactor_), nrActivated_(rhs.nrActivated_), jac_(rhs.jac_),
+  X_b_gaze_(rhs.X_b_gaze_),
   iDistMin_(new Eigen::Vector2d(*rhs.iDistMin_)), iDistMax_(new Eigen::Vector2d(*rhs.iDistMax_)),
   sDistMin_(new Eigen::Vector2d(*rhs.sDistMin_)), sDistMax_(new Eigen::Vector2d(*rhs.sDistMax_)),
   damping_(rhs.damping_), dampingOffset_(rhs.dampingOffset_), ineqInversion_(rhs.ineqInversion_),
-  constrDirection_(rhs.constrDirection_), AInEq_(rhs.AInEq_), bInEq_(rhs.bInEq_)
+  constrDirection_(rhs.constrDirection_), LAct_(rhs.LAct_), shortJacAct_(rhs.shortJacAct_),
+  fullJacAct_(rhs.fullJacAct_), AInEq_(rhs.AInEq_), bInEq_(rhs.bInEq_)
 {
 }
 
@@ -1174,24 +1319,18 @@ ImageConstr & ImageConstr::operator=(const ImageConstr & rhs)
 {
   if(&rhs != this)
   {
-    dataVec_ = rhs.dataVec_;
+    points2d_ = rhs.points2d_;
+    depthEstimates_ = rhs.depthEstimates_;
     dataVecRob_ = rhs.dataVecRob_;
     robotIndex_ = rhs.robotIndex_;
     bodyIndex_ = rhs.bodyIndex_;
     alphaDBegin_ = rhs.alphaDBegin_;
-    nrVars_ = rhs.nrVars_;
+    cols_ = rhs.cols_;
     step_ = rhs.step_;
     accelFactor_ = rhs.accelFactor_;
     nrActivated_ = rhs.nrActivated_;
     jac_ = rhs.jac_;
     X_b_gaze_ = rhs.X_b_gaze_;
-    *L_img_ = *rhs.L_img_;
-    *surfaceVelocity_ = *rhs.surfaceVelocity_;
-    *L_Z_dot_ = *rhs.L_Z_dot_;
-    *L_img_dot_ = *rhs.L_img_dot_;
-    *speed_ = *rhs.speed_;
-    *normalAcc_ = *rhs.normalAcc_;
-    jacMat_ = rhs.jacMat_;
     *iDistMin_ = *rhs.iDistMin_;
     *iDistMax_ = *rhs.iDistMax_;
     *sDistMin_ = *rhs.sDistMin_;
@@ -1200,6 +1339,9 @@ ImageConstr & ImageConstr::operator=(const ImageConstr & rhs)
     dampingOffset_ = rhs.dampingOffset_;
     ineqInversion_ = rhs.ineqInversion_;
     constrDirection_ = rhs.constrDirection_;
+    LAct_ = rhs.LAct_;
+    shortJacAct_ = rhs.shortJacAct_;
+    fullJacAct_ = rhs.fullJacAct_;
     AInEq_ = rhs.AInEq_;
     bInEq_ = rhs.bInEq_;
   }
@@ -1208,8 +1350,12 @@ ImageConstr & ImageConstr::operator=(const ImageConstr & rhs)
 
 int ImageConstr::addPoint(const Eigen::Vector2d & point2d, const double depthEstimate)
 {
-  dataVec_.emplace_back(point2d, depthEstimate);
-  return int(dataVec_.size()) - 1;
+  const int id = static_cast<int>(points2d_.cols());
+  points2d_.conservativeResize(Eigen::NoChange, id + 1);
+  depthEstimates_.conservativeResize(id + 1);
+  points2d_.col(id) = point2d;
+  depthEstimates_(id) = depthEstimate;
+  return id;
 }
 
 int ImageConstr::addPoint(const Eigen::Vector3d & point3d)
@@ -1228,24 +1374,26 @@ void ImageConstr::addPoint(const std::vector<rbd::MultiBody> & mbs,
 
 void ImageConstr::reset()
 {
-  dataVec_.clear();
+  points2d_.resize(2, 0);
+  depthEstimates_.resize(0);
   dataVecRob_.clear();
 }
 
 void ImageConstr::updatePoint(const int pointId, const Eigen::Vector2d & point2d)
 {
-  dataVec_[pointId].point2d = point2d;
+  points2d_.col(pointId) = point2d;
 }
 
 void ImageConstr::updatePoint(const int pointId, const Eigen::Vector2d & point2d, const double depthEstimate)
 {
-  dataVec_[pointId] = PointData(point2d, depthEstimate);
+  points2d_.col(pointId) = point2d;
+  depthEstimates_(pointId) = depthEstimate;
 }
 
 void ImageConstr::updatePoint(const int pointId, const Eigen::Vector3d & point3d)
 {
   Eigen::Vector2d point2d_(point3d[0] / point3d[2], point3d[1] / point3d[2]);
-  dataVec_[pointId] = PointData(point2d_, point3d[2]);
+  updatePoint(pointId, point2d_, point3d[2]);
 }
 
 void ImageConstr::setLimits(const Eigen::Vector2d & min,
@@ -1266,47 +1414,17 @@ void ImageConstr::setLimits(const Eigen::Vector2d & min,
   dampingOffset_ = constrDirection_ * dampingOffsetPercent * damping;
 }
 
-void ImageConstr::computeComponents(const rbd::MultiBody & mb,
-                                    const rbd::MultiBodyConfig & mbc,
-                                    const SolverData & data,
-                                    const Eigen::Vector2d & point2d,
-                                    const double depth,
-                                    rbd::Jacobian & jac,
-                                    const int bodyIndex,
-                                    const sva::PTransformd & X_b_p,
-                                    Eigen::MatrixXd & fullJacobian,
-                                    Eigen::Vector2d & bCommonTerm)
-{
-  // compute speed term
-  rbd::imagePointJacobian(point2d, depth, *L_img_);
-  *surfaceVelocity_ = (jac.velocity(mb, mbc, X_b_p)).vector();
-  *speed_ = (*L_img_) * (*surfaceVelocity_);
-
-  // compute norm accel term
-  rbd::depthDotJacobian(*speed_, depth, *L_Z_dot_);
-  rbd::imagePointJacobianDot(point2d, *speed_, depth, (*L_Z_dot_) * (*surfaceVelocity_), *L_img_dot_);
-  *normalAcc_ = (*L_img_)
-                    * (jac.normalAcceleration(mb, mbc, data.normalAccB(robotIndex_), X_b_p,
-                                              sva::MotionVecd(Eigen::Vector6d::Zero())))
-                          .vector()
-                + (*L_img_dot_) * (*surfaceVelocity_);
-
-  // compute the shortened jacobian
-  const auto & shortJacMat =
-      accelFactor_ * (*L_img_) * jac.jacobian(mb, mbc, X_b_p * mbc.bodyPosW[bodyIndex]).block(0, 0, 6, jac.dof());
-
-  // fill objects to return for the QP
-  jac.fullJacobian(mb, shortJacMat, fullJacobian);
-  bCommonTerm = -step_ * (*speed_) - accelFactor_ * (*normalAcc_);
-}
-
-void ImageConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
+void ImageConstr::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data)
 {
+  const int nrDof = mbs[static_cast<size_t>(robotIndex_)].nrDof();
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
-  nrVars_ = data.nrVars();
-  int nrRows = int(2 * (dataVec_.size() + dataVecRob_.size()));
-  AInEq_.setZero(nrRows, nrVars_);
+  cols_.set(alphaDBegin_, nrDof);
+  int nrRows = maxInEq();
+  AInEq_.setZero(nrRows, nrDof);
   bInEq_.setZero(nrRows);
+  LAct_.setZero(nrRows, 6);
+  shortJacAct_.setZero(nrRows, jac_.dof());
+  fullJacAct_.setZero(nrRows, nrDof);
 }
 
 void ImageConstr::update(const std::vector<rbd::MultiBody> & mbs,
@@ -1314,78 +1432,96 @@ void ImageConstr::update(const std::vector<rbd::MultiBody> & mbs,
                          const SolverData & data)
 {
   nrActivated_ = 0;
+  if(points2d_.cols() == 0) { return; }
 
   const rbd::MultiBodyConfig & mbc = mbcs[robotIndex_];
   const rbd::MultiBody & mb = mbs[robotIndex_];
+  const double cd = constrDirection_;
 
-  // For each independent point
-  for(const PointData & ptdata : dataVec_)
-  {
-    Eigen::Vector2d point2d_ = ptdata.point2d;
+  // camera velocity and normal acceleration are shared by all the points
+  const Eigen::Vector6d surfaceVelocity = jac_.velocity(mb, mbc, X_b_gaze_).vector();
+  const Eigen::Vector6d surfaceNormalAcc = jac_.normalAcceleration(mb, mbc, data.normalAccB(robotIndex_), X_b_gaze_,
+                                                                   sva::MotionVecd(Eigen::Vector6d::Zero()))
+                                               .vector();
 
-    Eigen::Vector2d bCommonTerm;
-    computeComponents(mb, mbc, data, ptdata.point2d, ptdata.depthEstimate, jac_, bodyIndex_, X_b_gaze_, jacMat_,
-                      bCommonTerm);
+  Eigen::Matrix<double, 2, 6> L_img, L_img_dot;
+  Eigen::Matrix<double, 1, 6> L_Z_dot;
+  for(int p = 0; p < points2d_.cols(); ++p)
+  {
+    const Eigen::Vector2d point2d_ = points2d_.col(p);
 
+    // activation only depend on the point location, the interaction matrix
+    // is then only computed for points near the image limits
+    bool isConstrActive[2] = {false, false};
+    double inversion[2] = {0., 0.};
+    double dampingTerm[2] = {0., 0.};
     // For x and y
-    for(std::size_t i = 0; i < 2; ++i)
+    for(int i = 0; i < 2; ++i)
     {
-      bool isConstrActive = false;
-      std::size_t iOther = (i == 0) ? 1 : 0;
+      int iOther = (i == 0) ? 1 : 0;
 
       // check occlusion constraint if it is within the 2D image bounds
-      if((constrDirection_ == 1.)
-         || ((point2d_[iOther] > (*iDistMin_)[iOther]) && (point2d_[iOther] < (*iDistMax_)[iOther])))
+      if((cd == 1.) || ((point2d_[iOther] > (*iDistMin_)[iOther]) && (point2d_[iOther] < (*iDistMax_)[iOther])))
       {
-        if((constrDirection_ * point2d_[i] < constrDirection_ * (*iDistMin_)[i]) // check min
-           && ((constrDirection_ == 1.) || (point2d_[i] < 0.))) // handle occlusion constraint ambiquity
+        if((cd * point2d_[i] < cd * (*iDistMin_)[i]) // check min
+           && ((cd == 1.) || (point2d_[i] < 0.))) // handle occlusion constraint ambiquity
         {
-          if(constrDirection_ * point2d_[i] > constrDirection_ * (*sDistMin_)[i])
+          if(cd * point2d_[i] > cd * (*sDistMin_)[i])
           {
-            isConstrActive = true;
-            ineqInversion_ = -1. * constrDirection_;
-            bInEq_(nrActivated_) =
-                constrDirection_
-                    * (damping_ * ((point2d_[i] - (*sDistMin_)[i]) / ((*iDistMin_)[i] - (*sDistMin_)[i]))
-                       - dampingOffset_)
-                + ineqInversion_ * bCommonTerm[i];
-          }
-          else
-          {
-            // give maxmimum avoidance when in the safety limit
-            bInEq_(nrActivated_) = -constrDirection_ * dampingOffset_ + ineqInversion_ * bCommonTerm[i];
+            isConstrActive[i] = true;
+            inversion[i] = -1. * cd;
+            dampingTerm[i] =
+                cd
+                * (damping_ * ((point2d_[i] - (*sDistMin_)[i]) / ((*iDistMin_)[i] - (*sDistMin_)[i])) - dampingOffset_);
           }
         }
-        else if((constrDirection_ * point2d_[i] > constrDirection_ * (*iDistMax_)[i]) // check max
-                && ((constrDirection_ == 1.) || (point2d_[i] > 0.))) // handle occlusion constraint ambiquity
+        else if((cd * point2d_[i] > cd * (*iDistMax_)[i]) // check max
+                && ((cd == 1.) || (point2d_[i] > 0.))) // handle occlusion constraint ambiquity
         {
-          if(constrDirection_ * point2d_[i] < constrDirection_ * (*sDistMax_)[i])
-          {
-            isConstrActive = true;
-            ineqInversion_ = 1. * constrDirection_;
-            bInEq_(nrActivated_) =
-                constrDirection_
-                    * (damping_ * ((point2d_[i] - (*sDistMax_)[i]) / ((*iDistMax_)[i] - (*sDistMax_)[i]))
-                       - dampingOffset_)
-                + ineqInversion_ * bCommonTerm[i];
-          }
-          else
+          if(cd * point2d_[i] < cd * (*sDistMax_)[i])
           {
-            // give maxmimum avoidance when in the safety limit
-            bInEq_(nrActivated_) = -constrDirection_ * dampingOffset_ + ineqInversion_ * bCommonTerm[i];
+            isConstrActive[i] = true;
+            inversion[i] = 1. * cd;
+            dampingTerm[i] =
+                cd
+                * (damping_ * ((point2d_[i] - (*sDistMax_)[i]) / ((*iDistMax_)[i] - (*sDistMax_)[i])) - dampingOffset_);
           }
         }
       }
+    }
+
+    if(!isConstrActive[0] && !isConstrActive[1]) { continue; }
 
-      // fill the needed QP constraint data
-      if(isConstrActive)
+    // compute speed and normal acceleration terms
+    const double depth = depthEstimates_(p);
+    rbd::imagePointJacobian(point2d_, depth, L_img);
+    const Eigen::Vector2d speed = L_img * surfaceVelocity;
+    rbd::depthDotJacobian(speed, depth, L_Z_dot);
+    rbd::imagePointJacobianDot(point2d_, speed, depth, (L_Z_dot * surfaceVelocity).value(), L_img_dot);
+    const Eigen::Vector2d normalAcc = L_img * surfaceNormalAcc + L_img_dot * surfaceVelocity;
+    const Eigen::Vector2d bCommonTerm = -step_ * speed - accelFactor_ * normalAcc;
+
+    for(int i = 0; i < 2; ++i)
+    {
+      if(isConstrActive[i])
       {
-        // update the QP inequality constraint variables
-        AInEq_.block(nrActivated_, alphaDBegin_, 1, mb.nrDof()) = ineqInversion_ * jacMat_.block(i, 0, 1, mb.nrDof());
+        ineqInversion_ = inversion[i];
+        bInEq_(nrActivated_) = dampingTerm[i] + ineqInversion_ * bCommonTerm[i];
+        LAct_.row(nrActivated_) = (ineqInversion_ * accelFactor_) * L_img.row(i);
         ++nrActivated_;
       }
     }
   }
+
+  if(nrActivated_ > 0)
+  {
+    // the camera jacobian is multiplied once by all the activated rows
+    shortJacAct_.topRows(nrActivated_).noalias() =
+        LAct_.topRows(nrActivated_)
+        * jac_.jacobian(mb, mbc, X_b_gaze_ * mbc.bodyPosW[bodyIndex_]).block(0, 0, 6, jac_.dof());
+    jac_.fullJacobian(mb, shortJacAct_.topRows(nrActivated_), fullJacAct_);
+    AInEq_.topRows(nrActivated_) = fullJacAct_.topRows(nrActivated_);
+  }
 }
 
 std::string ImageConstr::nameInEq() const
@@ -1396,7 +1532,7 @@ std::string ImageConstr::nameInEq() const
 std::string ImageConstr::descInEq(const std::vector<rbd::MultiBody> & /* mbs */, int line)
 {
   int curLine = 0;
-  for(std::size_t i = 0; i < dataVec_.size(); ++i)
+  for(int i = 0; i < points2d_.cols(); ++i)
   {
     // For x and y
     for(std::size_t j = 0; j < 2; ++j)
@@ -1407,7 +1543,7 @@ std::string ImageConstr::descInEq(const std::vector<rbd::MultiBody> & /* mbs */,
         ss << "pointId: " << i << std::endl;
         if(j == 0) { ss << "x" << std::endl; }
         else { ss << "y" << std::endl; }
-        ss << "normalized 2d location: " << std::endl << dataVec_[i].point2d << std::endl;
+        ss << "normalized 2d location: " << std::endl << points2d_.col(i) << std::endl;
         return ss.str();
       }
       ++curLine;
@@ -1423,7 +1559,7 @@ int ImageConstr::nrInEq() const
 
 int ImageConstr::maxInEq() const
 {
-  return int(2 * (dataVec_.size() + dataVecRob_.size()));
+  return int(2 * (static_cast<std::size_t>(points2d_.cols()) + dataVecRob_.size()));
 }
 
 const Eigen::MatrixXd & ImageConstr::AInEq() const
@@ -1436,6 +1572,11 @@ const Eigen::VectorXd & ImageConstr::bInEq() const
   return bInEq_;
 }
 
+const ColumnSegments & ImageConstr::columnsInEq() const
+{
+  return cols_;
+}
+
 } // namespace qp
 
 } // namespace tasks
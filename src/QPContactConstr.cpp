@@ -14,6 +14,7 @@
 #include <RBDyn/MultiBodyConfig.h>
 
 // Tasks
+#include "Tasks/Tasks.h"
 #include "utils.h"
 
 namespace tasks
@@ -92,6 +93,11 @@ std::set<ContactConstrCommon::ContactCommon> ContactConstrCommon::contactCommonI
     if(isValid(c.contactId)) { ret.insert({c.contactId, c.X_b1_cf, c.X_b1_b2}); }
   }
 
+  for(const WrenchContact & c : data.wrenchContacts())
+  {
+    if(isValid(c.contactId)) { ret.insert({c.contactId, c.X_b1_cf, c.X_b1_b2}); }
+  }
+
   return ret;
 }
 
@@ -121,7 +127,7 @@ void ContactConstr::ContactData::update(const std::vector<rbd::MultiBodyConfig>
   X_b1_b2 = X_b2_cf.inv() * X_b1_cf;
 }
 
-ContactConstr::ContactConstr() : cont_(), fullJac_(), dofJac_(), A_(), b_(), nrEq_(0), totalAlphaD_(0) {}
+ContactConstr::ContactConstr() : cont_(), jacPool_(), fullJac_(), dofJac_(), jacMat_(), A_(), b_(), cols_(), nrEq_(0) {}
 
 void ContactConstr::updateDofContacts()
 {
@@ -137,11 +143,11 @@ void ContactConstr::updateDofContacts()
 void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data)
 {
   cont_.clear();
-  totalAlphaD_ = data.totalAlphaD();
 
   int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
   fullJac_.resize(6, maxDof);
   dofJac_.resize(6, maxDof);
+  jacMat_.resize(6, maxDof);
 
   std::set<ContactCommon> contactCSet = contactCommonInContact(mbs, data);
   for(const ContactCommon & cC : contactCSet)
@@ -151,12 +157,13 @@ void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const
     if(it != dofContacts_.end()) { dof = it->second; }
     std::vector<ContactSideData> contacts;
     auto addContact =
-        [&mbs, &data, &contacts](int rIndex, const std::string & bName, double sign, const sva::PTransformd & point)
+        [this, &mbs, &contacts](int rIndex, const std::string & bName, double sign, const sva::PTransformd & point)
     {
       if(mbs[rIndex].nrDof() > 0)
       {
-        contacts.emplace_back(rIndex, data.alphaDBegin(rIndex), sign, rbd::Jacobian(mbs[rIndex], bName), point);
-        return contacts.back().jac.jointsPath().back();
+        int jI = jacPool_.index(mbs, rIndex, bName);
+        contacts.emplace_back(rIndex, -1, sign, jacPool_[jI], jI, point);
+        return contacts.back().bodyIndex;
       }
       return mbs[rIndex].bodyIndexByName(bName);
     };
@@ -169,7 +176,27 @@ void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const
   }
   updateNrEq();
 
-  A_.setZero(cont_.size() * 6, data.nrVars());
+  // only the alphaD of the robots in contact are stored in A_
+  std::vector<int> robotCol(mbs.size(), -1);
+  for(const ContactData & c : cont_)
+  {
+    for(const ContactSideData & csd : c.contacts) { robotCol[static_cast<size_t>(csd.robotIndex)] = 0; }
+  }
+  int nrCols = 0;
+  cols_.clear();
+  for(std::size_t r = 0; r < mbs.size(); ++r)
+  {
+    if(robotCol[r] == -1) { continue; }
+    robotCol[r] = nrCols;
+    cols_.add(data.alphaDBegin(static_cast<int>(r)), mbs[r].nrDof());
+    nrCols += mbs[r].nrDof();
+  }
+  for(ContactData & c : cont_)
+  {
+    for(ContactSideData & csd : c.contacts) { csd.alphaDBegin = robotCol[static_cast<size_t>(csd.robotIndex)]; }
+  }
+
+  A_.setZero(cont_.size() * 6, nrCols);
   b_.setZero(cont_.size() * 6);
 }
 
@@ -184,8 +211,7 @@ std::string ContactConstr::descEq(const std::vector<rbd::MultiBody> & mbs, int l
   int contact = line / 6;
   for(const ContactSideData & csd : cont_[contact].contacts)
   {
-    int body = csd.jac.jointsPath().back();
-    oss << "Contact: " << mbs[csd.robotIndex].body(body).name() << std::endl;
+    oss << "Contact: " << mbs[csd.robotIndex].body(csd.bodyIndex).name() << std::endl;
   }
   return oss.str();
 }
@@ -205,6 +231,11 @@ const Eigen::VectorXd & ContactConstr::bEq() const
   return b_;
 }
 
+const ColumnSegments & ContactConstr::columnsEq() const
+{
+  return cols_;
+}
+
 void ContactConstr::updateNrEq()
 {
   nrEq_ = 0;
@@ -240,18 +271,19 @@ void ContactAccConstr::update(const std::vector<rbd::MultiBody> & mbs,
       ContactSideData & csd = cd.contacts[j];
       const rbd::MultiBody & mb = mbs[csd.robotIndex];
       const rbd::MultiBodyConfig & mbc = mbcs[csd.robotIndex];
+      rbd::Jacobian & jac = jacPool_[csd.jacIndex];
 
       // AEq = J_i
       sva::PTransformd X_0_p = csd.X_b_p * mbc.bodyPosW[csd.bodyIndex];
-      const MatrixXd & jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-      dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
-      csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()), fullJac_);
+      auto jacMat = jacMat_.leftCols(jac.dof());
+      jacobianFromSweep(mb, jac, data.motionSubspaceW(csd.robotIndex), X_0_p, jacMat);
+      dofJac_.block(0, 0, rows, jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
+      jac.fullJacobian(mb, dofJac_.block(0, 0, rows, jac.dof()), fullJac_);
       A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() += fullJac_.block(0, 0, rows, mb.nrDof());
 
       // BEq = -JD_i*alpha
-      Vector6d normalAcc = csd.jac
-                               .normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
-                                                   sva::MotionVecd(Vector6d::Zero()))
+      Vector6d normalAcc = jac.normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
+                                                  sva::MotionVecd(Vector6d::Zero()))
                                .vector();
       b_.segment(index, rows).noalias() -= csd.sign * cd.dof * normalAcc;
     }
@@ -276,7 +308,7 @@ void ContactSpeedConstr::update(const std::vector<rbd::MultiBody> & mbs,
 {
   using namespace Eigen;
 
-  A_.block(0, 0, nrEq_, totalAlphaD_).setZero();
+  A_.topRows(nrEq_).setZero();
   b_.head(nrEq_).setZero();
   // J_i*alphaD + JD_i*alpha = 0
 
@@ -293,20 +325,21 @@ void ContactSpeedConstr::update(const std::vector<rbd::MultiBody> & mbs,
       ContactSideData & csd = cd.contacts[j];
       const rbd::MultiBody & mb = mbs[csd.robotIndex];
       const rbd::MultiBodyConfig & mbc = mbcs[csd.robotIndex];
+      rbd::Jacobian & jac = jacPool_[csd.jacIndex];
 
       // AEq = J_i
       sva::PTransformd X_0_p = csd.X_b_p * mbc.bodyPosW[csd.bodyIndex];
-      const MatrixXd & jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-      dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
-      csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()), fullJac_);
+      auto jacMat = jacMat_.leftCols(jac.dof());
+      jacobianFromSweep(mb, jac, data.motionSubspaceW(csd.robotIndex), X_0_p, jacMat);
+      dofJac_.block(0, 0, rows, jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
+      jac.fullJacobian(mb, dofJac_.block(0, 0, rows, jac.dof()), fullJac_);
       A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() += fullJac_.block(0, 0, rows, mb.nrDof());
 
       // BEq = -JD_i*alpha
-      Vector6d normalAcc = csd.jac
-                               .normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
-                                                   sva::MotionVecd(Vector6d::Zero()))
+      Vector6d normalAcc = jac.normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
+                                                  sva::MotionVecd(Vector6d::Zero()))
                                .vector();
-      Vector6d velocity = csd.jac.velocity(mb, mbc, csd.X_b_p).vector();
+      Vector6d velocity = jac.velocity(mb, mbc, csd.X_b_p).vector();
       b_.segment(index, rows).noalias() -= csd.sign * cd.dof * (normalAcc + velocity / timeStep_);
     }
 
@@ -331,7 +364,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody> & mbs,
 {
   using namespace Eigen;
 
-  A_.block(0, 0, nrEq_, totalAlphaD_).setZero();
+  A_.topRows(nrEq_).setZero();
   b_.head(nrEq_).setZero();
   // J_i*alphaD + JD_i*alpha = 0
 
@@ -348,20 +381,21 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody> & mbs,
       ContactSideData & csd = cd.contacts[j];
       const rbd::MultiBody & mb = mbs[csd.robotIndex];
       const rbd::MultiBodyConfig & mbc = mbcs[csd.robotIndex];
+      rbd::Jacobian & jac = jacPool_[csd.jacIndex];
 
       // AEq = J_i
       sva::PTransformd X_0_p = csd.X_b_p * mbc.bodyPosW[csd.bodyIndex];
-      const MatrixXd & jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-      dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
-      csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()), fullJac_);
+      auto jacMat = jacMat_.leftCols(jac.dof());
+      jacobianFromSweep(mb, jac, data.motionSubspaceW(csd.robotIndex), X_0_p, jacMat);
+      dofJac_.block(0, 0, rows, jac.dof()).noalias() = csd.sign * cd.dof * jacMat;
+      jac.fullJacobian(mb, dofJac_.block(0, 0, rows, jac.dof()), fullJac_);
       A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() += fullJac_.block(0, 0, rows, mb.nrDof());
 
       // BEq = -JD_i*alpha
-      Vector6d normalAcc = csd.jac
-                               .normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
-                                                   sva::MotionVecd(Vector6d::Zero()))
+      Vector6d normalAcc = jac.normalAcceleration(mb, mbc, data.normalAccB(csd.robotIndex), csd.X_b_p,
+                                                  sva::MotionVecd(Vector6d::Zero()))
                                .vector();
-      Vector6d velocity = csd.jac.velocity(mb, mbc, csd.X_b_p).vector();
+      Vector6d velocity = jac.velocity(mb, mbc, csd.X_b_p).vector();
       b_.segment(index, rows).noalias() -= csd.sign * cd.dof * (normalAcc + velocity / timeStep_);
     }
 
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+// associated header
+#include "Tasks/QPContactJacobianPool.h"
+
+// includes
+// RBDyn
+#include <RBDyn/MultiBody.h>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+namespace
+{
+
+/// @return true if jac has been built on the current bodyIndex joints path of mb.
+bool samePath(const rbd::MultiBody & mb, int bodyIndex, const rbd::Jacobian & jac)
+{
+  // in RBDyn the joint i is the joint supporting the body i, so the path
+  // is walked backward from the body to the root
+  const std::vector<int> & path = jac.jointsPath();
+  int joint = bodyIndex;
+  int dof = 0;
+  for(auto it = path.rbegin(); it != path.rend(); ++it)
+  {
+    if(joint != *it) { return false; }
+    dof += mb.joint(joint).dof();
+    joint = mb.parent(joint);
+  }
+  return joint == -1 && dof == jac.dof();
+}
+
+} // namespace
+
+int ContactJacobianPool::index(const std::vector<rbd::MultiBody> & mbs,
+                               int robotIndex,
+                               const std::string & bodyName)
+{
+  const rbd::MultiBody & mb = mbs[robotIndex];
+  auto it = indexes_.find({robotIndex, bodyName});
+  if(it == indexes_.end())
+  {
+    jacs_.emplace_back(mb, bodyName);
+    it = indexes_.emplace(std::make_pair(robotIndex, bodyName), size() - 1).first;
+  }
+  else if(!samePath(mb, mb.bodyIndexByName(bodyName), jacs_[static_cast<std::size_t>(it->second)]))
+  {
+    jacs_[static_cast<std::size_t>(it->second)] = rbd::Jacobian(mb, bodyName);
+  }
+  return it->second;
+}
+
+} // namespace qp
+
+} // namespace tasks
@@ -7,7 +7,10 @@
 
 // includes
 // std
+#include <mutex>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 
 // Eigen
 #include <Eigen/Geometry>
@@ -48,6 +51,28 @@ FrictionCone::FrictionCone(const Eigen::Matrix3d & frame, int nrGen, double mu,
   for(int i = 0; i < nrGen; ++i) { generators[i] = Eigen::AngleAxisd(dir * step * i, normal) * gen; }
 }
 
+/**
+ *													ContactBodyName
+ */
+
+ContactBodyName::ContactBodyName(const std::string & name) : name_(name), id_(intern(name)) {}
+
+ContactBodyName & ContactBodyName::operator=(const std::string & name)
+{
+  name_ = name;
+  id_ = intern(name);
+  return *this;
+}
+
+int ContactBodyName::intern(const std::string & name)
+{
+  static std::mutex mutex;
+  static std::unordered_map<std::string, int> ids;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return ids.emplace(name, static_cast<int>(ids.size())).first->second;
+}
+
 /**
  *													ContactId
  */
@@ -61,8 +86,8 @@ ContactId::ContactId(int r1I, int r2I, const std::string & r1BName, const std::s
 
 bool ContactId::operator==(const ContactId & cId) const
 {
-  return r1Index == cId.r1Index && r2Index == cId.r2Index && r1BodyName == cId.r1BodyName
-         && r2BodyName == cId.r2BodyName && ambiguityId == cId.ambiguityId;
+  return r1Index == cId.r1Index && r2Index == cId.r2Index && r1BodyName.id() == cId.r1BodyName.id()
+         && r2BodyName.id() == cId.r2BodyName.id() && ambiguityId == cId.ambiguityId;
 }
 
 bool ContactId::operator!=(const ContactId & cId) const
@@ -72,12 +97,8 @@ bool ContactId::operator!=(const ContactId & cId) const
 
 bool ContactId::operator<(const ContactId & cId) const
 {
-  return r1Index < cId.r1Index || (r1Index == cId.r1Index && r1BodyName < cId.r1BodyName)
-         || (r1Index == cId.r1Index && r1BodyName == cId.r1BodyName && r2Index < cId.r2Index)
-         || (r1Index == cId.r1Index && r1BodyName == cId.r1BodyName && r2Index == cId.r2Index
-             && r2BodyName < cId.r2BodyName)
-         || (r1Index == cId.r1Index && r1BodyName == cId.r1BodyName && r2Index == cId.r2Index
-             && r2BodyName == cId.r2BodyName && ambiguityId < cId.ambiguityId);
+  return std::make_tuple(r1Index, r1BodyName.id(), r2Index, r2BodyName.id(), ambiguityId)
+         < std::make_tuple(cId.r1Index, cId.r1BodyName.id(), cId.r2Index, cId.r2BodyName.id(), cId.ambiguityId);
 }
 
 /**
@@ -436,6 +457,87 @@ void BilateralContact::construct(const std::vector<Eigen::Matrix3d> & r1Frames,
   }
 }
 
+/**
+ *													WrenchContact
+ */
+
+WrenchContact::WrenchContact(const ContactId & cId,
+                             const sva::PTransformd & Xbs,
+                             double hLength,
+                             double hWidth,
+                             double m,
+                             const sva::PTransformd & Xbb,
+                             const sva::PTransformd & Xbcf)
+: contactId(cId), X_b1_s(Xbs), X_b2_s(Xbs * Xbb.inv()), halfLength(hLength), halfWidth(hWidth), mu(m), cone(16, 6),
+  X_b1_b2(Xbb), X_b1_cf(Xbcf)
+{
+  const double X = halfLength;
+  const double Y = halfWidth;
+
+  // Closed form of the contact wrench cone of a rectangular surface
+  // (Caron, Pham and Nakamura, ICRA 2015), w = (tau_x, tau_y, tau_z, f_x, f_y, f_z).
+  // friction: |f_x| <= mu f_z, |f_y| <= mu f_z
+  // center of pressure: |tau_x| <= Y f_z, |tau_y| <= X f_z
+  // yaw torque: tau_min <= tau_z <= tau_max with
+  // tau_min = -mu (X + Y) f_z + |Y f_x - mu tau_x| + |X f_y - mu tau_y|
+  // tau_max = mu (X + Y) f_z - |Y f_x + mu tau_x| - |X f_y + mu tau_y|
+  // clang-format off
+  cone.topRows(8) << 0.,  0.,  0.,  1.,  0., -mu,
+                     0.,  0.,  0., -1.,  0., -mu,
+                     0.,  0.,  0.,  0.,  1., -mu,
+                     0.,  0.,  0.,  0., -1., -mu,
+                     1.,  0.,  0.,  0.,  0., -Y,
+                    -1.,  0.,  0.,  0.,  0., -Y,
+                     0.,  1.,  0.,  0.,  0., -X,
+                     0., -1.,  0.,  0.,  0., -X;
+  // clang-format on
+  int row = 8;
+  for(double s1 : {-1., 1.})
+  {
+    for(double s2 : {-1., 1.})
+    {
+      // tau_min rows
+      cone.row(row++) << -s1 * mu, -s2 * mu, -1., s1 * Y, s2 * X, -mu * (X + Y);
+      // tau_max rows
+      cone.row(row++) << s1 * mu, s2 * mu, 1., s1 * Y, s2 * X, -mu * (X + Y);
+    }
+  }
+}
+
+sva::ForceVecd WrenchContact::r1Force(const Eigen::VectorXd & lambda) const
+{
+  return X_b1_s.transMul(sva::ForceVecd(lambda.head<6>()));
+}
+
+sva::ForceVecd WrenchContact::r2Force(const Eigen::VectorXd & lambda) const
+{
+  return X_b2_s.transMul(sva::ForceVecd(-lambda.head<6>()));
+}
+
+sva::ForceVecd WrenchContact::sR1Force(const Eigen::VectorXd & lambda) const
+{
+  if(static_cast<int>(lambda.rows()) != nrLambda())
+  {
+    std::ostringstream str;
+    str << "number of lambda mismatch: expected (" << nrLambda() << ") gived (" << lambda.rows() << ")";
+    throw std::domain_error(str.str());
+  }
+
+  return r1Force(lambda);
+}
+
+sva::ForceVecd WrenchContact::sR2Force(const Eigen::VectorXd & lambda) const
+{
+  if(static_cast<int>(lambda.rows()) != nrLambda())
+  {
+    std::ostringstream str;
+    str << "number of lambda mismatch: expected (" << nrLambda() << ") gived (" << lambda.rows() << ")";
+    throw std::domain_error(str.str());
+  }
+
+  return r2Force(lambda);
+}
+
 } // namespace qp
 
 } // namespace tasks
@@ -6,6 +6,11 @@
 #include "Tasks/QPMotionConstr.h"
 
 // includes
+// std
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
 // Eigen
 #include <unsupported/Eigen/Polynomials>
 
@@ -35,6 +40,8 @@ void PositiveLambda::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */,
 
   XL_.setConstant(data.totalLambda(), 0.);
   XU_.setConstant(data.totalLambda(), std::numeric_limits<double>::infinity());
+  // wrench contacts are constrained by ContactWrenchConeConstr
+  XL_.tail(data.nrWrenchLambda()).setConstant(-std::numeric_limits<double>::infinity());
 
   cont_.clear();
   const std::vector<BilateralContact> & allC = data.allContacts();
@@ -89,28 +96,123 @@ const Eigen::VectorXd & PositiveLambda::Upper() const
   return XU_;
 }
 
+/**
+ *															ContactWrenchConeConstr
+ */
+
+ContactWrenchConeConstr::ContactWrenchConeConstr() : A_(), b_(), cols_(), cont_() {}
+
+void ContactWrenchConeConstr::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
+{
+  const std::vector<WrenchContact> & wCont = data.wrenchContacts();
+
+  int nrLines = 0;
+  for(const WrenchContact & c : wCont) { nrLines += int(c.cone.rows()); }
+
+  cols_.set(data.wrenchBegin(), data.nrWrenchLambda());
+  A_.setZero(nrLines, data.nrWrenchLambda());
+  b_.setZero(nrLines);
+
+  cont_.clear();
+  int line = 0;
+  int col = 0;
+  for(const WrenchContact & c : wCont)
+  {
+    A_.block(line, col, c.cone.rows(), c.nrLambda()) = c.cone;
+    line += int(c.cone.rows());
+    col += c.nrLambda();
+    cont_.push_back(c.contactId);
+  }
+}
+
+void ContactWrenchConeConstr::update(const std::vector<rbd::MultiBody> & /* mbs */,
+                                     const std::vector<rbd::MultiBodyConfig> & /* mbc */,
+                                     const SolverData & /* data */)
+{
+}
+
+std::string ContactWrenchConeConstr::nameInEq() const
+{
+  return "ContactWrenchConeConstr";
+}
+
+std::string ContactWrenchConeConstr::descInEq(const std::vector<rbd::MultiBody> & /* mbs */, int line)
+{
+  std::ostringstream oss;
+
+  if(line >= 0 && line < maxInEq())
+  {
+    // each cone has the same number of lines
+    const ContactId & cId = cont_[std::size_t(line / (maxInEq() / int(cont_.size())))];
+    oss << "Body 1: " << cId.r1BodyName << std::endl;
+    oss << "Body 2: " << cId.r2BodyName << std::endl;
+  }
+
+  return oss.str();
+}
+
+int ContactWrenchConeConstr::maxInEq() const
+{
+  return int(A_.rows());
+}
+
+const Eigen::MatrixXd & ContactWrenchConeConstr::AInEq() const
+{
+  return A_;
+}
+
+const Eigen::VectorXd & ContactWrenchConeConstr::bInEq() const
+{
+  return b_;
+}
+
+const ColumnSegments & ContactWrenchConeConstr::columnsInEq() const
+{
+  return cols_;
+}
+
 /**
  *															MotionConstrCommon
  */
 
-MotionConstrCommon::ContactData::ContactData(const rbd::MultiBody & mb,
-                                             const std::string & bName,
+MotionConstrCommon::ContactData::ContactData(const rbd::Jacobian & j,
+                                             int jI,
                                              int lB,
-                                             std::vector<Eigen::Vector3d> pts,
+                                             const std::vector<Eigen::Vector3d> & points,
                                              const std::vector<FrictionCone> & cones)
-: bodyIndex(), lambdaBegin(lB), jac(mb, bName), points(std::move(pts)), minusGenerators(cones.size())
+: bodyIndex(j.jointsPath().back()), lambdaBegin(lB), jacIndex(jI), minusGenerators()
 {
-  bodyIndex = jac.jointsPath().back();
+  int nrLambda = 0;
+  for(const FrictionCone & c : cones) { nrLambda += int(c.generators.size()); }
+
+  // a generator g at point p apply the (p x g, g) wrench on the body origin,
+  // so all the points of the body share the body jacobian
+  minusGenerators.resize(6, nrLambda);
+  int col = 0;
   for(std::size_t i = 0; i < cones.size(); ++i)
   {
-    minusGenerators[i].resize(3, cones[i].generators.size());
-    for(std::size_t j = 0; j < cones[i].generators.size(); ++j) { minusGenerators[i].col(j) = -cones[i].generators[j]; }
+    for(const Eigen::Vector3d & g : cones[i].generators)
+    {
+      minusGenerators.col(col).head<3>() = -points[i].cross(g);
+      minusGenerators.col(col).tail<3>() = -g;
+      ++col;
+    }
   }
 }
 
+MotionConstrCommon::ContactData::ContactData(const rbd::Jacobian & j,
+                                             int jI,
+                                             int lB,
+                                             const sva::PTransformd & X_b_s,
+                                             double sign)
+: bodyIndex(j.jointsPath().back()), lambdaBegin(lB), jacIndex(jI), minusGenerators(-sign * X_b_s.matrix().transpose())
+{
+}
+
 MotionConstrCommon::MotionConstrCommon(const std::vector<rbd::MultiBody> & mbs, int robotIndex)
-: robotIndex_(robotIndex), alphaDBegin_(-1), nrDof_(mbs[robotIndex_].nrDof()), lambdaBegin_(-1), fd_(mbs[robotIndex_]),
-  fullJacLambda_(), jacTrans_(6, nrDof_), jacLambda_(), cont_(), curTorque_(nrDof_), A_(), AL_(nrDof_), AU_(nrDof_)
+: robotIndex_(robotIndex), alphaDBegin_(-1), nrDof_(mbs[robotIndex_].nrDof()), lambdaBegin_(-1), totalLambda_(0),
+  fd_(mbs[robotIndex_]), jacLambda_(), cont_(), jacPool_(), cols_(), curTorque_(nrDof_), A_(), AL_(nrDof_),
+  AU_(nrDof_)
 {
   assert(std::size_t(robotIndex_) < mbs.size() && robotIndex_ >= 0);
   // This is technically incorrect but practically not a huge deal, see #66
@@ -121,7 +223,14 @@ void MotionConstrCommon::computeTorque(const Eigen::VectorXd & alphaD, const Eig
 {
   curTorque_ = fd_.H() * alphaD.segment(alphaDBegin_, nrDof_);
   curTorque_ += fd_.C();
-  curTorque_ += A_.block(0, lambdaBegin_, nrDof_, A_.cols() - lambdaBegin_) * lambda;
+  // lambda segments follow the alphaD one in A_
+  int col = nrDof_;
+  for(std::size_t i = 1; i < cols_.size(); ++i)
+  {
+    curTorque_ +=
+        A_.block(0, col, nrDof_, cols_[i].second) * lambda.segment(cols_[i].first - lambdaBegin_, cols_[i].second);
+    col += cols_[i].second;
+  }
 }
 
 const Eigen::VectorXd & MotionConstrCommon::torque() const
@@ -147,32 +256,63 @@ void MotionConstrCommon::torque(const std::vector<rbd::MultiBody> & mbs, std::ve
 
 void MotionConstrCommon::updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data)
 {
-  const rbd::MultiBody & mb = mbs[robotIndex_];
-
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
   lambdaBegin_ = data.lambdaBegin();
+  totalLambda_ = data.totalLambda();
+
+  // A_ only store the alphaD of the robot and the lambda of its contacts
+  cols_.set(alphaDBegin_, nrDof_);
+  int nrCols = nrDof_;
 
   cont_.clear();
   const auto & cCont = data.allContacts();
   for(std::size_t i = 0; i < cCont.size(); ++i)
   {
     const BilateralContact & c = cCont[i];
+    if(robotIndex_ != c.contactId.r1Index && robotIndex_ != c.contactId.r2Index) { continue; }
+
+    cols_.add(data.lambdaBegin(int(i)), c.nrLambda());
     if(robotIndex_ == c.contactId.r1Index)
     {
-      cont_.emplace_back(mb, c.contactId.r1BodyName, data.lambdaBegin(int(i)), c.r1Points, c.r1Cones);
+      int jI = jacPool_.index(mbs, robotIndex_, c.contactId.r1BodyName);
+      cont_.emplace_back(jacPool_[jI], jI, nrCols, c.r1Points, c.r1Cones);
     }
     // we don't use else to manage self contact on the robot
     if(robotIndex_ == c.contactId.r2Index)
     {
-      cont_.emplace_back(mb, c.contactId.r2BodyName, data.lambdaBegin(int(i)), c.r2Points, c.r2Cones);
+      int jI = jacPool_.index(mbs, robotIndex_, c.contactId.r2BodyName);
+      cont_.emplace_back(jacPool_[jI], jI, nrCols, c.r2Points, c.r2Cones);
+    }
+    nrCols += c.nrLambda();
+  }
+
+  const std::vector<WrenchContact> & wCont = data.wrenchContacts();
+  for(std::size_t i = 0; i < wCont.size(); ++i)
+  {
+    const WrenchContact & c = wCont[i];
+    if(robotIndex_ != c.contactId.r1Index && robotIndex_ != c.contactId.r2Index) { continue; }
+
+    // wrench contacts index follow the allContacts ones
+    cols_.add(data.lambdaBegin(int(cCont.size() + i)), c.nrLambda());
+    // r2 body receive the opposite wrench
+    if(robotIndex_ == c.contactId.r1Index)
+    {
+      int jI = jacPool_.index(mbs, robotIndex_, c.contactId.r1BodyName);
+      cont_.emplace_back(jacPool_[jI], jI, nrCols, c.X_b1_s, 1.);
+    }
+    if(robotIndex_ == c.contactId.r2Index)
+    {
+      int jI = jacPool_.index(mbs, robotIndex_, c.contactId.r2BodyName);
+      cont_.emplace_back(jacPool_[jI], jI, nrCols, c.X_b2_s, -1.);
     }
+    nrCols += c.nrLambda();
   }
 
-  /// @todo don't use nrDof and totalLamdba but max dof of a jacobian
-  /// and max lambda of a contact.
-  A_.setZero(nrDof_, data.nrVars());
-  jacLambda_.resize(data.totalLambda(), nrDof_);
-  fullJacLambda_.resize(data.totalLambda(), nrDof_);
+  int maxLambda = 0;
+  for(const ContactData & cd : cont_) { maxLambda = std::max(maxLambda, int(cd.minusGenerators.cols())); }
+
+  A_.setZero(nrDof_, nrCols);
+  jacLambda_.resize(nrDof_, maxLambda);
 }
 
 void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody> & mbs,
@@ -189,30 +329,26 @@ void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody> & mbs,
   // tauMin -C <= H*alphaD - J^t G lambda <= tauMax - C
 
   // fill inertia matrix part
-  A_.block(0, alphaDBegin_, nrDof_, nrDof_) = fd_.H();
+  A_.block(0, 0, nrDof_, nrDof_) = fd_.H();
 
-  for(std::size_t i = 0; i < cont_.size(); ++i)
+  // a self contact add the force applied on its two bodies in the same columns
+  A_.rightCols(A_.cols() - nrDof_).setZero();
+  for(ContactData & cd : cont_)
   {
-    const MatrixXd & jac = cont_[i].jac.bodyJacobian(mb, mbc);
-
-    ContactData & cd = cont_[i];
-    int lambdaOffset = 0;
-    for(std::size_t j = 0; j < cd.points.size(); ++j)
+    // the jacobian against lambda is J_l = J^T G with G the generators
+    // expressed at the body origin, it is written directly in the robot
+    // dof lines of A_
+    rbd::Jacobian & jacobian = jacPool_[cd.jacIndex];
+    const MatrixXd & jac = jacobian.bodyJacobian(mb, mbc);
+    int nrLambda = int(cd.minusGenerators.cols());
+    jacLambda_.block(0, 0, jacobian.dof(), nrLambda).noalias() = jac.transpose() * cd.minusGenerators;
+
+    int jacPos = 0;
+    for(int j : jacobian.jointsPath())
     {
-      int nrLambda = int(cd.minusGenerators[j].cols());
-      // we translate the jacobian to the contact point
-      // then we compute the jacobian against lambda J_l = J^T C
-      // to apply fullJacobian on it we must have robot dof on the column so
-      // J_l^T = (J^T C)^T = C^T J
-      cd.jac.translateBodyJacobian(jac, mbc, cd.points[j], jacTrans_);
-      jacLambda_.block(0, 0, nrLambda, cd.jac.dof()).noalias() =
-          (cd.minusGenerators[j].transpose() * jacTrans_.block(3, 0, 3, cd.jac.dof()));
-
-      cd.jac.fullJacobian(mb, jacLambda_.block(0, 0, nrLambda, cd.jac.dof()), fullJacLambda_);
-
-      A_.block(0, cd.lambdaBegin + lambdaOffset, nrDof_, nrLambda).noalias() =
-          fullJacLambda_.block(0, 0, nrLambda, nrDof_).transpose();
-      lambdaOffset += nrLambda;
+      int dof = mb.joint(j).dof();
+      A_.block(mb.jointPosInDof(j), cd.lambdaBegin, dof, nrLambda) += jacLambda_.block(jacPos, 0, dof, nrLambda);
+      jacPos += dof;
     }
   }
 
@@ -241,6 +377,11 @@ const Eigen::VectorXd & MotionConstrCommon::UpperGenInEq() const
   return AU_;
 }
 
+const ColumnSegments & MotionConstrCommon::columnsGenInEq() const
+{
+  return cols_;
+}
+
 std::string MotionConstrCommon::nameGenInEq() const
 {
   return "MotionConstr";
@@ -300,7 +441,15 @@ void MotionConstr::update(const std::vector<rbd::MultiBody> & mbs,
 
 Eigen::MatrixXd MotionConstr::contactMatrix() const
 {
-  return A_.block(0, nrDof_, A_.rows(), A_.cols() - nrDof_);
+  Eigen::MatrixXd contMat = Eigen::MatrixXd::Zero(A_.rows(), totalLambda_);
+  int col = nrDof_;
+  for(std::size_t i = 1; i < cols_.size(); ++i)
+  {
+    contMat.block(0, cols_[i].first - lambdaBegin_, A_.rows(), cols_[i].second) =
+        A_.block(0, col, A_.rows(), cols_[i].second);
+    col += cols_[i].second;
+  }
+  return contMat;
 }
 
 const rbd::ForwardDynamics MotionConstr::fd() const
@@ -402,6 +551,210 @@ void MotionPolyConstr::update(const std::vector<rbd::MultiBody> & mbs,
   }
 }
 
+/**
+ *															ProjectedMotionConstr
+ */
+
+ProjectedMotionConstr::ProjectedMotionConstr(const std::vector<rbd::MultiBody> & mbs,
+                                             int robotIndex,
+                                             const TorqueBound & tb,
+                                             const std::vector<BilateralContact> & rigidContacts)
+: MotionConstrCommon(mbs, robotIndex), rigidCont_(), torqueL_(nrDof_), torqueU_(nrDof_), actIndex_(), jcQR_(), jcCOD_(),
+  actSVD_(), fullJac_(6, nrDof_), jcT_(nrDof_, 6 * int(rigidContacts.size())), jcQ_(), actB_(), W_(),
+  normalAcc_(6 * int(rigidContacts.size())), rigidWrench_(Eigen::VectorXd::Zero(6 * int(rigidContacts.size()))), PA_(),
+  PL_(), PU_(), nrJcRank_(0), nrPRows_(0)
+{
+  const rbd::MultiBody & mb = mbs[robotIndex_];
+
+  rbd::paramToVector(tb.lTorqueBound, torqueL_);
+  rbd::paramToVector(tb.uTorqueBound, torqueU_);
+  for(int i = 0; i < nrDof_; ++i)
+  {
+    if(torqueL_(i) != 0. || torqueU_(i) != 0.) { actIndex_.push_back(i); }
+  }
+
+  for(const BilateralContact & c : rigidContacts)
+  {
+    const ContactId & cId = c.contactId;
+    if(cId.r1Index == robotIndex_ && mbs[cId.r2Index].nrDof() == 0)
+    {
+      rigidCont_.emplace_back(mb, cId.r1BodyName, c.X_b1_cf);
+    }
+    else if(cId.r2Index == robotIndex_ && mbs[cId.r1Index].nrDof() == 0)
+    {
+      rigidCont_.emplace_back(mb, cId.r2BodyName, c.X_b1_cf * c.X_b1_b2.inv());
+    }
+    else
+    {
+      std::ostringstream str;
+      str << "rigid contact " << cId.r1BodyName << "/" << cId.r2BodyName << " must fix a body of robot "
+          << robotIndex_ << " to a robot without dof";
+      throw std::domain_error(str.str());
+    }
+  }
+}
+
+void ProjectedMotionConstr::computeTorque(const Eigen::VectorXd & alphaD, const Eigen::VectorXd & lambda)
+{
+  // v = H alphaD + C - J^T G lambda
+  MotionConstrCommon::computeTorque(alphaD, lambda);
+  const int nrAct = static_cast<int>(actIndex_.size());
+  Eigen::VectorXd tauAct = W_.topRows(nrAct) * curTorque_;
+
+  // the rigid contacts apply the generalized force that is not actuated
+  Eigen::VectorXd genForce = curTorque_;
+  curTorque_.setZero();
+  for(int i = 0; i < nrAct; ++i) { curTorque_(actIndex_[i]) = tauAct(i); }
+  genForce -= curTorque_;
+  if(rigidCont_.empty()) { return; }
+  // ColPivHouseholderQR only return a basic solution when J_c^T is rank
+  // deficient, the complete orthogonal decomposition give the minimum norm one
+  if(nrJcRank_ == jcT_.cols()) { rigidWrench_ = jcQR_.solve(genForce); }
+  else { rigidWrench_ = jcCOD_.compute(jcT_).solve(genForce); }
+}
+
+sva::ForceVecd ProjectedMotionConstr::rigidContactWrench(int i) const
+{
+  // rigidWrench_ is expressed in the body frame
+  return rigidCont_[i].X_b_cf.dualMul(sva::ForceVecd(rigidWrench_.segment<6>(6 * i)));
+}
+
+void ProjectedMotionConstr::update(const std::vector<rbd::MultiBody> & mbs,
+                                   const std::vector<rbd::MultiBodyConfig> & mbcs,
+                                   const SolverData & data)
+{
+  using namespace Eigen;
+
+  const rbd::MultiBody & mb = mbs[robotIndex_];
+  const rbd::MultiBodyConfig & mbc = mbcs[robotIndex_];
+
+  // A_ = [H, -J^T G], AL_ = AU_ = -C
+  computeMatrix(mbs, mbcs);
+
+  // Jc^T P = [Q1 Q2] R, the body jacobian is used since a fixed body has a
+  // null body velocity and acceleration whatever the contact frame
+  for(std::size_t i = 0; i < rigidCont_.size(); ++i)
+  {
+    RigidContactData & rc = rigidCont_[i];
+    rc.jac.fullJacobian(mb, rc.jac.bodyJacobian(mb, mbc), fullJac_);
+    jcT_.middleCols(6 * i, 6) = fullJac_.transpose();
+    normalAcc_.segment<6>(6 * i) = rc.jac.bodyNormalAcceleration(mb, mbc, data.normalAccB(robotIndex_)).vector();
+  }
+
+  if(rigidCont_.empty())
+  {
+    nrJcRank_ = 0;
+    jcQ_.setIdentity(nrDof_, nrDof_);
+  }
+  else
+  {
+    jcQR_.compute(jcT_);
+    nrJcRank_ = static_cast<int>(jcQR_.rank());
+    jcQ_ = jcQR_.householderQ();
+  }
+  const int nrNull = nrDof_ - nrJcRank_;
+  const int nrAct = static_cast<int>(actIndex_.size());
+  auto Q2 = jcQ_.rightCols(nrNull);
+
+  // B = Q2^T S^T = U Sigma V^T
+  actB_.resize(nrNull, nrAct);
+  for(int i = 0; i < nrAct; ++i) { actB_.col(i) = Q2.row(actIndex_[i]).transpose(); }
+  int nrBRank = 0;
+  if(actB_.size() > 0)
+  {
+    actSVD_.setThreshold(1e-8);
+    actSVD_.compute(actB_, ComputeFullU | ComputeThinV);
+    nrBRank = static_cast<int>(actSVD_.rank());
+  }
+
+  // W = [B^+ Q2^T; U2^T Q2^T]
+  nrPRows_ = nrAct + nrNull - nrBRank;
+  W_.setZero(nrPRows_, nrDof_);
+  if(nrBRank > 0)
+  {
+    W_.topRows(nrAct).noalias() = actSVD_.matrixV().leftCols(nrBRank)
+                                  * actSVD_.singularValues().head(nrBRank).cwiseInverse().asDiagonal()
+                                  * (Q2 * actSVD_.matrixU().leftCols(nrBRank)).transpose();
+  }
+  if(nrNull > nrBRank)
+  {
+    if(actB_.size() > 0)
+    {
+      W_.bottomRows(nrNull - nrBRank).noalias() = (Q2 * actSVD_.matrixU().rightCols(nrNull - nrBRank)).transpose();
+    }
+    else { W_.bottomRows(nrNull) = Q2.transpose(); }
+  }
+
+  PA_.setZero(nrPRows_ + nrJcRank_, A_.cols());
+  PL_.resize(nrPRows_ + nrJcRank_);
+  PU_.resize(nrPRows_ + nrJcRank_);
+
+  // projected equation of motion
+  PA_.topRows(nrPRows_).noalias() = W_ * A_;
+  PL_.head(nrPRows_).noalias() = W_ * AL_;
+  PU_.head(nrPRows_) = PL_.head(nrPRows_);
+  for(int i = 0; i < nrAct; ++i)
+  {
+    PL_(i) += torqueL_(actIndex_[i]);
+    PU_(i) += torqueU_(actIndex_[i]);
+  }
+
+  // Jc alphaD = -Jc' alpha become Q1^T alphaD = R11^{-T} (-P^T Jc' alpha)
+  if(nrJcRank_ > 0)
+  {
+    VectorXd Pb = jcQR_.colsPermutation().transpose() * (-normalAcc_);
+    PA_.block(nrPRows_, 0, nrJcRank_, nrDof_) = jcQ_.leftCols(nrJcRank_).transpose();
+    PL_.tail(nrJcRank_) = jcQR_.matrixR()
+                              .topLeftCorner(nrJcRank_, nrJcRank_)
+                              .triangularView<Upper>()
+                              .transpose()
+                              .solve(Pb.head(nrJcRank_));
+    PU_.tail(nrJcRank_) = PL_.tail(nrJcRank_);
+  }
+}
+
+std::string ProjectedMotionConstr::nameGenInEq() const
+{
+  return "ProjectedMotionConstr";
+}
+
+std::string ProjectedMotionConstr::descGenInEq(const std::vector<rbd::MultiBody> & mbs, int line)
+{
+  const int nrAct = static_cast<int>(actIndex_.size());
+  if(line < nrAct)
+  {
+    int jIndex = findJointFromVector(mbs[robotIndex_], actIndex_[line], true);
+    return std::string("Joint: ") + mbs[robotIndex_].joint(jIndex).name();
+  }
+  if(line < nrPRows_) { return "Unactuated projected dynamics"; }
+  return "Rigid contacts acceleration";
+}
+
+int ProjectedMotionConstr::nrGenInEq() const
+{
+  return int(PA_.rows());
+}
+
+int ProjectedMotionConstr::maxGenInEq() const
+{
+  return nrDof_ + static_cast<int>(actIndex_.size());
+}
+
+const Eigen::MatrixXd & ProjectedMotionConstr::AGenInEq() const
+{
+  return PA_;
+}
+
+const Eigen::VectorXd & ProjectedMotionConstr::LowerGenInEq() const
+{
+  return PL_;
+}
+
+const Eigen::VectorXd & ProjectedMotionConstr::UpperGenInEq() const
+{
+  return PU_;
+}
+
 } // namespace qp
 
 } // namespace tasks
@@ -89,6 +89,14 @@ void QPSolver::updateConstrSize()
 void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
                       std::vector<UnilateralContact> uni,
                       std::vector<BilateralContact> bi)
+{
+  nrVars(mbs, std::move(uni), std::move(bi), {});
+}
+
+void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
+                      std::vector<UnilateralContact> uni,
+                      std::vector<BilateralContact> bi,
+                      std::vector<WrenchContact> wrench)
 {
   std::vector<std::tuple<int, int, double>> dependencies;
   data_.alphaD_.resize(mbs.size());
@@ -96,6 +104,7 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
 
   data_.uniCont_ = std::move(uni);
   data_.biCont_ = std::move(bi);
+  data_.wrenchCont_ = std::move(wrench);
 
   int nrContacts = data_.nrContacts();
 
@@ -104,6 +113,13 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
 
   data_.mobileRobotIndex_.clear();
   data_.normalAccB_.resize(mbs.size());
+  data_.motionSubspaceW_.resize(mbs.size());
+  data_.qVec_.resize(mbs.size());
+  data_.alphaVec_.resize(mbs.size());
+  data_.alphaDVec_.resize(mbs.size());
+  data_.centroidal_.resize(mbs.size());
+  data_.comStamp_.assign(mbs.size(), 0);
+  data_.momentumStamp_.assign(mbs.size(), 0);
 
   int cumAlphaD = 0;
   for(std::size_t r = 0; r < mbs.size(); ++r)
@@ -112,6 +128,10 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
     data_.alphaD_[r] = mb.nrDof();
     data_.alphaDBegin_[r] = cumAlphaD;
     data_.normalAccB_[r].resize(mb.nrBodies(), sva::MotionVecd(Eigen::Vector6d::Zero()));
+    data_.motionSubspaceW_[r].setZero(6, mb.nrDof());
+    data_.qVec_[r].setZero(mb.nrParams());
+    data_.alphaVec_[r].setZero(mb.nrDof());
+    data_.alphaDVec_[r].setZero(mb.nrDof());
     cumAlphaD += mb.nrDof();
     if(mb.nrDof() > 0)
     {
@@ -132,6 +152,7 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
   int cumLambda = cumAlphaD;
   int cIndex = 0;
   data_.allCont_.clear();
+  data_.contactIndex_.clear();
   // counting unilateral contact
   for(const UnilateralContact & c : data_.uniCont_)
   {
@@ -140,6 +161,7 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
     for(std::size_t p = 0; p < c.r1Points.size(); ++p) { lambda += c.nrLambda(int(p)); }
     data_.lambda_[cIndex] = lambda;
     cumLambda += lambda;
+    data_.contactIndex_.emplace(c.contactId, cIndex);
     ++cIndex;
 
     data_.allCont_.emplace_back(c);
@@ -154,20 +176,51 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody> & mbs,
     for(std::size_t p = 0; p < c.r1Points.size(); ++p) { lambda += c.nrLambda(int(p)); }
     data_.lambda_[cIndex] = lambda;
     cumLambda += lambda;
+    data_.contactIndex_.emplace(c.contactId, cIndex);
     ++cIndex;
 
     data_.allCont_.emplace_back(c);
   }
   data_.nrBiLambda_ = cumLambda - data_.nrUniLambda_ - cumAlphaD;
 
-  data_.totalLambda_ = data_.nrUniLambda_ + data_.nrBiLambda_;
+  // counting wrench contact
+  for(const WrenchContact & c : data_.wrenchCont_)
+  {
+    data_.lambdaBegin_[cIndex] = cumLambda;
+    data_.lambda_[cIndex] = c.nrLambda();
+    cumLambda += c.nrLambda();
+    data_.contactIndex_.emplace(c.contactId, cIndex);
+    ++cIndex;
+  }
+  data_.nrWrenchLambda_ = cumLambda - data_.nrBiLambda_ - data_.nrUniLambda_ - cumAlphaD;
+
+  data_.totalLambda_ = data_.nrUniLambda_ + data_.nrBiLambda_ + data_.nrWrenchLambda_;
   data_.nrVars_ = data_.totalAlphaD_ + data_.totalLambda_;
 
   for(Task * t : tasks_) { t->updateNrVars(mbs, data_); }
 
   for(Constraint * c : constr_) { c->updateNrVars(mbs, data_); }
 
+  // the variables of a robot and the forces it applies are in the robot group,
+  // robots are only coupled by the tasks and constraints lines
+  std::vector<int> varGroups(static_cast<size_t>(data_.nrVars_), -1);
+  for(std::size_t r = 0; r < mbs.size(); ++r)
+  {
+    std::fill_n(varGroups.begin() + data_.alphaDBegin_[r], data_.alphaD_[r], int(r));
+  }
+  auto contactGroup = [this, &varGroups](const ContactId & cId, int cIndex) {
+    int r = data_.alphaD_[cId.r1Index] > 0 ? cId.r1Index : cId.r2Index;
+    if(data_.alphaD_[r] > 0)
+    {
+      std::fill_n(varGroups.begin() + data_.lambdaBegin_[cIndex], data_.lambda_[cIndex], r);
+    }
+  };
+  cIndex = 0;
+  for(const BilateralContact & c : data_.allCont_) { contactGroup(c.contactId, cIndex++); }
+  for(const WrenchContact & c : data_.wrenchCont_) { contactGroup(c.contactId, cIndex++); }
+
   solver_->setDependencies(data_.nrVars_, dependencies);
+  solver_->setVariableGroups(std::move(varGroups));
   solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
 }
 
@@ -306,7 +359,23 @@ int QPSolver::nrTasks() const
 
 void QPSolver::solver(const std::string & name)
 {
+  bool nullSpace = solver_->nullSpaceReduction();
+  bool decomp = solver_->decomposition();
+  bool consensus = solver_->consensus();
+  double rho = solver_->consensusRho();
+  double tolerance = solver_->consensusTolerance();
+  int maxIter = solver_->consensusMaxIter();
+  double admmAbsTol = solver_->admmAbsTolerance();
+  double admmRelTol = solver_->admmRelTolerance();
+  int admmMaxIter = solver_->admmMaxIter();
+  std::vector<int> varGroups = solver_->variableGroups();
   solver_ = std::unique_ptr<GenQPSolver>(createQPSolver(name));
+  solver_->nullSpaceReduction(nullSpace);
+  solver_->decomposition(decomp);
+  solver_->consensus(consensus);
+  solver_->consensusParameters(rho, tolerance, maxIter);
+  solver_->admmParameters(admmAbsTol, admmRelTol, admmMaxIter);
+  solver_->setVariableGroups(std::move(varGroups));
   solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
 }
 
@@ -315,6 +384,56 @@ std::string QPSolver::solver() const
   return solver_->name();
 }
 
+void QPSolver::nullSpaceReduction(bool enable)
+{
+  solver_->nullSpaceReduction(enable);
+}
+
+bool QPSolver::nullSpaceReduction() const
+{
+  return solver_->nullSpaceReduction();
+}
+
+void QPSolver::decomposition(bool enable)
+{
+  solver_->decomposition(enable);
+}
+
+bool QPSolver::decomposition() const
+{
+  return solver_->decomposition();
+}
+
+int QPSolver::nrSubProblems() const
+{
+  return solver_->nrSubProblems();
+}
+
+void QPSolver::consensus(bool enable)
+{
+  solver_->consensus(enable);
+}
+
+bool QPSolver::consensus() const
+{
+  return solver_->consensus();
+}
+
+void QPSolver::consensusParameters(double rho, double tolerance, int maxIter)
+{
+  solver_->consensusParameters(rho, tolerance, maxIter);
+}
+
+void QPSolver::admmParameters(double absTol, double relTol, int maxIter)
+{
+  solver_->admmParameters(absTol, relTol, maxIter);
+}
+
+int QPSolver::nrIterations() const
+{
+  return solver_->nrIterations();
+}
+
 void QPSolver::resetTasks()
 {
   tasks_.clear();
@@ -357,16 +476,8 @@ Eigen::VectorXd QPSolver::lambdaVec(int cIndex) const
 
 int QPSolver::contactLambdaPosition(const ContactId & cId) const
 {
-  int pos = 0;
-
-  for(const BilateralContact & bc : data_.allContacts())
-  {
-    if(bc.contactId == cId) { return pos; }
-
-    for(std::size_t i = 0; i < bc.r1Points.size(); ++i) { pos += bc.nrLambda(int(i)); }
-  }
-
-  return -1;
+  int cIndex = data_.contactIndex(cId);
+  return cIndex != -1 ? data_.lambdaBegin(cIndex) - data_.lambdaBegin() : -1;
 }
 
 boost::timer::cpu_times QPSolver::solveTime() const
@@ -381,7 +492,8 @@ boost::timer::cpu_times QPSolver::solveAndBuildTime() const
 
 void QPSolver::preUpdate(const std::vector<rbd::MultiBody> & mbs, const std::vector<rbd::MultiBodyConfig> & mbcs)
 {
-  data_.computeNormalAccB(mbs, mbcs);
+  ++data_.tick_;
+  data_.computeKinematics(mbs, mbcs);
   for(std::size_t i = 0; i < constr_.size(); ++i) { constr_[i]->update(mbs, mbcs, data_); }
 
   for(std::size_t i = 0; i < tasks_.size(); ++i) { tasks_[i]->update(mbs, mbcs, data_); }
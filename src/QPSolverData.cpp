@@ -6,6 +6,9 @@
 #include "Tasks/QPSolverData.h"
 
 // includes
+// std
+#include <atomic>
+
 // RBDyn
 #include <RBDyn/MultiBody.h>
 #include <RBDyn/MultiBodyConfig.h>
@@ -16,21 +19,41 @@ namespace tasks
 namespace qp
 {
 
+namespace
+{
+
+std::atomic<unsigned long long> lastEpoch(0);
+
+} // namespace
+
+SolverData::Epoch::Epoch() : value(++lastEpoch) {}
+
+SolverData::Epoch::Epoch(const Epoch &) : value(++lastEpoch) {}
+
 SolverData::SolverData()
-: alphaD_(), alphaDBegin_(), lambda_(), totalAlphaD_(0), totalLambda_(0), nrUniLambda_(0), nrBiLambda_(0), nrVars_(0),
-  uniCont_(), biCont_(), allCont_(), mobileRobotIndex_(), normalAccB_()
+: alphaD_(), alphaDBegin_(), lambda_(), totalAlphaD_(0), totalLambda_(0), nrUniLambda_(0), nrBiLambda_(0),
+  nrWrenchLambda_(0), nrVars_(0), uniCont_(), biCont_(), allCont_(), wrenchCont_(), contactIndex_(),
+  mobileRobotIndex_(), normalAccB_(), qVec_(), alphaVec_(), alphaDVec_(), motionSubspaceW_(), kinematicsStamp_(1),
+  centroidal_(), comStamp_(), momentumStamp_(), subtreeInertia_(), tick_(0), epoch_()
 {
 }
 
-void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody> & mbs,
+void SolverData::computeKinematics(const std::vector<rbd::MultiBody> & mbs,
                                    const std::vector<rbd::MultiBodyConfig> & mbcs)
 {
-  // we just need to update mobile robot normal acceleration
+  ++kinematicsStamp_;
+
+  // we just need to update mobile robot kinematics
   for(int r : mobileRobotIndex_)
   {
     const rbd::MultiBody & mb = mbs[r];
     const rbd::MultiBodyConfig & mbc = mbcs[r];
     std::vector<sva::MotionVecd> & normalAccBr = normalAccB_[r];
+    Eigen::MatrixXd & motionSubspaceWr = motionSubspaceW_[r];
+
+    rbd::paramToVector(mbc.q, qVec_[r]);
+    rbd::paramToVector(mbc.alpha, alphaVec_[r]);
+    rbd::paramToVector(mbc.alphaD, alphaDVec_[r]);
 
     const std::vector<int> & pred = mb.predecessors();
     const std::vector<int> & succ = mb.successors();
@@ -45,10 +68,128 @@ void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody> & mbs,
         normalAccBr[succ[i]] = X_p_i * normalAccBr[pred[i]] + vb_i.cross(vj_i);
       else
         normalAccBr[succ[i]] = vb_i.cross(vj_i);
+
+      // S_0 = X_0_i^-1 S_i
+      const sva::PTransformd & X_0_i = mbc.bodyPosW[succ[i]];
+      const Eigen::MatrixXd & S_i = mbc.motionSubspace[i];
+      int pos = mb.jointPosInDof(i);
+      for(int d = 0; d < mb.joint(i).dof(); ++d)
+      {
+        motionSubspaceWr.col(pos + d) = X_0_i.invMul(sva::MotionVecd(S_i.col(d))).vector();
+      }
     }
   }
 }
 
+void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody> & mbs,
+                                   const std::vector<rbd::MultiBodyConfig> & mbcs)
+{
+  computeKinematics(mbs, mbcs);
+}
+
+const CentroidalData & SolverData::centroidalCoM(const std::vector<rbd::MultiBody> & mbs,
+                                                 const std::vector<rbd::MultiBodyConfig> & mbcs,
+                                                 int robotIndex) const
+{
+  if(comStamp_[robotIndex] != kinematicsStamp_)
+  {
+    computeCentroidal(mbs[robotIndex], mbcs[robotIndex], robotIndex, false);
+  }
+  return centroidal_[robotIndex];
+}
+
+const CentroidalData & SolverData::centroidalMomentum(const std::vector<rbd::MultiBody> & mbs,
+                                                      const std::vector<rbd::MultiBodyConfig> & mbcs,
+                                                      int robotIndex) const
+{
+  if(momentumStamp_[robotIndex] != kinematicsStamp_)
+  {
+    computeCentroidal(mbs[robotIndex], mbcs[robotIndex], robotIndex, true);
+  }
+  return centroidal_[robotIndex];
+}
+
+void SolverData::computeCentroidal(const rbd::MultiBody & mb,
+                                   const rbd::MultiBodyConfig & mbc,
+                                   int robotIndex,
+                                   bool momentum) const
+{
+  CentroidalData & cd = centroidal_[robotIndex];
+  const std::vector<sva::MotionVecd> & normalAccBr = normalAccB_[robotIndex];
+  const Eigen::MatrixXd & motionSubspaceWr = motionSubspaceW_[robotIndex];
+  const int nrBodies = mb.nrBodies();
+
+  // world frame inertia of each body, body velocity and normal acceleration
+  // are expressed in the world frame at the origin to be summed
+  subtreeInertia_.resize(static_cast<size_t>(nrBodies));
+  Eigen::Vector3d mVel(Eigen::Vector3d::Zero()), mNormalAcc(Eigen::Vector3d::Zero());
+  sva::ForceVecd h0(Eigen::Vector6d::Zero()), hDot0(Eigen::Vector6d::Zero());
+  for(int b = 0; b < nrBodies; ++b)
+  {
+    const sva::PTransformd & X_0_b = mbc.bodyPosW[b];
+    const sva::RBInertiad I_0 = X_0_b.transMul(mb.body(b).inertia());
+    subtreeInertia_[b] = I_0;
+
+    const double m = I_0.mass();
+    if(m <= 0.) { continue; }
+    const Eigen::Vector3d c = I_0.momentum() / m;
+    const sva::MotionVecd v_0 = X_0_b.invMul(mbc.bodyVelB[b]);
+    const sva::MotionVecd aN_0 = X_0_b.invMul(normalAccBr[b]);
+
+    // classical velocity and normal acceleration of the body CoM
+    const Eigen::Vector3d v_c = v_0.linear() + v_0.angular().cross(c);
+    mVel += m * v_c;
+    mNormalAcc += m * (aN_0.linear() + aN_0.angular().cross(c) + v_0.angular().cross(v_c));
+
+    if(momentum)
+    {
+      const sva::ForceVecd h_b = I_0 * v_0;
+      h0 = h0 + h_b;
+      hDot0 = hDot0 + I_0 * aN_0 + v_0.crossDual(h_b);
+    }
+  }
+
+  // accumulate the inertia of each subtree, parents are always before their children
+  const std::vector<int> & parents = mb.parents();
+  for(int b = nrBodies - 1; b > 0; --b)
+  {
+    if(parents[b] != -1) { subtreeInertia_[parents[b]] = subtreeInertia_[parents[b]] + subtreeInertia_[b]; }
+  }
+
+  const double totalMass = subtreeInertia_[0].mass();
+  cd.com = subtreeInertia_[0].momentum() / totalMass;
+  cd.comVelocity = mVel / totalMass;
+  cd.comNormalAcc = mNormalAcc / totalMass;
+
+  // a joint move all the bodies of its subtree: the momentum of a motion
+  // subspace column is the column applied to the subtree inertia,
+  // the CoM jacobian is the linear part of this momentum over the total mass
+  const sva::PTransformd X_0_com(cd.com);
+  cd.comJac.resize(3, mb.nrDof());
+  if(momentum) { cd.momentumMatrix.resize(6, mb.nrDof()); }
+  for(int i = 0; i < mb.nrJoints(); ++i)
+  {
+    const sva::RBInertiad & I_sub = subtreeInertia_[i];
+    int pos = mb.jointPosInDof(i);
+    for(int d = 0; d < mb.joint(i).dof(); ++d)
+    {
+      const sva::ForceVecd h = I_sub * sva::MotionVecd(motionSubspaceWr.col(pos + d));
+      cd.comJac.col(pos + d) = h.force() / totalMass;
+      if(momentum) { cd.momentumMatrix.col(pos + d) = X_0_com.dualMul(h).vector(); }
+    }
+  }
+  comStamp_[robotIndex] = kinematicsStamp_;
+
+  if(momentum)
+  {
+    cd.momentum = X_0_com.dualMul(h0);
+    // the CoM frame velocity doesn't add any term since the linear momentum
+    // is colinear with the CoM velocity
+    cd.normalMomentumDot = X_0_com.dualMul(hDot0);
+    momentumStamp_[robotIndex] = kinematicsStamp_;
+  }
+}
+
 } // namespace qp
 
 } // namespace tasks
@@ -7,9 +7,13 @@
 
 // includes
 // std
+#include <algorithm>
 #include <cmath>
 #include <iterator>
 #include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 
 // Eigen
 #include <Eigen/Geometry>
@@ -63,15 +67,74 @@ void SetPointTaskCommon::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs
 
 void SetPointTaskCommon::computeQC(Eigen::VectorXd & error)
 {
-  const Eigen::MatrixXd & J = hlTask_->jac();
-  const Eigen::VectorXd & normalAcc = hlTask_->normalAcc();
+  // almost all the high level tasks have a 2, 3 or 6 rows jacobian
+  switch(error.rows())
+  {
+    case 2:
+      computeQCDim<2>(error);
+      break;
+    case 3:
+      computeQCDim<3>(error);
+      break;
+    case 6:
+      computeQCDim<6>(error);
+      break;
+    default:
+      computeQCDim<Eigen::Dynamic>(error);
+  }
+}
 
-  error.noalias() -= normalAcc;
-  preC_.noalias() = dimWeight_.asDiagonal() * error;
-  C_.noalias() = -J.transpose() * preC_;
+template<int Dim>
+void SetPointTaskCommon::computeQCDim(Eigen::VectorXd & error)
+{
+  typedef Eigen::Matrix<double, Dim, 1> VectorDim;
+  typedef Eigen::Matrix<double, Dim, Eigen::Dynamic> MatrixDim;
 
-  preQ_.noalias() = dimWeight_.asDiagonal() * J;
-  Q_.noalias() = J.transpose() * preQ_;
+  const int dim = static_cast<int>(error.rows());
+  const std::vector<int> & dofs = hlTask_->jacDofs();
+
+  // fixed rows views of the dynamic storage
+  Eigen::Map<VectorDim> err(error.data(), dim);
+  Eigen::Map<const VectorDim> dimWeight(dimWeight_.data(), dim);
+  Eigen::Map<VectorDim> preC(preC_.data(), dim);
+
+  err.noalias() -= Eigen::Map<const VectorDim>(hlTask_->normalAcc().data(), dim);
+  preC.noalias() = dimWeight.cwiseProduct(err);
+
+  if(dofs.empty())
+  {
+    const Eigen::MatrixXd & jac = hlTask_->jac();
+    Eigen::Map<const MatrixDim> J(jac.data(), dim, jac.cols());
+    Eigen::Map<MatrixDim> preQ(preQ_.data(), dim, jac.cols());
+    jacDofs_.clear();
+    C_.noalias() = -J.transpose() * preC;
+
+    preQ.noalias() = dimWeight.asDiagonal() * J;
+    Q_.noalias() = J.transpose() * preQ;
+    return;
+  }
+
+  // Q_ and C_ are only zeroed when the kinematic path change
+  if(dofs != jacDofs_)
+  {
+    jacDofs_ = dofs;
+    Q_.setZero();
+    C_.setZero();
+  }
+
+  const Eigen::MatrixXd & jac = hlTask_->compactJac();
+  const int nrDofs = static_cast<int>(jac.cols());
+  Eigen::Map<const MatrixDim> J(jac.data(), dim, nrDofs);
+  Eigen::Map<MatrixDim> preQ(preQ_.data(), dim, nrDofs);
+  compactC_.noalias() = -J.transpose() * preC;
+  preQ.noalias() = dimWeight.asDiagonal() * J;
+  compactQ_.noalias() = J.transpose() * preQ;
+
+  for(int c = 0; c < nrDofs; ++c)
+  {
+    for(int r = 0; r < nrDofs; ++r) { Q_(jacDofs_[r], jacDofs_[c]) = compactQ_(r, c); }
+    C_(jacDofs_[c]) = compactC_(c);
+  }
 }
 
 const Eigen::MatrixXd & SetPointTaskCommon::Q() const
@@ -84,6 +147,11 @@ const Eigen::VectorXd & SetPointTaskCommon::C() const
   return C_;
 }
 
+const std::vector<int> & SetPointTaskCommon::nonZeroVars() const
+{
+  return jacDofs_;
+}
+
 /**
  *														SetPointTask
  */
@@ -118,7 +186,7 @@ void SetPointTask::update(const std::vector<rbd::MultiBody> & mbs,
                           const std::vector<rbd::MultiBodyConfig> & mbcs,
                           const SolverData & data)
 {
-  hlTask_->update(mbs, mbcs, data);
+  hlTask_->updateOnce(mbs, mbcs, data);
 
   const Eigen::VectorXd & err = hlTask_->eval();
   const Eigen::VectorXd & speed = hlTask_->speed();
@@ -182,7 +250,7 @@ void TrackingTask::update(const std::vector<rbd::MultiBody> & mbs,
                           const std::vector<rbd::MultiBodyConfig> & mbcs,
                           const SolverData & data)
 {
-  hlTask_->update(mbs, mbcs, data);
+  hlTask_->updateOnce(mbs, mbcs, data);
 
   error_.noalias() = gainPos_ * errorPos_;
   error_.noalias() += gainVel_ * errorVel_;
@@ -285,11 +353,33 @@ const Eigen::VectorXd & TrajectoryTask::refAccel() const
   return refAccel_;
 }
 
+void TrajectoryTask::trajectory(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep)
+{
+  if(!traj)
+  {
+    clearTrajectory();
+    return;
+  }
+  if(traj->dim() != refVel_.size())
+  {
+    std::ostringstream str;
+    str << "TrajectoryTask trajectory dimension (" << traj->dim() << ") must be " << refVel_.size();
+    throw std::domain_error(str.str());
+  }
+  trajPlayer_.load(std::move(traj), timeStep);
+}
+
+void TrajectoryTask::clearTrajectory()
+{
+  trajPlayer_.clear();
+}
+
 void TrajectoryTask::update(const std::vector<rbd::MultiBody> & mbs,
                             const std::vector<rbd::MultiBodyConfig> & mbcs,
                             const SolverData & data)
 {
-  hlTask_->update(mbs, mbcs, data);
+  hlTask_->updateOnce(mbs, mbcs, data);
+  if(trajPlayer_.loaded()) { trajPlayer_.sample(data.tick(), refVel_, refAccel_); }
 
   const Eigen::VectorXd & err = hlTask_->eval();
   const Eigen::VectorXd & speed = hlTask_->speed();
@@ -379,7 +469,7 @@ void PIDTask::update(const std::vector<rbd::MultiBody> & mbs,
                      const std::vector<rbd::MultiBodyConfig> & mbcs,
                      const SolverData & data)
 {
-  hlTask_->update(mbs, mbcs, data);
+  hlTask_->updateOnce(mbs, mbcs, data);
 
   error_.noalias() = P_ * error_;
   error_.noalias() -= D_ * errorD_;
@@ -387,6 +477,137 @@ void PIDTask::update(const std::vector<rbd::MultiBody> & mbs,
   computeQC(error_);
 }
 
+/**
+ *														StackedTask
+ */
+
+StackedTask::StackedTask(const std::vector<rbd::MultiBody> & mbs, int rI, double weight)
+: Task(weight), tasks_(), robotIndex_(rI), alphaDBegin_(0), nrDof_(mbs[rI].nrDof()),
+  Q_(Eigen::MatrixXd::Zero(nrDof_, nrDof_)), C_(Eigen::VectorXd::Zero(nrDof_)), jac_(), preQ_(), error_(), rowWeight_()
+{
+}
+
+void StackedTask::addTask(HighLevelTask * hlTask, double stiffness, double weight)
+{
+  addTask(hlTask, stiffness, 2. * std::sqrt(stiffness), Eigen::VectorXd::Ones(hlTask->dim()), weight);
+}
+
+void StackedTask::addTask(HighLevelTask * hlTask,
+                          double stiffness,
+                          double damping,
+                          const Eigen::VectorXd & dimWeight,
+                          double weight)
+{
+  assert(dimWeight.size() == hlTask->dim());
+  tasks_.push_back({hlTask, stiffness, damping, weight, dimWeight, Eigen::VectorXd::Zero(hlTask->dim()),
+                    Eigen::VectorXd::Zero(hlTask->dim())});
+  updateNrRows();
+}
+
+bool StackedTask::removeTask(HighLevelTask * hlTask)
+{
+  auto it = std::find_if(tasks_.begin(), tasks_.end(),
+                         [hlTask](const StackedData & data) { return data.hlTask == hlTask; });
+  if(it != tasks_.end())
+  {
+    tasks_.erase(it);
+    updateNrRows();
+    return true;
+  }
+  return false;
+}
+
+void StackedTask::resetTasks()
+{
+  tasks_.clear();
+  updateNrRows();
+}
+
+void StackedTask::gains(HighLevelTask * hlTask, double stiffness, double damping)
+{
+  StackedData & sd = stackedData(hlTask);
+  sd.stiffness = stiffness;
+  sd.damping = damping;
+}
+
+void StackedTask::taskWeight(HighLevelTask * hlTask, double weight)
+{
+  stackedData(hlTask).weight = weight;
+}
+
+void StackedTask::refVel(HighLevelTask * hlTask, const Eigen::VectorXd & refVel)
+{
+  StackedData & sd = stackedData(hlTask);
+  assert(refVel.size() == sd.refVel.size());
+  sd.refVel = refVel;
+}
+
+void StackedTask::refAccel(HighLevelTask * hlTask, const Eigen::VectorXd & refAccel)
+{
+  StackedData & sd = stackedData(hlTask);
+  assert(refAccel.size() == sd.refAccel.size());
+  sd.refAccel = refAccel;
+}
+
+void StackedTask::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
+{
+  alphaDBegin_ = data.alphaDBegin(robotIndex_);
+}
+
+void StackedTask::update(const std::vector<rbd::MultiBody> & mbs,
+                         const std::vector<rbd::MultiBodyConfig> & mbcs,
+                         const SolverData & data)
+{
+  // stack all the jacobians and errors
+  int row = 0;
+  for(StackedData & sd : tasks_)
+  {
+    sd.hlTask->updateOnce(mbs, mbcs, data);
+    const int dim = static_cast<int>(sd.dimWeight.size());
+
+    jac_.middleRows(row, dim) = sd.hlTask->jac();
+    error_.segment(row, dim).noalias() = sd.stiffness * sd.hlTask->eval();
+    error_.segment(row, dim).noalias() += sd.damping * (sd.refVel - sd.hlTask->speed());
+    error_.segment(row, dim) += sd.refAccel - sd.hlTask->normalAcc();
+    rowWeight_.segment(row, dim).noalias() = sd.weight * sd.dimWeight;
+    row += dim;
+  }
+
+  C_.noalias() = -jac_.transpose() * rowWeight_.cwiseProduct(error_);
+  preQ_.noalias() = rowWeight_.asDiagonal() * jac_;
+  Q_.noalias() = jac_.transpose() * preQ_;
+}
+
+const Eigen::MatrixXd & StackedTask::Q() const
+{
+  return Q_;
+}
+
+const Eigen::VectorXd & StackedTask::C() const
+{
+  return C_;
+}
+
+StackedTask::StackedData & StackedTask::stackedData(HighLevelTask * hlTask)
+{
+  auto it = std::find_if(tasks_.begin(), tasks_.end(),
+                         [hlTask](const StackedData & data) { return data.hlTask == hlTask; });
+  if(it == tasks_.end()) { throw std::runtime_error("High level task is not in the StackedTask"); }
+  return *it;
+}
+
+void StackedTask::updateNrRows()
+{
+  int nrRows = 0;
+  for(const StackedData & sd : tasks_) { nrRows += static_cast<int>(sd.dimWeight.size()); }
+  jac_.setZero(nrRows, nrDof_);
+  preQ_.setZero(nrRows, nrDof_);
+  error_.setZero(nrRows);
+  rowWeight_.setZero(nrRows);
+  Q_.setZero();
+  C_.setZero();
+}
+
 /**
  *														TargetObjectiveTask
  */
@@ -442,7 +663,7 @@ void TargetObjectiveTask::update(const std::vector<rbd::MultiBody> & mbs,
 {
   using namespace Eigen;
 
-  hlTask_->update(mbs, mbcs, data);
+  hlTask_->updateOnce(mbs, mbcs, data);
 
   const MatrixXd & J = hlTask_->jac();
   const VectorXd & err = hlTask_->eval();
@@ -603,7 +824,7 @@ void JointsSelector::update(const std::vector<rbd::MultiBody> & mbs,
                             const std::vector<rbd::MultiBodyConfig> & mbcs,
                             const SolverData & data)
 {
-  hl_->update(mbs, mbcs, data);
+  hl_->updateOnce(mbs, mbcs, data);
   const Eigen::MatrixXd & jac = hl_->jac();
   for(SelectedData sd : selectedJoints_)
   {
@@ -729,10 +950,12 @@ PostureTask::PostureTask(const std::vector<rbd::MultiBody> & mbs,
                          double stiffness,
                          double weight)
 : Task(weight), pt_(mbs[rI], q), stiffness_(stiffness), damping_(2. * std::sqrt(stiffness)), robotIndex_(rI),
-  alphaDBegin_(0), jointDatas_(), Q_(mbs[rI].nrDof(), mbs[rI].nrDof()), C_(mbs[rI].nrDof()), alphaVec_(mbs[rI].nrDof()),
+  alphaDBegin_(0), jointDatas_(), Q_(mbs[rI].nrDof(), mbs[rI].nrDof()), C_(mbs[rI].nrDof()),
   refVel_(mbs[rI].nrDof()), refAccel_(mbs[rI].nrDof())
 {
   dimWeight_ = Eigen::VectorXd::Ones(C_.size());
+  // only the diagonal is updated in update
+  Q_.setZero();
   refVel_.setZero();
   refAccel_.setZero();
 }
@@ -787,31 +1010,54 @@ void PostureTask::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, co
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
 }
 
+void PostureTask::trajectory(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep)
+{
+  if(!traj)
+  {
+    clearTrajectory();
+    return;
+  }
+  if(traj->dim() != refVel_.size())
+  {
+    std::ostringstream str;
+    str << "PostureTask trajectory dimension (" << traj->dim() << ") must be " << refVel_.size();
+    throw std::domain_error(str.str());
+  }
+  trajPlayer_.load(std::move(traj), timeStep);
+}
+
+void PostureTask::clearTrajectory()
+{
+  trajPlayer_.clear();
+}
+
 void PostureTask::update(const std::vector<rbd::MultiBody> & mbs,
                          const std::vector<rbd::MultiBodyConfig> & mbcs,
-                         const SolverData & /* data */)
+                         const SolverData & data)
 {
   const rbd::MultiBody & mb = mbs[robotIndex_];
   const rbd::MultiBodyConfig & mbc = mbcs[robotIndex_];
 
+  if(trajPlayer_.loaded()) { trajPlayer_.sample(data.tick(), refVel_, refAccel_); }
+
   pt_.update(mb, mbc);
-  rbd::paramToVector(mbc.alpha, alphaVec_);
+  const Eigen::VectorXd & alphaVec = data.alphaVec(robotIndex_);
 
-  Q_ = dimWeight_.asDiagonal() * pt_.jac();
+  Q_.diagonal().noalias() = dimWeight_.cwiseProduct(pt_.jac().diagonal());
   C_.setZero();
 
   int deb = mb.jointPosInDof(1);
   int end = mb.nrDof() - deb;
   // joint
   C_.segment(deb, end) = -stiffness_ * pt_.eval().segment(deb, end)
-                         + damping_ * (alphaVec_.segment(deb, end) - refVel_.segment(deb, end))
+                         + damping_ * (alphaVec.segment(deb, end) - refVel_.segment(deb, end))
                          - refAccel_.segment(deb, end);
 
   for(const JointData & pjd : jointDatas_)
   {
     C_.segment(pjd.start, pjd.size) =
         -pjd.stiffness * pt_.eval().segment(pjd.start, pjd.size)
-        + pjd.damping * (alphaVec_.segment(pjd.start, pjd.size) - refVel_.segment(pjd.start, pjd.size))
+        + pjd.damping * (alphaVec.segment(pjd.start, pjd.size) - refVel_.segment(pjd.start, pjd.size))
         - refAccel_.segment(pjd.start, pjd.size);
   }
   C_ = dimWeight_.asDiagonal() * C_;
@@ -854,7 +1100,7 @@ void PositionTask::update(const std::vector<rbd::MultiBody> & mbs,
                           const std::vector<rbd::MultiBodyConfig> & mbcs,
                           const SolverData & data)
 {
-  pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_), data.motionSubspaceW(robotIndex_));
 }
 
 const Eigen::MatrixXd & PositionTask::jac() const
@@ -862,6 +1108,16 @@ const Eigen::MatrixXd & PositionTask::jac() const
   return pt_.jac();
 }
 
+const Eigen::MatrixXd & PositionTask::compactJac() const
+{
+  return pt_.compactJac();
+}
+
+const std::vector<int> & PositionTask::jacDofs() const
+{
+  return pt_.jacDofs();
+}
+
 const Eigen::VectorXd & PositionTask::eval() const
 {
   return pt_.eval();
@@ -906,7 +1162,7 @@ void OrientationTask::update(const std::vector<rbd::MultiBody> & mbs,
                              const std::vector<rbd::MultiBodyConfig> & mbcs,
                              const SolverData & data)
 {
-  ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_), data.motionSubspaceW(robotIndex_));
 }
 
 const Eigen::MatrixXd & OrientationTask::jac() const
@@ -914,6 +1170,16 @@ const Eigen::MatrixXd & OrientationTask::jac() const
   return ot_.jac();
 }
 
+const Eigen::MatrixXd & OrientationTask::compactJac() const
+{
+  return ot_.compactJac();
+}
+
+const std::vector<int> & OrientationTask::jacDofs() const
+{
+  return ot_.jacDofs();
+}
+
 const Eigen::VectorXd & OrientationTask::eval() const
 {
   return ot_.eval();
@@ -946,7 +1212,7 @@ void SurfaceTransformTask::update(const std::vector<rbd::MultiBody> & mbs,
                                   const std::vector<rbd::MultiBodyConfig> & mbcs,
                                   const SolverData & data)
 {
-  tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_), data.motionSubspaceW(robotIndex_));
 }
 
 /**
@@ -978,7 +1244,7 @@ void TransformTask::update(const std::vector<rbd::MultiBody> & mbs,
                            const std::vector<rbd::MultiBodyConfig> & mbcs,
                            const SolverData & data)
 {
-  tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_), data.motionSubspaceW(robotIndex_));
 }
 
 /**
@@ -1012,7 +1278,7 @@ void SurfaceOrientationTask::update(const std::vector<rbd::MultiBody> & mbs,
                                     const std::vector<rbd::MultiBodyConfig> & mbcs,
                                     const SolverData & data)
 {
-  ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_), data.motionSubspaceW(robotIndex_));
 }
 
 const Eigen::MatrixXd & SurfaceOrientationTask::jac() const
@@ -1092,6 +1358,63 @@ const Eigen::VectorXd & GazeTask::normalAcc() const
   return gazet_.normalAcc();
 }
 
+/**
+ *																MultiGazeTask
+ */
+
+MultiGazeTask::MultiGazeTask(const std::vector<rbd::MultiBody> & mbs,
+                             int robotIndex,
+                             const std::string & bodyName,
+                             const Eigen::Matrix2Xd & points2d,
+                             const Eigen::VectorXd & depthEstimates,
+                             const sva::PTransformd & X_b_gaze,
+                             const Eigen::Matrix2Xd & points2d_ref)
+: gazet_(mbs[robotIndex], bodyName, points2d, depthEstimates, X_b_gaze, points2d_ref), robotIndex_(robotIndex)
+{
+}
+
+MultiGazeTask::MultiGazeTask(const std::vector<rbd::MultiBody> & mbs,
+                             int robotIndex,
+                             const std::string & bodyName,
+                             const Eigen::Matrix3Xd & points3d,
+                             const sva::PTransformd & X_b_gaze,
+                             const Eigen::Matrix2Xd & points2d_ref)
+: gazet_(mbs[robotIndex], bodyName, points3d, X_b_gaze, points2d_ref), robotIndex_(robotIndex)
+{
+}
+
+int MultiGazeTask::dim()
+{
+  return 2 * gazet_.nrPoints();
+}
+
+void MultiGazeTask::update(const std::vector<rbd::MultiBody> & mbs,
+                           const std::vector<rbd::MultiBodyConfig> & mbcs,
+                           const SolverData & data)
+{
+  gazet_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+}
+
+const Eigen::MatrixXd & MultiGazeTask::jac() const
+{
+  return gazet_.jac();
+}
+
+const Eigen::VectorXd & MultiGazeTask::eval() const
+{
+  return gazet_.eval();
+}
+
+const Eigen::VectorXd & MultiGazeTask::speed() const
+{
+  return gazet_.speed();
+}
+
+const Eigen::VectorXd & MultiGazeTask::normalAcc() const
+{
+  return gazet_.normalAcc();
+}
+
 /**
  *																PositionBasedVisServoTask
  */
@@ -1192,7 +1515,7 @@ const Eigen::VectorXd & CoM6DTask::normalAcc() const
  */
 
 CoMTask::CoMTask(const std::vector<rbd::MultiBody> & mbs, int rI, const Eigen::Vector3d & com)
-: ct_(mbs[rI], com), robotIndex_(rI)
+: ct_(mbs[rI], com), robotIndex_(rI), weighted_(false)
 {
 }
 
@@ -1200,7 +1523,7 @@ CoMTask::CoMTask(const std::vector<rbd::MultiBody> & mbs,
                  int rI,
                  const Eigen::Vector3d & com,
                  std::vector<double> weight)
-: ct_(mbs[rI], com, std::move(weight)), robotIndex_(rI)
+: ct_(mbs[rI], com, std::move(weight)), robotIndex_(rI), weighted_(true)
 {
 }
 
@@ -1218,8 +1541,12 @@ void CoMTask::update(const std::vector<rbd::MultiBody> & mbs,
                      const std::vector<rbd::MultiBodyConfig> & mbcs,
                      const SolverData & data)
 {
-  ct_.update(mbs[robotIndex_], mbcs[robotIndex_], rbd::computeCoM(mbs[robotIndex_], mbcs[robotIndex_]),
-             data.normalAccB(robotIndex_));
+  if(weighted_)
+  {
+    ct_.update(mbs[robotIndex_], mbcs[robotIndex_], rbd::computeCoM(mbs[robotIndex_], mbcs[robotIndex_]),
+               data.normalAccB(robotIndex_));
+  }
+  else { ct_.update(data.centroidalCoM(mbs, mbcs, robotIndex_)); }
 }
 
 const Eigen::MatrixXd & CoMTask::jac() const
@@ -1304,7 +1631,11 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody> & mbs,
                           const std::vector<rbd::MultiBodyConfig> & mbcs,
                           const SolverData & data)
 {
-  mct_.update(mbs, mbcs, data.normalAccB());
+  for(std::size_t i = 0; i < mct_.robotIndexes().size(); ++i)
+  {
+    centroidal_[i] = &data.centroidalCoM(mbs, mbcs, mct_.robotIndexes()[i]);
+  }
+  mct_.update(centroidal_);
   CSum_ = stiffness_ * mct_.eval();
   CSum_ -= stiffnessSqrt_ * mct_.speed();
   CSum_ -= mct_.normalAcc();
@@ -1347,6 +1678,7 @@ void MultiCoMTask::init(const std::vector<rbd::MultiBody> & mbs)
   int maxDof = 0;
   for(int r : mct_.robotIndexes()) { maxDof = std::max(maxDof, mbs[r].nrDof()); }
   preQ_.resize(3, maxDof);
+  centroidal_.assign(mct_.robotIndexes().size(), nullptr);
 }
 
 /**
@@ -1491,7 +1823,7 @@ void MomentumTask::update(const std::vector<rbd::MultiBody> & mbs,
                           const std::vector<rbd::MultiBodyConfig> & mbcs,
                           const SolverData & data)
 {
-  momt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+  momt_.update(data.centroidalMomentum(mbs, mbcs, robotIndex_));
 }
 
 const Eigen::MatrixXd & MomentumTask::jac() const
@@ -1531,35 +1863,39 @@ void ContactTask::errorD(const Eigen::Vector3d & errorD)
 void ContactTask::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
 {
   int nrLambda = 0;
-  begin_ = data.lambdaBegin();
-  std::vector<FrictionCone> cones;
-  int curLambda = 0;
+  begin_ = data.lambdaBegin() + data.totalLambda();
+  const int nrAllContacts = static_cast<int>(data.allContacts().size());
+  const int cIndex = data.contactIndex(contactId_);
+
+  if(cIndex != -1)
+  {
+    begin_ = data.lambdaBegin(cIndex);
+    nrLambda = data.lambda(cIndex);
+  }
 
-  if(nrLambda == 0)
+  if(cIndex != -1 && cIndex < nrAllContacts)
   {
-    for(const BilateralContact & uc : data.allContacts())
+    conesJac_.resize(3, nrLambda);
+    int index = 0;
+    for(const FrictionCone & fc : data.allContacts()[cIndex].r1Cones)
     {
-      curLambda = uc.nrLambda();
-      if(uc.contactId == contactId_)
+      for(const Eigen::Vector3d & gen : fc.generators)
       {
-        nrLambda = curLambda;
-        cones = uc.r1Cones;
-        break;
+        conesJac_.col(index) = gen;
+        ++index;
       }
-
-      begin_ += curLambda;
     }
   }
-
-  conesJac_.resize(3, nrLambda);
-  int index = 0;
-  for(const FrictionCone & fc : cones)
+  else if(cIndex != -1)
   {
-    for(const Eigen::Vector3d & gen : fc.generators)
-    {
-      conesJac_.col(index) = gen;
-      ++index;
-    }
+    // the force part of the wrench is rotated in the body frame
+    const WrenchContact & wc = data.wrenchContacts()[cIndex - nrAllContacts];
+    conesJac_.setZero(3, nrLambda);
+    conesJac_.rightCols<3>() = wc.X_b1_s.rotation().transpose();
+  }
+  else
+  {
+    conesJac_.resize(3, 0);
   }
 
   Q_.resize(nrLambda, nrLambda);
@@ -1593,44 +1929,36 @@ const Eigen::VectorXd & ContactTask::C() const
 void GripperTorqueTask::updateNrVars(const std::vector<rbd::MultiBody> & /* mbs */, const SolverData & data)
 {
   using namespace Eigen;
-  bool found = false;
 
-  begin_ = data.bilateralBegin();
-  for(const BilateralContact & bc : data.bilateralContacts())
+  // only bilateral contacts are considered
+  const int nrUni = static_cast<int>(data.unilateralContacts().size());
+  const int cIndex = data.contactIndex(contactId_);
+  if(cIndex >= nrUni && cIndex < static_cast<int>(data.allContacts().size()))
   {
-    int curLambda = 0;
-    // compute the number of lambda needed by the current bilateral
-    for(std::size_t i = 0; i < bc.r1Points.size(); ++i) { curLambda += bc.nrLambda(static_cast<int>(i)); }
-
-    if(bc.contactId == contactId_)
+    const BilateralContact & bc = data.allContacts()[cIndex];
+    int curLambda = data.lambda(cIndex);
+    begin_ = data.lambdaBegin(cIndex);
+    Q_.setZero(curLambda, curLambda);
+    C_.resize(curLambda);
+
+    int pos = 0;
+    // minimize Torque applied on the gripper motor
+    // min Sum_i^nrF  T_i·( p_i^T_o x f_i)
+    for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
     {
-      found = true;
-      Q_.setZero(curLambda, curLambda);
-      C_.resize(curLambda);
-
-      int pos = 0;
-      // minimize Torque applied on the gripper motor
-      // min Sum_i^nrF  T_i·( p_i^T_o x f_i)
-      for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
+      Vector3d T_o_p = bc.r1Points[i] - origin_;
+      for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
       {
-        Vector3d T_o_p = bc.r1Points[i] - origin_;
-        for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
-        {
-          // we use abs because the contact force cannot apply
-          // negative torque on the gripper
-          C_(pos) = std::abs(axis_.transpose() * (T_o_p.cross(bc.r1Cones[i].generators[j])));
-          ++pos;
-        }
+        // we use abs because the contact force cannot apply
+        // negative torque on the gripper
+        C_(pos) = std::abs(axis_.transpose() * (T_o_p.cross(bc.r1Cones[i].generators[j])));
+        ++pos;
       }
-      break;
     }
-
-    begin_ += curLambda;
   }
-
   // if no contact was found we don't activate the task
   // (safe position and empty matrix)
-  if(!found)
+  else
   {
     begin_ = 0;
     Q_.resize(0, 0);
@@ -1711,7 +2039,7 @@ OrientationTrackingTask::OrientationTrackingTask(const std::vector<rbd::MultiBod
                                                  const std::vector<std::string> & trackingJointsName,
                                                  const Eigen::Vector3d & trackedPoint)
 : robotIndex_(rI), ott_(mbs[rI], bodyName, bodyPoint, bodyAxis, trackingJointsName, trackedPoint),
-  alphaVec_(mbs[rI].nrDof()), speed_(3), normalAcc_(3)
+  speed_(3), normalAcc_(3)
 {
 }
 
@@ -1722,13 +2050,13 @@ int OrientationTrackingTask::dim()
 
 void OrientationTrackingTask::update(const std::vector<rbd::MultiBody> & mbs,
                                      const std::vector<rbd::MultiBodyConfig> & mbcs,
-                                     const SolverData & /* data */)
+                                     const SolverData & data)
 {
   ott_.update(mbs[robotIndex_], mbcs[robotIndex_]);
-  rbd::paramToVector(mbcs[robotIndex_].alpha, alphaVec_);
+  const Eigen::VectorXd & alphaVec = data.alphaVec(robotIndex_);
 
-  speed_.noalias() = ott_.jac() * alphaVec_;
-  normalAcc_.noalias() = ott_.jacDot() * alphaVec_;
+  speed_.noalias() = ott_.jac() * alphaVec;
+  normalAcc_.noalias() = ott_.jacDot() * alphaVec;
 }
 
 const Eigen::MatrixXd & OrientationTrackingTask::jac() const
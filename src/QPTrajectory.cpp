@@ -0,0 +1,114 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+// associated header
+#include "Tasks/QPTrajectory.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+/**
+ *													TrajectoryBuffer
+ */
+
+TrajectoryBuffer::TrajectoryBuffer() : period_(1.), vel_(), accel_() {}
+
+TrajectoryBuffer::TrajectoryBuffer(double period, Eigen::MatrixXd vel, Eigen::MatrixXd accel)
+: period_(period), vel_(std::move(vel)), accel_(std::move(accel))
+{
+  if(!(period_ > 0.)) { throw std::domain_error("Trajectory period must be strictly positive"); }
+  if(vel_.cols() == 0) { throw std::domain_error("Trajectory must have at least one sample"); }
+  if(vel_.rows() != accel_.rows() || vel_.cols() != accel_.cols())
+  {
+    throw std::domain_error("Trajectory velocity and acceleration samples must have the same size");
+  }
+}
+
+void TrajectoryBuffer::eval(double t, Eigen::Ref<Eigen::VectorXd> vel, Eigen::Ref<Eigen::VectorXd> accel) const
+{
+  assert(vel.size() == dim() && accel.size() == dim());
+
+  const int last = nrSamples() - 1;
+  const double u = t / period_;
+  if(!(u > 0.) || last == 0)
+  {
+    vel = vel_.col(0);
+    accel = accel_.col(0);
+    return;
+  }
+  if(u >= last)
+  {
+    vel = vel_.col(last);
+    accel = accel_.col(last);
+    return;
+  }
+
+  const int k = std::min(static_cast<int>(std::floor(u)), last - 1);
+  const double s = u - k;
+  const double s2 = s * s;
+  const double s3 = s2 * s;
+
+  // cubic Hermite basis and its derivative
+  const double h00 = 2. * s3 - 3. * s2 + 1.;
+  const double h10 = s3 - 2. * s2 + s;
+  const double h01 = -2. * s3 + 3. * s2;
+  const double h11 = s3 - s2;
+  const double dh00 = 6. * s2 - 6. * s;
+  const double dh10 = 3. * s2 - 4. * s + 1.;
+  const double dh11 = 3. * s2 - 2. * s;
+
+  vel.noalias() = h00 * vel_.col(k) + h01 * vel_.col(k + 1);
+  vel.noalias() += (h10 * period_) * accel_.col(k) + (h11 * period_) * accel_.col(k + 1);
+  accel.noalias() = (dh00 / period_) * (vel_.col(k) - vel_.col(k + 1));
+  accel.noalias() += dh10 * accel_.col(k) + dh11 * accel_.col(k + 1);
+}
+
+/**
+ *													TrajectoryPlayer
+ */
+
+TrajectoryPlayer::TrajectoryPlayer() : traj_(), timeStep_(0.), time_(0.), started_(false), startTick_(0) {}
+
+void TrajectoryPlayer::load(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep)
+{
+  traj_ = std::move(traj);
+  timeStep_ = timeStep;
+  time_ = 0.;
+  started_ = false;
+}
+
+void TrajectoryPlayer::clear()
+{
+  traj_.reset();
+  time_ = 0.;
+  started_ = false;
+}
+
+void TrajectoryPlayer::sample(unsigned long long tick,
+                              Eigen::Ref<Eigen::VectorXd> vel,
+                              Eigen::Ref<Eigen::VectorXd> accel)
+{
+  if(!started_)
+  {
+    startTick_ = tick;
+    started_ = true;
+  }
+  time_ = static_cast<double>(tick - startTick_) * timeStep_;
+  traj_->eval(time_, vel, accel);
+}
+
+} // namespace qp
+
+} // namespace tasks
@@ -9,6 +9,7 @@
 // std
 #include <numeric>
 #include <set>
+#include <stdexcept>
 
 // rbd
 #include <RBDyn/MultiBody.h>
@@ -17,6 +18,109 @@
 namespace tasks
 {
 
+namespace
+{
+
+/**
+ * Dof index of each column of a rbd::Jacobian compact jacobian.
+ * Return an empty vector when a mimic joint is on the path since
+ * the compact jacobian can't then be scattered column by column.
+ */
+std::vector<int> jacobianDofs(const rbd::MultiBody & mb, const rbd::Jacobian & jac)
+{
+  std::vector<int> dofs;
+  dofs.reserve(static_cast<size_t>(jac.dof()));
+  for(int j : jac.jointsPath())
+  {
+    if(mb.joint(j).isMimic()) { return {}; }
+    int pos = mb.jointPosInDof(j);
+    for(int d = 0; d < mb.joint(j).dof(); ++d) { dofs.push_back(pos + d); }
+  }
+  return dofs;
+}
+
+/**
+ * Fused jacobian kernel.
+ * Walk jac joints path once to compute the jacobian of the body in the
+ * X_0_p frame and, if pathNormalAccB is not null, the body normal
+ * accelerations along the path (the ones computed by
+ * rbd::Jacobian::normalAcceleration(mb, mbc)).
+ * Only rows [row, row + nrRows[ of the 6D jacobian are computed.
+ * The compact jacobian is written in shortJac and directly scattered in
+ * fullJac when dofs is not empty (fullJac columns outside dofs are not
+ * touched), otherwise fullJac must be computed with jac.fullJacobian.
+ */
+void fusedJacobian(const rbd::MultiBody & mb,
+                   const rbd::MultiBodyConfig & mbc,
+                   const rbd::Jacobian & jac,
+                   const sva::PTransformd & X_0_p,
+                   int row,
+                   int nrRows,
+                   const std::vector<int> & dofs,
+                   Eigen::MatrixXd & shortJac,
+                   Eigen::MatrixXd & fullJac,
+                   std::vector<sva::MotionVecd> * pathNormalAccB)
+{
+  const std::vector<int> & pred = mb.predecessors();
+  const std::vector<int> & succ = mb.successors();
+
+  int col = 0;
+  for(int i : jac.jointsPath())
+  {
+    if(pathNormalAccB)
+    {
+      std::vector<sva::MotionVecd> & normalAccB = *pathNormalAccB;
+      const sva::MotionVecd & vb_i = mbc.bodyVelB[i];
+      if(pred[i] != -1)
+        normalAccB[succ[i]] = mbc.parentToSon[i] * normalAccB[pred[i]] + vb_i.cross(mbc.jointVelocity[i]);
+      else
+        normalAccB[succ[i]] = vb_i.cross(mbc.jointVelocity[i]);
+    }
+
+    const sva::PTransformd X_i_p = X_0_p * mbc.bodyPosW[succ[i]].inv();
+    const Eigen::MatrixXd & S_i = mbc.motionSubspace[i];
+    for(int d = 0; d < mb.joint(i).dof(); ++d, ++col)
+    {
+      const Eigen::Vector6d S_p = (X_i_p * sva::MotionVecd(S_i.col(d))).vector();
+      shortJac.col(col) = S_p.segment(row, nrRows);
+      if(!dofs.empty()) { fullJac.col(dofs[static_cast<size_t>(col)]) = S_p.segment(row, nrRows); }
+    }
+  }
+}
+
+} // namespace
+
+void jacobianFromSweep(const rbd::MultiBody & mb,
+                       const rbd::Jacobian & jac,
+                       const Eigen::MatrixXd & motionSubspaceW,
+                       const sva::PTransformd & X_0_p,
+                       Eigen::Ref<Eigen::MatrixXd> res,
+                       int row,
+                       int nrRows)
+{
+  // motionSubspaceW columns are expressed in the world frame at the origin,
+  // so the jacobian in X_0_p is just a 6D transform of the path columns
+  const Eigen::Matrix6d X_0_pMat = X_0_p.matrix();
+  int col = 0;
+  for(int j : jac.jointsPath())
+  {
+    int dof = mb.joint(j).dof();
+    res.middleCols(col, dof).noalias() =
+        X_0_pMat.middleRows(row, nrRows) * motionSubspaceW.middleCols(mb.jointPosInDof(j), dof);
+    col += dof;
+  }
+}
+
+/**
+ *													CentroidalData
+ */
+
+CentroidalData::CentroidalData()
+: com(Eigen::Vector3d::Zero()), comVelocity(Eigen::Vector3d::Zero()), comNormalAcc(Eigen::Vector3d::Zero()), comJac(),
+  momentum(Eigen::Vector6d::Zero()), normalMomentumDot(Eigen::Vector6d::Zero()), momentumMatrix()
+{
+}
+
 /**
  *													PositionTask
  */
@@ -26,7 +130,9 @@ PositionTask::PositionTask(const rbd::MultiBody & mb,
                            const Eigen::Vector3d & pos,
                            const Eigen::Vector3d & bodyPoint)
 : pos_(pos), point_(bodyPoint), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName, bodyPoint), eval_(3),
-  speed_(3), normalAcc_(3), jacMat_(3, mb.nrDof()), jacDotMat_(3, mb.nrDof())
+  speed_(3), normalAcc_(3), shortJacMat_(3, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(3, mb.nrDof())),
+  jacDotMat_(3, mb.nrDof()), jacDofs_(jacobianDofs(mb, jac_)),
+  pathNormalAccB_(static_cast<size_t>(mb.nrBodies()), sva::MotionVecd(Eigen::Vector6d::Zero()))
 {
 }
 
@@ -52,24 +158,42 @@ const Eigen::Vector3d & PositionTask::bodyPoint() const
 
 void PositionTask::update(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
 {
+  // world aligned frame at the body point
+  sva::PTransformd X_0_p((sva::PTransformd(jac_.point()) * mbc.bodyPosW[bodyIndex_]).translation());
+  fusedJacobian(mb, mbc, jac_, X_0_p, 3, 3, jacDofs_, shortJacMat_, jacMat_, &pathNormalAccB_);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
   eval_ = pos_ - (point_ * mbc.bodyPosW[bodyIndex_]).translation();
   speed_ = jac_.velocity(mb, mbc).linear();
-  normalAcc_ = jac_.normalAcceleration(mb, mbc).linear();
-
-  const auto & shortJacMat = jac_.jacobian(mb, mbc).block(3, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+  normalAcc_ = jac_.normalAcceleration(mb, mbc, pathNormalAccB_).linear();
 }
 
 void PositionTask::update(const rbd::MultiBody & mb,
                           const rbd::MultiBodyConfig & mbc,
                           const std::vector<sva::MotionVecd> & normalAccB)
 {
+  sva::PTransformd X_0_p((sva::PTransformd(jac_.point()) * mbc.bodyPosW[bodyIndex_]).translation());
+  fusedJacobian(mb, mbc, jac_, X_0_p, 3, 3, jacDofs_, shortJacMat_, jacMat_, nullptr);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
   eval_ = pos_ - (point_ * mbc.bodyPosW[bodyIndex_]).translation();
   speed_ = jac_.velocity(mb, mbc).linear();
   normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).linear();
+}
 
-  const auto & shortJacMat = jac_.jacobian(mb, mbc).block(3, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+void PositionTask::update(const rbd::MultiBody & mb,
+                          const rbd::MultiBodyConfig & mbc,
+                          const std::vector<sva::MotionVecd> & normalAccB,
+                          const Eigen::MatrixXd & motionSubspaceW)
+{
+  eval_ = pos_ - (point_ * mbc.bodyPosW[bodyIndex_]).translation();
+  speed_ = jac_.velocity(mb, mbc).linear();
+  normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).linear();
+
+  // world aligned frame at the body point
+  sva::PTransformd X_0_p((sva::PTransformd(jac_.point()) * mbc.bodyPosW[bodyIndex_]).translation());
+  jacobianFromSweep(mb, jac_, motionSubspaceW, X_0_p, shortJacMat_, 3, 3);
+  jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 void PositionTask::updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
@@ -103,6 +227,16 @@ const Eigen::MatrixXd & PositionTask::jacDot() const
   return jacDotMat_;
 }
 
+const Eigen::MatrixXd & PositionTask::compactJac() const
+{
+  return shortJacMat_;
+}
+
+const std::vector<int> & PositionTask::jacDofs() const
+{
+  return jacDofs_;
+}
+
 /**
  *													OrientationTask
  */
@@ -111,13 +245,17 @@ OrientationTask::OrientationTask(const rbd::MultiBody & mb,
                                  const std::string & bodyName,
                                  const Eigen::Quaterniond & ori)
 : ori_(ori.matrix()), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName), eval_(3), speed_(3), normalAcc_(3),
-  jacMat_(3, mb.nrDof()), jacDotMat_(3, mb.nrDof())
+  shortJacMat_(3, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(3, mb.nrDof())), jacDotMat_(3, mb.nrDof()),
+  jacDofs_(jacobianDofs(mb, jac_)),
+  pathNormalAccB_(static_cast<size_t>(mb.nrBodies()), sva::MotionVecd(Eigen::Vector6d::Zero()))
 {
 }
 
 OrientationTask::OrientationTask(const rbd::MultiBody & mb, const std::string & bodyName, const Eigen::Matrix3d & ori)
 : ori_(ori), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName), eval_(3), speed_(3), normalAcc_(3),
-  jacMat_(3, mb.nrDof()), jacDotMat_(3, mb.nrDof())
+  shortJacMat_(3, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(3, mb.nrDof())), jacDotMat_(3, mb.nrDof()),
+  jacDofs_(jacobianDofs(mb, jac_)),
+  pathNormalAccB_(static_cast<size_t>(mb.nrBodies()), sva::MotionVecd(Eigen::Vector6d::Zero()))
 {
 }
 
@@ -138,24 +276,39 @@ const Eigen::Matrix3d & OrientationTask::orientation() const
 
 void OrientationTask::update(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
 {
+  // angular part doesn't depend of the frame origin
+  fusedJacobian(mb, mbc, jac_, sva::PTransformd::Identity(), 0, 3, jacDofs_, shortJacMat_, jacMat_, &pathNormalAccB_);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
   eval_ = sva::rotationError(mbc.bodyPosW[bodyIndex_].rotation(), ori_);
   speed_ = jac_.velocity(mb, mbc).angular();
-  normalAcc_ = jac_.normalAcceleration(mb, mbc).angular();
-
-  const auto & shortJacMat = jac_.jacobian(mb, mbc).block(0, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+  normalAcc_ = jac_.normalAcceleration(mb, mbc, pathNormalAccB_).angular();
 }
 
 void OrientationTask::update(const rbd::MultiBody & mb,
                              const rbd::MultiBodyConfig & mbc,
                              const std::vector<sva::MotionVecd> & normalAccB)
+{
+  fusedJacobian(mb, mbc, jac_, sva::PTransformd::Identity(), 0, 3, jacDofs_, shortJacMat_, jacMat_, nullptr);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
+  eval_ = sva::rotationError(mbc.bodyPosW[bodyIndex_].rotation(), ori_);
+  speed_ = jac_.velocity(mb, mbc).angular();
+  normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).angular();
+}
+
+void OrientationTask::update(const rbd::MultiBody & mb,
+                             const rbd::MultiBodyConfig & mbc,
+                             const std::vector<sva::MotionVecd> & normalAccB,
+                             const Eigen::MatrixXd & motionSubspaceW)
 {
   eval_ = sva::rotationError(mbc.bodyPosW[bodyIndex_].rotation(), ori_);
   speed_ = jac_.velocity(mb, mbc).angular();
   normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).angular();
 
-  const auto & shortJacMat = jac_.jacobian(mb, mbc).block(0, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+  // angular part doesn't depend of the frame origin
+  jacobianFromSweep(mb, jac_, motionSubspaceW, sva::PTransformd::Identity(), shortJacMat_, 0, 3);
+  jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 void OrientationTask::updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
@@ -189,6 +342,16 @@ const Eigen::MatrixXd & OrientationTask::jacDot() const
   return jacDotMat_;
 }
 
+const Eigen::MatrixXd & OrientationTask::compactJac() const
+{
+  return shortJacMat_;
+}
+
+const std::vector<int> & OrientationTask::jacDofs() const
+{
+  return jacDofs_;
+}
+
 /**
  *													TransformTaskCommon
  */
@@ -198,7 +361,8 @@ TransformTaskCommon::TransformTaskCommon(const rbd::MultiBody & mb,
                                          const sva::PTransformd & X_0_t,
                                          const sva::PTransformd & X_b_p)
 : X_0_t_(X_0_t), X_b_p_(X_b_p), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName), eval_(6), speed_(6),
-  normalAcc_(6), jacMat_(6, mb.nrDof())
+  normalAcc_(6), shortJacMat_(6, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(6, mb.nrDof())),
+  jacDofs_(jacobianDofs(mb, jac_))
 {
 }
 
@@ -242,6 +406,16 @@ const Eigen::MatrixXd & TransformTaskCommon::jac() const
   return jacMat_;
 }
 
+const Eigen::MatrixXd & TransformTaskCommon::compactJac() const
+{
+  return shortJacMat_;
+}
+
+const std::vector<int> & TransformTaskCommon::jacDofs() const
+{
+  return jacDofs_;
+}
+
 /**
  *													SurfaceTransformTask
  */
@@ -250,13 +424,29 @@ SurfaceTransformTask::SurfaceTransformTask(const rbd::MultiBody & mb,
                                            const std::string & bodyName,
                                            const sva::PTransformd & X_0_t,
                                            const sva::PTransformd & X_b_p)
-: TransformTaskCommon(mb, bodyName, X_0_t, X_b_p), jacMatTmp_(6, jac_.dof())
+: TransformTaskCommon(mb, bodyName, X_0_t, X_b_p)
 {
 }
 
 void SurfaceTransformTask::update(const rbd::MultiBody & mb,
                                   const rbd::MultiBodyConfig & mbc,
                                   const std::vector<sva::MotionVecd> & normalAccB)
+{
+  updateTask(mb, mbc, normalAccB, nullptr);
+}
+
+void SurfaceTransformTask::update(const rbd::MultiBody & mb,
+                                  const rbd::MultiBodyConfig & mbc,
+                                  const std::vector<sva::MotionVecd> & normalAccB,
+                                  const Eigen::MatrixXd & motionSubspaceW)
+{
+  updateTask(mb, mbc, normalAccB, &motionSubspaceW);
+}
+
+void SurfaceTransformTask::updateTask(const rbd::MultiBody & mb,
+                                      const rbd::MultiBodyConfig & mbc,
+                                      const std::vector<sva::MotionVecd> & normalAccB,
+                                      const Eigen::MatrixXd * motionSubspaceW)
 {
   sva::PTransformd X_0_p = X_b_p_ * mbc.bodyPosW[bodyIndex_];
   sva::PTransformd X_p_t = X_0_t_ * X_0_p.inv();
@@ -274,15 +464,16 @@ void SurfaceTransformTask::update(const rbd::MultiBody & mb,
   speed_ = -V_err_p.vector();
   normalAcc_ = -(V_err_p.cross(w_p_p) + err_p.cross(wAN_p_p) - AN_p_p).vector();
 
-  jacMatTmp_ = jac_.jacobian(mb, mbc, X_0_p);
+  if(motionSubspaceW) { jacobianFromSweep(mb, jac_, *motionSubspaceW, X_0_p, shortJacMat_); }
+  else { shortJacMat_ = jac_.jacobian(mb, mbc, X_0_p); }
 
   for(int i = 0; i < jac_.dof(); ++i)
   {
-    jacMatTmp_.col(i).head<6>() -=
-        err_p.cross(sva::MotionVecd(jacMatTmp_.col(i).head<3>(), Eigen::Vector3d::Zero())).vector();
+    shortJacMat_.col(i).head<6>() -=
+        err_p.cross(sva::MotionVecd(shortJacMat_.col(i).head<3>(), Eigen::Vector3d::Zero())).vector();
   }
 
-  jac_.fullJacobian(mb, jacMatTmp_, jacMat_);
+  jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 /**
@@ -311,6 +502,22 @@ const Eigen::Matrix3d & TransformTask::E_0_c() const
 void TransformTask::update(const rbd::MultiBody & mb,
                            const rbd::MultiBodyConfig & mbc,
                            const std::vector<sva::MotionVecd> & normalAccB)
+{
+  updateTask(mb, mbc, normalAccB, nullptr);
+}
+
+void TransformTask::update(const rbd::MultiBody & mb,
+                           const rbd::MultiBodyConfig & mbc,
+                           const std::vector<sva::MotionVecd> & normalAccB,
+                           const Eigen::MatrixXd & motionSubspaceW)
+{
+  updateTask(mb, mbc, normalAccB, &motionSubspaceW);
+}
+
+void TransformTask::updateTask(const rbd::MultiBody & mb,
+                               const rbd::MultiBodyConfig & mbc,
+                               const std::vector<sva::MotionVecd> & normalAccB,
+                               const Eigen::MatrixXd * motionSubspaceW)
 {
   sva::PTransformd X_0_p(X_b_p_ * mbc.bodyPosW[bodyIndex_]);
   sva::PTransformd E_p_c(Eigen::Matrix3d(E_0_c_ * X_0_p.rotation().transpose()));
@@ -321,9 +528,16 @@ void TransformTask::update(const rbd::MultiBody & mb,
   eval_ = (sva::PTransformd(E_0_c_) * sva::transformError(X_0_p, X_0_t_)).vector();
   speed_ = V_p_c.vector();
   normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB, X_b_p_c, w_p_c).vector();
-  const auto & shortJacMat = jac_.jacobian(mb, mbc, E_p_c * X_0_p);
-
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+  if(motionSubspaceW)
+  {
+    jacobianFromSweep(mb, jac_, *motionSubspaceW, E_p_c * X_0_p, shortJacMat_);
+    jac_.fullJacobian(mb, shortJacMat_, jacMat_);
+  }
+  else
+  {
+    fusedJacobian(mb, mbc, jac_, E_p_c * X_0_p, 0, 6, jacDofs_, shortJacMat_, jacMat_, nullptr);
+    if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+  }
 }
 
 /**
@@ -461,7 +675,9 @@ SurfaceOrientationTask::SurfaceOrientationTask(const rbd::MultiBody & mb,
                                                const Eigen::Quaterniond & ori,
                                                const sva::PTransformd & X_b_s)
 : ori_(ori.matrix()), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName), X_b_s_(X_b_s), eval_(3), speed_(3),
-  normalAcc_(3), jacMat_(3, mb.nrDof()), jacDotMat_(3, mb.nrDof())
+  normalAcc_(3), shortJacMat_(3, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(3, mb.nrDof())),
+  jacDotMat_(3, mb.nrDof()), jacDofs_(jacobianDofs(mb, jac_)),
+  pathNormalAccB_(static_cast<size_t>(mb.nrBodies()), sva::MotionVecd(Eigen::Vector6d::Zero()))
 {
 }
 
@@ -470,7 +686,9 @@ SurfaceOrientationTask::SurfaceOrientationTask(const rbd::MultiBody & mb,
                                                const Eigen::Matrix3d & ori,
                                                const sva::PTransformd & X_b_s)
 : ori_(ori), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName), X_b_s_(X_b_s), eval_(3), speed_(3),
-  normalAcc_(3), jacMat_(3, mb.nrDof()), jacDotMat_(3, mb.nrDof())
+  normalAcc_(3), shortJacMat_(3, jac_.dof()), jacMat_(Eigen::MatrixXd::Zero(3, mb.nrDof())),
+  jacDotMat_(3, mb.nrDof()), jacDofs_(jacobianDofs(mb, jac_)),
+  pathNormalAccB_(static_cast<size_t>(mb.nrBodies()), sva::MotionVecd(Eigen::Vector6d::Zero()))
 {
 }
 
@@ -491,30 +709,46 @@ const Eigen::Matrix3d & SurfaceOrientationTask::orientation() const
 
 void SurfaceOrientationTask::update(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
 {
+  fusedJacobian(mb, mbc, jac_, X_b_s_ * mbc.bodyPosW[bodyIndex_], 0, 3, jacDofs_, shortJacMat_, jacMat_,
+                &pathNormalAccB_);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
   eval_ = sva::rotationVelocity<double>(ori_ * mbc.bodyPosW[bodyIndex_].rotation().transpose()
                                         * X_b_s_.rotation().transpose());
   speed_ = jac_.velocity(mb, mbc, X_b_s_).angular();
   // since X_b_s is constant, the X_b_s velocity
   // (last argument of normalAccelation) is a 0 velocity vector
-  normalAcc_ = jac_.normalAcceleration(mb, mbc, X_b_s_, sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
-
-  const auto & shortJacMat = jac_.jacobian(mb, mbc, X_b_s_ * mbc.bodyPosW[bodyIndex_]).block(0, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+  normalAcc_ =
+      jac_.normalAcceleration(mb, mbc, pathNormalAccB_, X_b_s_, sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
 }
 
 void SurfaceOrientationTask::update(const rbd::MultiBody & mb,
                                     const rbd::MultiBodyConfig & mbc,
                                     const std::vector<sva::MotionVecd> & normalAccB)
 {
+  fusedJacobian(mb, mbc, jac_, X_b_s_ * mbc.bodyPosW[bodyIndex_], 0, 3, jacDofs_, shortJacMat_, jacMat_, nullptr);
+  if(jacDofs_.empty()) { jac_.fullJacobian(mb, shortJacMat_, jacMat_); }
+
   eval_ = sva::rotationVelocity<double>(ori_ * mbc.bodyPosW[bodyIndex_].rotation().transpose()
                                         * X_b_s_.rotation().transpose());
   speed_ = jac_.velocity(mb, mbc, X_b_s_).angular();
   // since X_b_s is constant, the X_b_s velocity
   // (third argument of normalAccelation) is a 0 velocity vector
   normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB, X_b_s_, sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
+}
 
-  const auto & shortJacMat = jac_.jacobian(mb, mbc, X_b_s_ * mbc.bodyPosW[bodyIndex_]).block(0, 0, 3, jac_.dof());
-  jac_.fullJacobian(mb, shortJacMat, jacMat_);
+void SurfaceOrientationTask::update(const rbd::MultiBody & mb,
+                                    const rbd::MultiBodyConfig & mbc,
+                                    const std::vector<sva::MotionVecd> & normalAccB,
+                                    const Eigen::MatrixXd & motionSubspaceW)
+{
+  eval_ = sva::rotationVelocity<double>(ori_ * mbc.bodyPosW[bodyIndex_].rotation().transpose()
+                                        * X_b_s_.rotation().transpose());
+  speed_ = jac_.velocity(mb, mbc, X_b_s_).angular();
+  normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB, X_b_s_, sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
+
+  jacobianFromSweep(mb, jac_, motionSubspaceW, X_b_s_ * mbc.bodyPosW[bodyIndex_], shortJacMat_, 0, 3);
+  jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 void SurfaceOrientationTask::updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
@@ -683,6 +917,124 @@ const Eigen::MatrixXd & GazeTask::jacDot() const
   return jacDotMat_;
 }
 
+/**
+ *													MultiGazeTask
+ */
+
+MultiGazeTask::MultiGazeTask(const rbd::MultiBody & mb,
+                             const std::string & bodyName,
+                             const Eigen::Matrix2Xd & points2d,
+                             const Eigen::VectorXd & depthEstimates,
+                             const sva::PTransformd & X_b_gaze,
+                             const Eigen::Matrix2Xd & points2d_ref)
+: points2d_(), points2d_ref_(), depthEstimates_(), bodyIndex_(mb.bodyIndexByName(bodyName)), jac_(mb, bodyName),
+  X_b_gaze_(X_b_gaze), eval_(2 * points2d.cols()), speed_(2 * points2d.cols()), normalAcc_(2 * points2d.cols()),
+  L_img_(2 * points2d.cols(), 6), shortJacMat_(2 * points2d.cols(), jac_.dof()),
+  jacMat_(2 * points2d.cols(), mb.nrDof())
+{
+  points2d_ = points2d;
+  points2d_ref_.setZero(2, points2d.cols());
+  depthEstimates_.setZero(points2d.cols());
+  error(points2d, depthEstimates, points2d_ref.cols() == 0 ? points2d_ref_ : points2d_ref);
+}
+
+MultiGazeTask::MultiGazeTask(const rbd::MultiBody & mb,
+                             const std::string & bodyName,
+                             const Eigen::Matrix3Xd & points3d,
+                             const sva::PTransformd & X_b_gaze,
+                             const Eigen::Matrix2Xd & points2d_ref)
+: MultiGazeTask(mb,
+                bodyName,
+                (points3d.topRows<2>().array().rowwise() / points3d.row(2).array()).matrix(),
+                points3d.row(2).transpose(),
+                X_b_gaze,
+                points2d_ref)
+{
+}
+
+void MultiGazeTask::error(int index,
+                          const Eigen::Vector2d & point2d,
+                          double depthEstimate,
+                          const Eigen::Vector2d & point2d_ref)
+{
+  points2d_.col(index) = point2d;
+  depthEstimates_(index) = depthEstimate;
+  points2d_ref_.col(index) = point2d_ref;
+}
+
+void MultiGazeTask::error(int index, const Eigen::Vector3d & point3d, const Eigen::Vector2d & point2d_ref)
+{
+  error(index, Eigen::Vector2d(point3d[0] / point3d[2], point3d[1] / point3d[2]), point3d[2], point2d_ref);
+}
+
+void MultiGazeTask::error(const Eigen::Matrix2Xd & points2d,
+                          const Eigen::VectorXd & depthEstimates,
+                          const Eigen::Matrix2Xd & points2d_ref)
+{
+  if(points2d.cols() != nrPoints() || depthEstimates.size() != nrPoints() || points2d_ref.cols() != nrPoints())
+  {
+    throw std::domain_error("MultiGazeTask: points, depth estimates and references must have the same size");
+  }
+  points2d_ = points2d;
+  depthEstimates_ = depthEstimates;
+  points2d_ref_ = points2d_ref;
+}
+
+void MultiGazeTask::update(const rbd::MultiBody & mb,
+                           const rbd::MultiBodyConfig & mbc,
+                           const std::vector<sva::MotionVecd> & normalAccB)
+{
+  // camera kinematics are computed once for all the points
+  const Eigen::Vector6d surfaceVelocity = jac_.velocity(mb, mbc, X_b_gaze_).vector();
+  const Eigen::Vector6d surfaceNormalAcc =
+      jac_.normalAcceleration(mb, mbc, normalAccB, X_b_gaze_, sva::MotionVecd(Eigen::Vector6d::Zero())).vector();
+
+  eval_ = Eigen::Map<const Eigen::VectorXd>(points2d_ref_.data(), 2 * nrPoints())
+          - Eigen::Map<const Eigen::VectorXd>(points2d_.data(), 2 * nrPoints());
+
+  Eigen::Matrix<double, 2, 6> L_img, L_img_dot;
+  Eigen::Matrix<double, 1, 6> L_Z_dot;
+  for(int i = 0; i < nrPoints(); ++i)
+  {
+    const Eigen::Vector2d point2d = points2d_.col(i);
+    const double depth = depthEstimates_(i);
+
+    rbd::imagePointJacobian(point2d, depth, L_img);
+    const Eigen::Vector2d speed = L_img * surfaceVelocity;
+
+    rbd::depthDotJacobian(speed, depth, L_Z_dot);
+    rbd::imagePointJacobianDot(point2d, speed, depth, (L_Z_dot * surfaceVelocity).value(), L_img_dot);
+
+    speed_.segment<2>(2 * i) = speed;
+    normalAcc_.segment<2>(2 * i).noalias() = L_img * surfaceNormalAcc + L_img_dot * surfaceVelocity;
+    L_img_.middleRows<2>(2 * i) = L_img;
+  }
+
+  // one product for all the points
+  shortJacMat_.noalias() = L_img_ * jac_.jacobian(mb, mbc, X_b_gaze_ * mbc.bodyPosW[bodyIndex_]);
+  jac_.fullJacobian(mb, shortJacMat_, jacMat_);
+}
+
+const Eigen::VectorXd & MultiGazeTask::eval() const
+{
+  return eval_;
+}
+
+const Eigen::VectorXd & MultiGazeTask::speed() const
+{
+  return speed_;
+}
+
+const Eigen::VectorXd & MultiGazeTask::normalAcc() const
+{
+  return normalAcc_;
+}
+
+const Eigen::MatrixXd & MultiGazeTask::jac() const
+{
+  return jacMat_;
+}
+
 /**
  *													PositionBasedVisServoTask
  */
@@ -1023,6 +1375,16 @@ void CoMTask::update(const rbd::MultiBody & mb,
   jacMat_ = jac_.jacobian(mb, mbc);
 }
 
+void CoMTask::update(const CentroidalData & centroidal)
+{
+  actual_ = centroidal.com;
+  eval_ = com_ - actual_;
+
+  speed_ = centroidal.comVelocity;
+  normalAcc_ = centroidal.comNormalAcc;
+  jacMat_ = centroidal.comJac;
+}
+
 void CoMTask::updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
 {
   jacDotMat_ = jac_.jacobianDot(mb, mbc);
@@ -1164,6 +1526,25 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody> & mbs,
   }
 }
 
+void MultiCoMTask::update(const std::vector<const CentroidalData *> & centroidal)
+{
+  assert(centroidal.size() == robotIndexes_.size());
+
+  eval_ = com_;
+  speed_.setZero();
+  normalAcc_.setZero();
+  for(std::size_t i = 0; i < robotIndexes_.size(); ++i)
+  {
+    const CentroidalData & cd = *centroidal[i];
+    const double w = robotsWeight_[i];
+
+    eval_ -= cd.com * w;
+    speed_ += cd.comVelocity * w;
+    normalAcc_ += cd.comNormalAcc * w;
+    jacMat_[i].noalias() = w * cd.comJac;
+  }
+}
+
 void MultiCoMTask::computeRobotsWeight(const std::vector<rbd::MultiBody> & mbs)
 {
   double totalMass = 0.;
@@ -1249,6 +1630,13 @@ void MomentumTask::update(const rbd::MultiBody & mb,
   jacMat_ = momentumMatrix_.matrix();
 }
 
+void MomentumTask::update(const CentroidalData & centroidal)
+{
+  eval_ = momentum_.vector() - centroidal.momentum.vector();
+  normalAcc_ = centroidal.normalMomentumDot.vector();
+  jacMat_ = centroidal.momentumMatrix;
+}
+
 void MomentumTask::updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc)
 {
   momentumMatrix_.computeMatrixDot(mb, mbc, rbd::computeCoM(mb, mbc), rbd::computeCoMVelocity(mb, mbc));
@@ -6,6 +6,7 @@
 
 // includes
 // std
+#include <utility>
 #include <vector>
 
 // Tasks
@@ -37,7 +38,8 @@ class GenQPSolver;
 
 /**
  * Factory to create GenQPSolver implementation.
- * Two argument are supported QLD and LSSOL.
+ * Supported arguments are QLD, LSSOL and ADMM.
+ * ADMM is a sparse solver intended for large problems.
  */
 TASKS_DLLAPI GenQPSolver * createQPSolver(const std::string & name);
 
@@ -109,7 +111,113 @@ public:
   /// @return Name of the solver
   virtual std::string name() const = 0;
 
+  /**
+   * Eliminate the equality constraints before calling the QP solver.
+   * The problem is solved in the equality null space \f$ x = x_0 + Z y \f$,
+   * the bounds are then handled as general inequalities.
+   * It's only implemented by the QLD solver and disabled by default.
+   */
+  void nullSpaceReduction(bool enable) { nullSpaceReduction_ = enable; }
+  bool nullSpaceReduction() const { return nullSpaceReduction_; }
+
+  /**
+   * Split the problem in independent sub-problems before calling the QP solver.
+   * Two variables are in the same sub-problem when they share a task or a
+   * constraint line or when they have the same group (see setVariableGroups).
+   * Each sub-problem is solved in its own thread. The QLD calls themselves are
+   * serialized unless Tasks is built with the QLD_REENTRANT option, which
+   * require an eigen-qld build whose QL0001 is reentrant.
+   * It's only implemented by the QLD solver and disabled by default.
+   */
+  void decomposition(bool enable) { decomposition_ = enable; }
+  bool decomposition() const { return decomposition_; }
+
+  /**
+   * @return Number of sub-problems solved in parallel by the last solve,
+   * 1 when the problem has been solved as a whole.
+   */
+  virtual int nrSubProblems() const { return 1; }
+
+  /**
+   * Set the group of each variable of the full problem, variables of the same
+   * group are never split by the decomposition.
+   * @param groups Group index of each variable, a negative index put the
+   * variable in its own group. An empty vector put each variable in its own group.
+   */
+  void setVariableGroups(std::vector<int> groups) { variableGroups_ = std::move(groups); }
+  const std::vector<int> & variableGroups() const { return variableGroups_; }
+
+  /**
+   * Solve the problem by consensus ADMM between the variable groups
+   * (see setVariableGroups).
+   * Each group solves the projection on the constraint lines starting on its
+   * variables in its own thread, with a local copy of the other groups
+   * variables involved in these lines. The copies are then averaged with the
+   * task objective until they agree.
+   * The previous solution and multipliers are used as warm start.
+   * When the decomposition is also enabled, the consensus is only used if the
+   * problem can't be split in independent sub-problems.
+   * The full problem is solved if the consensus doesn't converge.
+   * Each variable of the result comes from the group that own it. The
+   * constraint lines that only involve the variables of one group are then
+   * satisfied to the QLD precision, but the lines that couple several groups
+   * are only satisfied to within the consensus tolerance.
+   * The QLD calls are serialized as for the decomposition.
+   * It's only implemented by the QLD solver and disabled by default.
+   */
+  void consensus(bool enable) { consensus_ = enable; }
+  bool consensus() const { return consensus_; }
+
+  /**
+   * @param rho Initial ADMM penalty, it's then adapted to balance the residuals.
+   * @param tolerance Primal and dual residual norm tolerance.
+   * @param maxIter Maximum number of ADMM iterations by solve.
+   */
+  void consensusParameters(double rho, double tolerance, int maxIter)
+  {
+    consensusRho_ = rho;
+    consensusTolerance_ = tolerance;
+    consensusMaxIter_ = maxIter;
+  }
+  double consensusRho() const { return consensusRho_; }
+  double consensusTolerance() const { return consensusTolerance_; }
+  int consensusMaxIter() const { return consensusMaxIter_; }
+
+  /**
+   * Parameters of the ADMM solver, they are not used by the other solvers.
+   * @param absTol Absolute tolerance on the primal and dual residuals.
+   * @param relTol Relative tolerance on the primal and dual residuals.
+   * @param maxIter Maximum number of ADMM iterations by solve.
+   */
+  void admmParameters(double absTol, double relTol, int maxIter)
+  {
+    admmAbsTolerance_ = absTol;
+    admmRelTolerance_ = relTol;
+    admmMaxIter_ = maxIter;
+  }
+  double admmAbsTolerance() const { return admmAbsTolerance_; }
+  double admmRelTolerance() const { return admmRelTolerance_; }
+  int admmMaxIter() const { return admmMaxIter_; }
+
+  /// @return Number of iterations of the last solve, 0 if the solver is not iterative.
+  virtual int nrIterations() const { return 0; }
+
 protected:
+  /** Eliminate the equality constraints, see nullSpaceReduction */
+  bool nullSpaceReduction_ = false;
+  /** Split the problem in independent sub-problems, see decomposition */
+  bool decomposition_ = false;
+  /** Group of each full variable, see setVariableGroups */
+  std::vector<int> variableGroups_;
+  /** Consensus ADMM solve, see consensus and consensusParameters */
+  bool consensus_ = false;
+  double consensusRho_ = 1.;
+  double consensusTolerance_ = 1e-7;
+  int consensusMaxIter_ = 2000;
+  /** ADMM solver parameters, see admmParameters */
+  double admmAbsTolerance_ = 1e-6;
+  double admmRelTolerance_ = 1e-6;
+  int admmMaxIter_ = 4000;
   /** Correspondence between full variable indices and reduced variables */
   std::vector<int> fullToReduced_;
   /** Correspondence between reduced variable indices and full variable indices */
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+#pragma once
+
+// includes
+// std
+#include <string>
+#include <utility>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
+// SpaceVecAlg
+#include <tasks/config.hh>
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+// Tasks
+#include "QPCollisionPrimitives.h"
+
+// forward declaration
+// RBDyn
+namespace rbd
+{
+class MultiBody;
+struct MultiBodyConfig;
+} // namespace rbd
+
+namespace tasks
+{
+struct QBound;
+
+namespace qp
+{
+class CollisionConstr;
+
+/// Collision primitive attached to a robot body.
+struct TASKS_DLLAPI BodyPrimitive
+{
+  BodyPrimitive() {}
+  /**
+   * @param bodyName Body the primitive is attached to.
+   * @param primitive Body collision geometry.
+   * @param X_b_p Primitive frame in body frame.
+   */
+  BodyPrimitive(std::string bodyName,
+                const CollisionPrimitive & primitive,
+                const sva::PTransformd & X_b_p = sva::PTransformd::Identity())
+  : bodyName(std::move(bodyName)), primitive(primitive), X_b_p(X_b_p)
+  {
+  }
+
+  std::string bodyName;
+  CollisionPrimitive primitive;
+  sva::PTransformd X_b_p;
+};
+
+/// Pair of bodies that must be checked for self-collision.
+struct TASKS_DLLAPI SelfCollisionPair
+{
+  SelfCollisionPair() : body1(), body2() {}
+  SelfCollisionPair(std::string b1, std::string b2) : body1(std::move(b1)), body2(std::move(b2)) {}
+
+  bool operator==(const SelfCollisionPair & p) const
+  {
+    return body1 == p.body1 && body2 == p.body2;
+  }
+
+  std::string body1, body2;
+};
+
+/**
+ * Build the self-collision pair list of a robot.
+ * The naive list hold all the body pairs, generate remove the pairs
+ * that are rigidly linked or too close in the kinematic tree,
+ * filterUnreachable remove the pairs that never come close
+ * when sampling the robot configuration inside its joint limits.
+ * Since the sampling is costly the resulting list should be computed
+ * offline and saved with save, then reloaded with load.
+ */
+class TASKS_DLLAPI SelfCollisionPairs
+{
+public:
+  /**
+   * @param mb Robot.
+   * @param primitives Collision geometry of the robot bodies,
+   * only one primitive by body is allowed.
+   * @throw std::domain_error If a body appear twice in primitives.
+   */
+  SelfCollisionPairs(const rbd::MultiBody & mb, std::vector<BodyPrimitive> primitives);
+
+  /**
+   * Generate all the pairs between bodies that have a primitive and remove
+   * kinematically coupled ones.
+   * Box-box pairs have no analytic distance, they are not added to the pair
+   * list but returned so the caller can guard them with sch-core objects
+   * (see CollisionConstr::addCollision).
+   * @param minJointDist Pairs that are linked by less than minJointDist
+   * moving joints are removed. Rigidly linked bodies (0 moving joint) are always
+   * removed and the default value also remove adjacent bodies.
+   * @return Box-box pairs that can collide (see unsupportedPairs).
+   */
+  const std::vector<SelfCollisionPair> & generate(int minJointDist = 2);
+
+  /**
+   * Remove the pairs that can't collide.
+   * Configurations are uniformly sampled inside the joint limits and a pair is
+   * kept if its distance go below margin for at least one sample.
+   * @param mb Robot (must be the same given in the constructor).
+   * @param mbc Configuration used for the root joint and as first sample.
+   * @param bound Joint limits, revolute joints with infinite limits are sampled
+   * in \f$ [-\pi, \pi] \f$.
+   * @param nrSamples Number of sampled configurations.
+   * @param margin Distance under which a pair is considered reachable.
+   * @param seed Random generator seed.
+   * @throw std::domain_error If a non revolute one dof joint have infinite limits.
+   */
+  void filterUnreachable(const rbd::MultiBody & mb,
+                         const rbd::MultiBodyConfig & mbc,
+                         const QBound & bound,
+                         int nrSamples,
+                         double margin,
+                         unsigned int seed = 0);
+
+  /// @return Current pair list.
+  const std::vector<SelfCollisionPair> & pairs() const;
+  /**
+   * @return Pairs found by the last generate call that are not in the pair list
+   * because they have no analytic distance, they are not guarded by
+   * addToConstraint.
+   */
+  const std::vector<SelfCollisionPair> & unsupportedPairs() const;
+
+  /// Save the pair list in a text file, one "body1 body2" pair by line.
+  void save(const std::string & filename) const;
+
+  /**
+   * Replace the pair list by the one saved in filename.
+   * @throw std::runtime_error If the file can't be read, reference
+   * a body without primitive or a box-box pair.
+   */
+  void load(const std::string & filename);
+
+  /**
+   * Add all the pairs to a CollisionConstr.
+   * @param constr Collision constraint.
+   * @param mbs Multi-robot system.
+   * @param rIndex Robot index in mbs.
+   * @param firstCollId Collision id of the first pair, next pairs use
+   * consecutive ids.
+   * @param di \f$ d_i \f$.
+   * @param ds \f$ d_s \f$.
+   * @param damping \f$ \xi \f$, if set to 0 the damping is computed automatically.
+   * @param dampingOff \f$ \xi_{\text{off}} \f$.
+   * @return Next unused collision id.
+   */
+  int addToConstraint(CollisionConstr & constr,
+                      const std::vector<rbd::MultiBody> & mbs,
+                      int rIndex,
+                      int firstCollId,
+                      double di,
+                      double ds,
+                      double damping,
+                      double dampingOff = 0.) const;
+
+private:
+  /// @return Index of bodyName in primitives_.
+  std::size_t primitiveIndex(const std::string & bodyName) const;
+  /// @return Number of moving joints between body b1 and b2.
+  int movingJointsBetween(int b1, int b2) const;
+
+private:
+  std::vector<int> parent_; ///< Parent body index of each body (-1 for the root)
+  std::vector<bool> moving_; ///< true if the joint supporting a body have dof
+  std::vector<BodyPrimitive> primitives_;
+  std::vector<int> bodyIndex_; ///< Body index of each primitive
+  std::vector<SelfCollisionPair> pairs_;
+  std::vector<SelfCollisionPair> unsupportedPairs_;
+};
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+#pragma once
+
+// includes
+// Eigen
+#include <Eigen/Core>
+
+// SpaceVecAlg
+#include <tasks/config.hh>
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+/**
+ * Analytic collision geometry.
+ * Distances between primitives are computed in closed form and avoid
+ * the iterative sch-core closest points query.
+ * All primitives are centered on their frame origin, the capsule axis is
+ * the frame z axis.
+ */
+struct TASKS_DLLAPI CollisionPrimitive
+{
+  enum class Type
+  {
+    Sphere,
+    Capsule,
+    Box
+  };
+
+  CollisionPrimitive();
+
+  /// @param radius Sphere radius.
+  static CollisionPrimitive sphere(double radius);
+  /**
+   * @param length Distance between the two hemisphere centers.
+   * @param radius Capsule radius.
+   */
+  static CollisionPrimitive capsule(double length, double radius);
+  /// @param size Box size along the x, y and z axis.
+  static CollisionPrimitive box(const Eigen::Vector3d & size);
+
+  Type type;
+  /// Sphere and capsule radius.
+  double radius;
+  /// Half of the capsule length (0 for a sphere).
+  double halfLength;
+  /// Box half size.
+  Eigen::Vector3d halfExtents;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * @return true if the distance between primitives of type t1 and t2
+ * can be computed by primitiveDistance.
+ * Box-box is the only unsupported combination.
+ */
+TASKS_DLLAPI bool hasAnalyticDistance(CollisionPrimitive::Type t1, CollisionPrimitive::Type t2);
+
+/**
+ * Compute the signed distance between two primitives.
+ * @param prim1 First primitive.
+ * @param X_0_p1 First primitive position in world frame.
+ * @param prim2 Second primitive.
+ * @param X_0_p2 Second primitive position in world frame.
+ * @param p1 Closest point of prim1 in world frame.
+ * @param p2 Closest point of prim2 in world frame.
+ * @return Distance between the primitives, negative if they are interpenetrating.
+ * In all cases \f$ p_1 - p_2 = d n \f$ with \f$ n \f$ the unit vector going from
+ * prim2 to prim1.
+ * @throw std::domain_error If hasAnalyticDistance(prim1.type, prim2.type) is false.
+ */
+TASKS_DLLAPI double primitiveDistance(const CollisionPrimitive & prim1,
+                                      const sva::PTransformd & X_0_p1,
+                                      const CollisionPrimitive & prim2,
+                                      const sva::PTransformd & X_0_p2,
+                                      Eigen::Vector3d & p1,
+                                      Eigen::Vector3d & p2);
+
+} // namespace qp
+
+} // namespace tasks
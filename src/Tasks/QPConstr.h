@@ -17,6 +17,7 @@
 #include <sch/Matrix/SCH_Types.h>
 
 // Tasks
+#include "QPCollisionPrimitives.h"
 #include "QPSolver.h"
 
 // unique_ptr
@@ -112,11 +113,9 @@ private:
   int robotIndex_, alphaDBegin_, alphaDOffset_;
   double step_;
   Eigen::VectorXd qMin_, qMax_;
-  Eigen::VectorXd qVec_, alphaVec_;
   Eigen::VectorXd lower_, upper_;
   Eigen::VectorXd alphaDLower_, alphaDUpper_;
   Eigen::VectorXd alphaDDLower_, alphaDDUpper_;
-  Eigen::VectorXd prevAlphaD_;
 };
 
 /**
@@ -234,38 +233,31 @@ public:
   double computeDamper(double dist, double iDist, double sDist, double damping);
 
 private:
-  struct DampData
+  enum State
   {
-    enum State
-    {
-      Low,
-      Upp,
-      Free
-    };
-
-    DampData(double mi, double ma, double miV, double maV, double idi, double sdi, int aDB, int i)
-    : min(mi), max(ma), minVel(miV), maxVel(maV), iDist(idi), sDist(sdi), jointIndex(i), alphaDBegin(aDB), damping(0.),
-      state(Free)
-    {
-    }
-
-    double min, max;
-    double minVel, maxVel;
-    double iDist, sDist;
-    int jointIndex;
-    int alphaDBegin;
-    double damping;
-    State state;
+    Low,
+    Upp,
+    Free
   };
 
 private:
   int robotIndex_, alphaDBegin_;
-  std::vector<DampData> data_;
+
+  /// 1 dof joints data, one element by joint
+  Eigen::VectorXi qParam_, alphaDPos_;
+  Eigen::ArrayXd min_, max_;
+  Eigen::ArrayXd minVel_, maxVel_;
+  Eigen::ArrayXd iDist_, sDist_;
+  Eigen::ArrayXd damping_;
+  Eigen::ArrayXi state_, newState_;
+  /// 1 dof joints work buffers
+  Eigen::ArrayXd jointQ_, jointAlpha_;
+  Eigen::ArrayXd lowDist_, uppDist_, dist_, damper_;
+  Eigen::ArrayXd jointLower_, jointUpper_;
 
   Eigen::VectorXd lower_, upper_;
   Eigen::VectorXd alphaDLower_, alphaDUpper_;
   Eigen::VectorXd alphaDDLower_, alphaDDUpper_;
-  Eigen::VectorXd prevAlphaD_;
   double step_;
   double damperOff_;
 };
@@ -338,6 +330,33 @@ public:
                     const Eigen::VectorXd & r1Selector = Eigen::VectorXd::Zero(0),
                     const Eigen::VectorXd & r2Selector = Eigen::VectorXd::Zero(0));
 
+  /**
+   * Add a collision avoidance constraint between two analytic primitives.
+   * The distance is computed in closed form instead of using sch-core.
+   * Parameters are the same as the sch-core version except for:
+   * @param prim1 Primitive associated to the r1BodyName link.
+   * @param X_op1_o1 prim1 frame in r1BodyName frame.
+   * @param prim2 Primitive associated to the r2BodyName link.
+   * @param X_op2_o2 prim2 frame in r2BodyName frame.
+   * @throw std::domain_error If there is no analytic distance between prim1 and prim2.
+   */
+  void addCollision(const std::vector<rbd::MultiBody> & mbs,
+                    int collId,
+                    int r1Index,
+                    const std::string & r1BodyName,
+                    const CollisionPrimitive & prim1,
+                    const sva::PTransformd & X_op1_o1,
+                    int r2Index,
+                    const std::string & r2BodyName,
+                    const CollisionPrimitive & prim2,
+                    const sva::PTransformd & X_op2_o2,
+                    double di,
+                    double ds,
+                    double damping,
+                    double dampingOff = 0.,
+                    const Eigen::VectorXd & r1Selector = Eigen::VectorXd::Zero(0),
+                    const Eigen::VectorXd & r2Selector = Eigen::VectorXd::Zero(0));
+
   /**
    * Remove a collision avoidance constraint.
    * @param collId Collision id to remove.
@@ -371,6 +390,8 @@ public:
 
   virtual const Eigen::MatrixXd & AInEq() const override;
   virtual const Eigen::VectorXd & bInEq() const override;
+  /// AInEq only store the alphaD columns of the robots involved in a collision.
+  virtual const ColumnSegments & columnsInEq() const override;
 
 private:
   struct BodyCollData
@@ -390,6 +411,19 @@ private:
     Eigen::VectorXd selector;
   };
 
+  struct PrimitiveData
+  {
+    PrimitiveData(const rbd::MultiBody & mb,
+                  int rIndex,
+                  const std::string & bodyName,
+                  const CollisionPrimitive & primitive,
+                  const sva::PTransformd & X_op_o);
+
+    CollisionPrimitive primitive;
+    sva::PTransformd X_op_o;
+    int rIndex, bIndex;
+  };
+
   struct CollData
   {
     enum class DampingType
@@ -406,12 +440,22 @@ private:
              double ds,
              double damping,
              double dampingOff);
+    CollData(std::vector<BodyCollData> bcds,
+             int collId,
+             std::vector<PrimitiveData> prims,
+             double di,
+             double ds,
+             double damping,
+             double dampingOff);
     CollData(CollData &&) = default;
     CollData(const CollData &) = delete;
     CollData & operator=(const CollData &) = delete;
     CollData & operator=(CollData &&) = default;
 
+    /// sch-core pair, nullptr if the distance is computed from primitives.
     std::unique_ptr<sch::CD_Pair> pair;
+    /// Analytic primitives of both bodies, empty if pair is used.
+    std::vector<PrimitiveData> primitives;
     double distance;
     Eigen::Vector3d p1;
     Eigen::Vector3d p2;
@@ -439,14 +483,17 @@ private:
 private:
   std::vector<CollData> dataVec_;
   double step_;
-  int nrActivated_, totalAlphaD_;
+  int nrActivated_;
 
   Eigen::MatrixXd AInEq_;
   Eigen::VectorXd bInEq_;
 
   Eigen::MatrixXd fullJac_, distJac_;
 
-  int nrVars_;
+  std::vector<int> robotDof_; ///< nrDof of each robot
+  std::vector<int> robotAlphaDBegin_; ///< alphaD begin of each robot in the QP variables
+  std::vector<int> robotCol_; ///< alphaD begin of each robot in AInEq_ (-1 if not involved)
+  ColumnSegments cols_;
 
   CollisionConstr(const CollisionConstr &) = delete;
   CollisionConstr & operator=(const CollisionConstr &) = delete;
@@ -555,6 +602,8 @@ public:
 
   virtual const Eigen::MatrixXd & AInEq() const override;
   virtual const Eigen::VectorXd & bInEq() const override;
+  /// AInEq only store the robot alphaD columns.
+  virtual const ColumnSegments & columnsInEq() const override;
 
 private:
   struct PlaneData
@@ -590,7 +639,7 @@ private:
   int robotIndex_, alphaDBegin_;
   std::vector<PlaneData> dataVec_;
   double step_;
-  int nrVars_;
+  ColumnSegments cols_;
   int nrActivated_;
   std::vector<std::size_t> activated_;
 
@@ -627,6 +676,8 @@ public:
 
   virtual const Eigen::MatrixXd & AInEq() const override;
   virtual const Eigen::VectorXd & bInEq() const override;
+  /// AInEq only store the bilateral contacts lambda columns.
+  virtual const ColumnSegments & columnsInEq() const override;
 
 private:
   struct GripperData
@@ -641,6 +692,7 @@ private:
 
 private:
   std::vector<GripperData> dataVec_;
+  ColumnSegments cols_;
 
   Eigen::MatrixXd AInEq_;
   Eigen::VectorXd bInEq_;
@@ -741,6 +793,8 @@ public:
   virtual const Eigen::MatrixXd & AGenInEq() const override;
   virtual const Eigen::VectorXd & LowerGenInEq() const override;
   virtual const Eigen::VectorXd & UpperGenInEq() const override;
+  /// AGenInEq only store the robot alphaD columns.
+  virtual const ColumnSegments & columnsGenInEq() const override;
 
 private:
   struct BoundedSpeedData
@@ -769,12 +823,12 @@ private:
   int robotIndex_, alphaDBegin_;
   std::vector<BoundedSpeedData> cont_;
 
-  Eigen::MatrixXd fullJac_;
+  Eigen::MatrixXd jacMat_, fullJac_;
 
   Eigen::MatrixXd A_;
   Eigen::VectorXd lower_, upper_;
 
-  int nrVars_;
+  ColumnSegments cols_;
   double timeStep_;
 };
 
@@ -854,17 +908,6 @@ public:
   void updatePoint(const int pointId, const Eigen::Vector2d & point2d, const double depthEstimate);
   void updatePoint(const int pointId, const Eigen::Vector3d & point3d);
 
-  void computeComponents(const rbd::MultiBody & mb,
-                         const rbd::MultiBodyConfig & mbc,
-                         const SolverData & data,
-                         const Eigen::Vector2d & point2d,
-                         const double depth,
-                         rbd::Jacobian & jac,
-                         const int bodyIndex,
-                         const sva::PTransformd & X_b_p,
-                         Eigen::MatrixXd & fullJacobian,
-                         Eigen::Vector2d & bCommonTerm);
-
   // Constraint
   virtual void updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data) override;
 
@@ -880,15 +923,10 @@ public:
 
   virtual const Eigen::MatrixXd & AInEq() const override;
   virtual const Eigen::VectorXd & bInEq() const override;
+  /// AInEq only store the robot alphaD columns.
+  virtual const ColumnSegments & columnsInEq() const override;
 
 private:
-  struct PointData
-  {
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    PointData(const Eigen::Vector2d & pt, const double d);
-    Eigen::Vector2d point2d;
-    double depthEstimate;
-  };
   struct RobotPointData
   {
     RobotPointData(const std::string & bName, const sva::PTransformd & X, const rbd::Jacobian & j);
@@ -898,24 +936,22 @@ private:
   };
 
 private:
-  std::vector<PointData, Eigen::aligned_allocator<PointData>> dataVec_;
+  /// points are stored column by column (structure of arrays)
+  Eigen::Matrix2Xd points2d_;
+  Eigen::VectorXd depthEstimates_;
   std::vector<RobotPointData> dataVecRob_;
   int robotIndex_, bodyIndex_, alphaDBegin_;
-  int nrVars_;
+  ColumnSegments cols_;
   double step_, accelFactor_;
   int nrActivated_;
 
   rbd::Jacobian jac_;
   sva::PTransformd X_b_gaze_;
-  std::unique_ptr<Eigen::Matrix<double, 2, 6>> L_img_;
-  std::unique_ptr<Eigen::Matrix<double, 6, 1>> surfaceVelocity_;
-  std::unique_ptr<Eigen::Matrix<double, 1, 6>> L_Z_dot_;
-  std::unique_ptr<Eigen::Matrix<double, 2, 6>> L_img_dot_;
-  std::unique_ptr<Eigen::Vector2d> speed_;
-  std::unique_ptr<Eigen::Vector2d> normalAcc_;
-  Eigen::MatrixXd jacMat_;
   std::unique_ptr<Eigen::Vector2d> iDistMin_, iDistMax_, sDistMin_, sDistMax_;
   double damping_, dampingOffset_, ineqInversion_, constrDirection_;
+  /// interaction matrix rows of the activated constraints
+  Eigen::MatrixXd LAct_;
+  Eigen::MatrixXd shortJacAct_, fullJacAct_;
   Eigen::MatrixXd AInEq_;
   Eigen::VectorXd bInEq_;
 };
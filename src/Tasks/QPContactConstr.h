@@ -16,6 +16,7 @@
 #include <RBDyn/Jacobian.h>
 
 // Tasks
+#include "QPContactJacobianPool.h"
 #include "QPSolver.h"
 
 namespace tasks
@@ -123,18 +124,20 @@ public:
 
   virtual const Eigen::MatrixXd & AEq() const override;
   virtual const Eigen::VectorXd & bEq() const override;
+  /// AEq only store the alphaD columns of the robots in contact.
+  virtual const ColumnSegments & columnsEq() const override;
 
 protected:
   struct ContactSideData
   {
-    ContactSideData(int rI, int aDB, double s, const rbd::Jacobian & j, const sva::PTransformd & Xbp)
-    : robotIndex(rI), alphaDBegin(aDB), bodyIndex(j.jointsPath().back()), sign(s), jac(j), X_b_p(Xbp)
+    ContactSideData(int rI, int aDB, double s, const rbd::Jacobian & j, int jI, const sva::PTransformd & Xbp)
+    : robotIndex(rI), alphaDBegin(aDB), bodyIndex(j.jointsPath().back()), sign(s), jacIndex(jI), X_b_p(Xbp)
     {
     }
 
-    int robotIndex, alphaDBegin, bodyIndex;
+    int robotIndex, alphaDBegin, bodyIndex; // alphaDBegin is the robot column in A_
     double sign;
-    rbd::Jacobian jac;
+    int jacIndex; // jacobian index in jacPool_
     sva::PTransformd X_b_p;
   };
 
@@ -179,14 +182,17 @@ protected:
 
 protected:
   std::vector<ContactData> cont_;
+  ContactJacobianPool jacPool_;
 
-  Eigen::MatrixXd fullJac_, dofJac_;
+  Eigen::MatrixXd fullJac_, dofJac_, jacMat_;
 
   Eigen::MatrixXd A_;
   Eigen::VectorXd b_;
+  ColumnSegments cols_;
 
-  int nrEq_, totalAlphaD_;
+  int nrEq_;
   double timeStep_;
+
 };
 
 /**
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+#pragma once
+
+// includes
+// std
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// RBDyn
+#include <RBDyn/Jacobian.h>
+
+#include <tasks/config.hh>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+/**
+ * Jacobians of the contact bodies kept between contact changes.
+ * The jacobian of a contact side is built the first time the robot body is
+ * in contact and reused each time a contact involving it is added again.
+ * Jacobians are referenced by index so a copy of the pool, and of the
+ * constraint holding it, keep using its own jacobians.
+ * Indices stay valid until clear is called.
+ */
+class TASKS_DLLAPI ContactJacobianPool
+{
+public:
+  /**
+   * @return Index of the jacobian of the bodyName body of robot robotIndex.
+   * The jacobian is rebuilt if its joints path no longer match the robot one.
+   */
+  int index(const std::vector<rbd::MultiBody> & mbs, int robotIndex, const std::string & bodyName);
+
+  rbd::Jacobian & operator[](int index) { return jacs_[static_cast<std::size_t>(index)]; }
+  const rbd::Jacobian & operator[](int index) const { return jacs_[static_cast<std::size_t>(index)]; }
+
+  /// Remove all the jacobians.
+  void clear()
+  {
+    indexes_.clear();
+    jacs_.clear();
+  }
+  /// @return Number of jacobians in the pool.
+  int size() const { return static_cast<int>(jacs_.size()); }
+
+private:
+  std::map<std::pair<int, std::string>, int> indexes_;
+  std::vector<rbd::Jacobian> jacs_;
+};
+
+} // namespace qp
+
+} // namespace tasks
@@ -6,6 +6,9 @@
 
 // include
 // std
+#include <functional>
+#include <ostream>
+#include <string>
 #include <vector>
 
 // Eigen
@@ -43,8 +46,78 @@ struct TASKS_DLLAPI FrictionCone
   std::vector<Eigen::Vector3d> generators;
 };
 
+/**
+ * Body name interned into a process wide integer id.
+ * It convert to and is assigned from std::string, the id is updated on each
+ * assignment so it always match the name.
+ */
+class TASKS_DLLAPI ContactBodyName
+{
+public:
+  ContactBodyName(const std::string & name = "");
+  ContactBodyName(const char * name) : ContactBodyName(std::string(name)) {}
+
+  ContactBodyName & operator=(const std::string & name);
+  ContactBodyName & operator=(const char * name) { return *this = std::string(name); }
+
+  operator const std::string &() const { return name_; }
+  const std::string & str() const { return name_; }
+  const char * c_str() const { return name_.c_str(); }
+  /// @return Interned name.
+  int id() const { return id_; }
+
+  /**
+   * @return Process wide unique integer associated with name.
+   * This method is thread safe.
+   */
+  static int intern(const std::string & name);
+
+private:
+  std::string name_;
+  int id_;
+};
+
+inline bool operator==(const ContactBodyName & n1, const ContactBodyName & n2)
+{
+  return n1.id() == n2.id();
+}
+inline bool operator!=(const ContactBodyName & n1, const ContactBodyName & n2)
+{
+  return n1.id() != n2.id();
+}
+inline bool operator==(const ContactBodyName & n1, const std::string & n2)
+{
+  return n1.str() == n2;
+}
+inline bool operator!=(const ContactBodyName & n1, const std::string & n2)
+{
+  return n1.str() != n2;
+}
+inline bool operator==(const std::string & n1, const ContactBodyName & n2)
+{
+  return n1 == n2.str();
+}
+inline bool operator!=(const std::string & n1, const ContactBodyName & n2)
+{
+  return n1 != n2.str();
+}
+inline bool operator==(const ContactBodyName & n1, const char * n2)
+{
+  return n1.str() == n2;
+}
+inline bool operator!=(const ContactBodyName & n1, const char * n2)
+{
+  return n1.str() != n2;
+}
+inline std::ostream & operator<<(std::ostream & out, const ContactBodyName & name)
+{
+  return out << name.str();
+}
+
 /**
  * Unique identifier for a contact.
+ * Body names are interned so comparison, ordering and hashing only involve
+ * integers.
  */
 struct TASKS_DLLAPI ContactId
 {
@@ -66,10 +139,22 @@ struct TASKS_DLLAPI ContactId
   bool operator==(const ContactId & cId) const;
   bool operator!=(const ContactId & cId) const;
 
+  /**
+   * Order by robot index, body id and ambiguityId.
+   * Body ids follow the interning order, not the body names order.
+   */
   bool operator<(const ContactId & cId) const;
 
+  /// @return Interned r1BodyName.
+  int r1BodyId() const { return r1BodyName.id(); }
+  /// @return Interned r2BodyName.
+  int r2BodyId() const { return r2BodyName.id(); }
+
+  /// @see ContactBodyName::intern
+  static int bodyId(const std::string & bodyName) { return ContactBodyName::intern(bodyName); }
+
   int r1Index, r2Index;
-  std::string r1BodyName, r2BodyName;
+  ContactBodyName r1BodyName, r2BodyName;
   int ambiguityId;
 };
 
@@ -350,6 +435,89 @@ private:
   void construct(const std::vector<Eigen::Matrix3d> & r1Frames, int nrGen, double mu);
 };
 
+/**
+ * Model of a rectangular surface contact.
+ * The contact force is a single wrench expressed in the surface frame at
+ * the surface center (6 lambda) instead of a set of friction cone generators
+ * by contact point.
+ * The wrench applied on r1 body must lie in the contact wrench cone of the
+ * surface (@see ContactWrenchConeConstr), r2 body receive the opposite wrench.
+ */
+struct TASKS_DLLAPI WrenchContact
+{
+  WrenchContact() {}
+
+  /**
+   * @param cId Contact id.
+   * @param X_b1_s Surface frame in r1BodyId frame. The surface normal is
+   * the z axis and point toward r1 body.
+   * @param halfLength Half length of the surface along the surface x axis.
+   * @param halfWidth Half width of the surface along the surface y axis.
+   * @param mu Coefficient of friction.
+   * @param X_b1_b2 Transformation between r1BodyId and r2BodyId frame.
+   * @param X_b1_cf Define the \f$ cf \f$ frame (common frame) used in
+   * the contact constraints.
+   * @see ContactConstrCommon::addDofContact
+   */
+  WrenchContact(const ContactId & cId,
+                const sva::PTransformd & X_b1_s,
+                double halfLength,
+                double halfWidth,
+                double mu,
+                const sva::PTransformd & X_b1_b2,
+                const sva::PTransformd & X_b1_cf = sva::PTransformd::Identity());
+
+  /// @return Wrench applied on r1 body origin in r1 body frame.
+  sva::ForceVecd r1Force(const Eigen::VectorXd & lambda) const;
+  /// @return Wrench applied on r2 body origin in r2 body frame.
+  sva::ForceVecd r2Force(const Eigen::VectorXd & lambda) const;
+
+  /// @return Number of lambda needed to compute the wrench.
+  int nrLambda() const { return 6; }
+
+  /**
+   * Safe version of @see r1Force.
+   * @throw std::domain_error If lambda size is not nrLambda.
+   */
+  sva::ForceVecd sR1Force(const Eigen::VectorXd & lambda) const;
+  /**
+   * Safe version of @see r2Force.
+   * @throw std::domain_error If lambda size is not nrLambda.
+   */
+  sva::ForceVecd sR2Force(const Eigen::VectorXd & lambda) const;
+
+  ContactId contactId;
+  /// surface frame in r1 and r2 body frame
+  sva::PTransformd X_b1_s, X_b2_s;
+  double halfLength, halfWidth, mu;
+  /**
+   * Contact wrench cone of the surface (16 x 6).
+   * The wrench w applied on r1 in the surface frame must verify cone w <= 0.
+   */
+  Eigen::MatrixXd cone;
+  sva::PTransformd X_b1_b2;
+  sva::PTransformd X_b1_cf;
+};
+
 } // namespace qp
 
 } // namespace tasks
+
+namespace std
+{
+
+template<>
+struct hash<tasks::qp::ContactId>
+{
+  std::size_t operator()(const tasks::qp::ContactId & cId) const
+  {
+    std::size_t seed = 0;
+    for(int v : {cId.r1Index, cId.r2Index, cId.r1BodyId(), cId.r2BodyId(), cId.ambiguityId})
+    {
+      seed ^= std::hash<int>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+
+} // namespace std
@@ -10,12 +10,15 @@
 
 // Eigen
 #include <Eigen/Core>
+#include <Eigen/QR>
+#include <Eigen/SVD>
 
 // RBDyn
 #include <RBDyn/FD.h>
 #include <RBDyn/Jacobian.h>
 
 // Tasks
+#include "QPContactJacobianPool.h"
 #include "QPSolver.h"
 
 namespace tasks
@@ -62,12 +65,49 @@ private:
   std::vector<ContactData> cont_; // only usefull for descBound
 };
 
+/**
+ * Constrain the wrench of each WrenchContact to lie in the contact wrench
+ * cone of its surface.
+ * The cones are constant in the surface frame, the matrix is only computed
+ * in updateNrVars.
+ */
+class TASKS_DLLAPI ContactWrenchConeConstr : public ConstraintFunction<Inequality>
+{
+public:
+  ContactWrenchConeConstr();
+
+  // Constraint
+  virtual void updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data) override;
+  virtual void update(const std::vector<rbd::MultiBody> & mbs,
+                      const std::vector<rbd::MultiBodyConfig> & mbc,
+                      const SolverData & data) override;
+
+  // Description
+  virtual std::string nameInEq() const override;
+  virtual std::string descInEq(const std::vector<rbd::MultiBody> & mbs, int line) override;
+
+  // Inequality Constraint
+  virtual int maxInEq() const override;
+
+  virtual const Eigen::MatrixXd & AInEq() const override;
+  virtual const Eigen::VectorXd & bInEq() const override;
+  /// AInEq only store the wrench contacts lambda columns.
+  virtual const ColumnSegments & columnsInEq() const override;
+
+private:
+  Eigen::MatrixXd A_;
+  Eigen::VectorXd b_;
+  ColumnSegments cols_;
+
+  std::vector<ContactId> cont_; // only usefull for descInEq
+};
+
 class TASKS_DLLAPI MotionConstrCommon : public ConstraintFunction<GenInequality>
 {
 public:
   MotionConstrCommon(const std::vector<rbd::MultiBody> & mbs, int robotIndex);
 
-  void computeTorque(const Eigen::VectorXd & alphaD, const Eigen::VectorXd & lambda);
+  virtual void computeTorque(const Eigen::VectorXd & alphaD, const Eigen::VectorXd & lambda);
   const Eigen::VectorXd & torque() const;
   void torque(const std::vector<rbd::MultiBody> & mbs, std::vector<rbd::MultiBodyConfig> & mbcs) const;
 
@@ -86,37 +126,52 @@ public:
   virtual const Eigen::MatrixXd & AGenInEq() const override;
   virtual const Eigen::VectorXd & LowerGenInEq() const override;
   virtual const Eigen::VectorXd & UpperGenInEq() const override;
+  /**
+   * AGenInEq only store the robot alphaD columns followed by the lambda
+   * columns of the contacts involving the robot.
+   */
+  virtual const ColumnSegments & columnsGenInEq() const override;
 
 protected:
   struct ContactData
   {
-    ContactData() {}
-    ContactData(const rbd::MultiBody & mb,
-                const std::string & bodyName,
+    ContactData() : jacIndex(-1) {}
+    /// Friction cone generators of each contact point.
+    ContactData(const rbd::Jacobian & jac,
+                int jacIndex,
                 int lambdaBegin,
-                std::vector<Eigen::Vector3d> points,
+                const std::vector<Eigen::Vector3d> & points,
                 const std::vector<FrictionCone> & cones);
+    /// Wrench applied in the X_b_s surface frame multiplied by sign.
+    ContactData(const rbd::Jacobian & jac,
+                int jacIndex,
+                int lambdaBegin,
+                const sva::PTransformd & X_b_s,
+                double sign);
 
     int bodyIndex;
-    int lambdaBegin;
-    rbd::Jacobian jac;
-    std::vector<Eigen::Vector3d> points;
+    int lambdaBegin; // lambda index in A_
+    int jacIndex; // jacobian index in jacPool_
+    // Wrench applied on the body origin by each lambda (6 x nrLambda).
     // BEWARE generator are minus to avoid one multiplication by -1 in the
     // update method
-    std::vector<Eigen::Matrix<double, 3, Eigen::Dynamic>> minusGenerators;
+    Eigen::MatrixXd minusGenerators;
   };
 
 protected:
-  int robotIndex_, alphaDBegin_, nrDof_, lambdaBegin_;
+  int robotIndex_, alphaDBegin_, nrDof_, lambdaBegin_, totalLambda_;
   rbd::ForwardDynamics fd_;
-  Eigen::MatrixXd fullJacLambda_, jacTrans_, jacLambda_;
+  Eigen::MatrixXd jacLambda_;
   std::vector<ContactData> cont_;
+  ContactJacobianPool jacPool_;
+  ColumnSegments cols_;
 
   Eigen::VectorXd curTorque_;
 
   Eigen::MatrixXd A_;
   Eigen::VectorXd AL_, AU_;
   size_t updateIter_ = 0;
+
 };
 
 class TASKS_DLLAPI MotionConstr : public MotionConstrCommon
@@ -134,7 +189,7 @@ public:
   virtual void update(const std::vector<rbd::MultiBody> & mbs,
                       const std::vector<rbd::MultiBodyConfig> & mbcs,
                       const SolverData & data) override;
-  // Matrix
+  // Matrix, only the columns given by columnsGenInEq (use contactMatrix for the full lambda block)
   const Eigen::MatrixXd matrix() const { return A_; }
   // Contact torque
   Eigen::MatrixXd contactMatrix() const;
@@ -209,6 +264,97 @@ protected:
   std::vector<int> jointIndex_;
 };
 
+/**
+ * Motion constraint projected in the null space of rigid bilateral contacts.
+ * The rigid contacts are not given to QPSolver::nrVars, so they don't add
+ * lambda variables to the problem. Each one fix the contact body to a robot
+ * without dof (the environment).
+ * With \f$ J_c^T = [Q_1 Q_2] R \f$ the equation of motion is split into:
+ * \f{align}
+ * \tau &= (Q_2^T S^T)^+ Q_2^T (H \ddot{\alpha} + C - J^T G \lambda) \\
+ * 0 &= U_2^T Q_2^T (H \ddot{\alpha} + C - J^T G \lambda) \\
+ * Q_1^T \ddot{\alpha} &= u \text{ with } J_c \ddot{\alpha} = -\dot{J}_c \alpha
+ * \f}
+ * where \f$ S \f$ select the actuated dofs (non zero torque bounds) and
+ * \f$ U_2 \f$ is a basis of the \f$ Q_2^T S^T \f$ left null space.
+ * The torque is the minimal norm torque, it's bounded by the torque bounds.
+ * The rigid contact wrenches are recovered by computeTorque.
+ */
+class TASKS_DLLAPI ProjectedMotionConstr : public MotionConstrCommon
+{
+public:
+  /**
+   * @param tb Torque bounds, the dofs with a null lower and upper torque bound
+   * are not actuated.
+   * @param rigidContacts Rigid contacts of the robot robotIndex, the points
+   * and the cones are not used, the contact frame is X_b1_cf.
+   * @throw std::domain_error If a contact does not involve robotIndex or if
+   * the other robot has some dof.
+   */
+  ProjectedMotionConstr(const std::vector<rbd::MultiBody> & mbs,
+                        int robotIndex,
+                        const TorqueBound & tb,
+                        const std::vector<BilateralContact> & rigidContacts);
+
+  /**
+   * Compute the torque and the rigid contacts wrench of the last solution.
+   * The torque is null for the dofs that are not actuated.
+   */
+  virtual void computeTorque(const Eigen::VectorXd & alphaD, const Eigen::VectorXd & lambda) override;
+  /**
+   * @return Wrench applied on the robot by the rigid contact i (computed by
+   * computeTorque) in the contact frame.
+   * When rigid contacts involve the same body the wrenches are the minimum
+   * norm ones.
+   */
+  sva::ForceVecd rigidContactWrench(int i) const;
+  int nrRigidContacts() const { return static_cast<int>(rigidCont_.size()); }
+
+  // Constraint
+  virtual void update(const std::vector<rbd::MultiBody> & mbs,
+                      const std::vector<rbd::MultiBodyConfig> & mbcs,
+                      const SolverData & data) override;
+
+  // Description
+  virtual std::string nameGenInEq() const override;
+  virtual std::string descGenInEq(const std::vector<rbd::MultiBody> & mbs, int line) override;
+
+  // Inequality Constraint
+  virtual int nrGenInEq() const override;
+  virtual int maxGenInEq() const override;
+
+  virtual const Eigen::MatrixXd & AGenInEq() const override;
+  virtual const Eigen::VectorXd & LowerGenInEq() const override;
+  virtual const Eigen::VectorXd & UpperGenInEq() const override;
+
+protected:
+  struct RigidContactData
+  {
+    RigidContactData(const rbd::MultiBody & mb, const std::string & bName, const sva::PTransformd & Xbcf)
+    : jac(mb, bName), X_b_cf(Xbcf)
+    {
+    }
+
+    rbd::Jacobian jac;
+    sva::PTransformd X_b_cf;
+  };
+
+protected:
+  std::vector<RigidContactData> rigidCont_;
+  Eigen::VectorXd torqueL_, torqueU_;
+  std::vector<int> actIndex_; //< actuated dofs
+
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> jcQR_;
+  Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> jcCOD_; //< only used when J_c is rank deficient
+  Eigen::JacobiSVD<Eigen::MatrixXd> actSVD_;
+  Eigen::MatrixXd fullJac_, jcT_, jcQ_, actB_, W_;
+  Eigen::VectorXd normalAcc_, rigidWrench_;
+
+  Eigen::MatrixXd PA_;
+  Eigen::VectorXd PL_, PU_;
+  int nrJcRank_, nrPRows_; //< rank of J_c, number of lines before the acceleration ones
+};
+
 } // namespace qp
 
 } // namespace tasks
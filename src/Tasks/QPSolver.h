@@ -7,6 +7,7 @@
 // includes
 // std
 #include <memory>
+#include <utility>
 #include <vector>
 
 // boost
@@ -72,6 +73,14 @@ public:
   void nrVars(const std::vector<rbd::MultiBody> & mbs,
               std::vector<UnilateralContact> uni,
               std::vector<BilateralContact> bi);
+  /**
+   * Same as above with surface contacts using one wrench variable by contact.
+   * Wrench contacts lambda follow the bilateral ones.
+   */
+  void nrVars(const std::vector<rbd::MultiBody> & mbs,
+              std::vector<UnilateralContact> uni,
+              std::vector<BilateralContact> bi,
+              std::vector<WrenchContact> wrench);
   int nrVars() const;
 
   /// call updateNrVars on all tasks
@@ -111,6 +120,40 @@ public:
   void solver(const std::string & name);
   std::string solver() const;
 
+  /**
+   * Eliminate the equality constraints before calling the QP solver
+   * (see GenQPSolver::nullSpaceReduction).
+   * The setting is kept when the QP solver is changed.
+   */
+  void nullSpaceReduction(bool enable);
+  bool nullSpaceReduction() const;
+
+  /**
+   * Solve independently the robots that share no contact, task or constraint
+   * (see GenQPSolver::decomposition).
+   * The setting is kept when the QP solver is changed.
+   */
+  void decomposition(bool enable);
+  bool decomposition() const;
+  /// @see GenQPSolver::nrSubProblems
+  int nrSubProblems() const;
+
+  /**
+   * Solve the robots by consensus ADMM (see GenQPSolver::consensus).
+   * The setting is kept when the QP solver is changed.
+   */
+  void consensus(bool enable);
+  bool consensus() const;
+  /// @see GenQPSolver::consensusParameters
+  void consensusParameters(double rho, double tolerance, int maxIter);
+  /**
+   * @see GenQPSolver::admmParameters
+   * The parameters are kept when the QP solver is changed.
+   */
+  void admmParameters(double absTol, double relTol, int maxIter);
+  /// @see GenQPSolver::nrIterations
+  int nrIterations() const;
+
   const SolverData & data() const;
   SolverData & data();
 
@@ -203,6 +246,69 @@ private:
   }
 };
 
+/**
+ * Problem variable columns stored in a constraint matrix.
+ * By default the set is full and the constraint matrix is nrVars wide.
+ * Once segments are added the constraint matrix only store the listed
+ * (begin, size) column segments, one after the other.
+ * A non full set without segment is a matrix without column.
+ */
+class ColumnSegments
+{
+public:
+  typedef std::pair<int, int> Segment;
+  typedef std::vector<Segment>::const_iterator const_iterator;
+
+  /// Build a full column set.
+  ColumnSegments() : full_(true), segments_() {}
+
+  /// @return true if the constraint matrix is nrVars wide.
+  bool full() const { return full_; }
+  /// Go back to a nrVars wide matrix.
+  void setFull()
+  {
+    full_ = true;
+    segments_.clear();
+  }
+
+  /// Remove all the segments, the matrix has no column until add is called.
+  void clear()
+  {
+    full_ = false;
+    segments_.clear();
+  }
+  /// Append the [begin, begin + size) segment.
+  void add(int begin, int size)
+  {
+    full_ = false;
+    segments_.emplace_back(begin, size);
+  }
+  /// Replace the segments by the [begin, begin + size) segment.
+  void set(int begin, int size)
+  {
+    clear();
+    add(begin, size);
+  }
+
+  /// @return Number of segments (0 if full).
+  std::size_t size() const { return segments_.size(); }
+  const Segment & operator[](std::size_t i) const { return segments_[i]; }
+  const_iterator begin() const { return segments_.begin(); }
+  const_iterator end() const { return segments_.end(); }
+  const std::vector<Segment> & segments() const { return segments_; }
+
+private:
+  bool full_;
+  std::vector<Segment> segments_;
+};
+
+/// Column set of a constraint that use a nrVars wide matrix.
+inline const ColumnSegments & allColumns()
+{
+  static const ColumnSegments all;
+  return all;
+}
+
 class TASKS_DLLAPI Equality
 {
 public:
@@ -210,8 +316,11 @@ public:
   virtual int maxEq() const = 0;
   virtual int nrEq() const { return maxEq(); }
 
+  /// Constraint matrix, only hold the columnsEq columns when they are not full.
   virtual const Eigen::MatrixXd & AEq() const = 0;
   virtual const Eigen::VectorXd & bEq() const = 0;
+  /// @see ColumnSegments
+  virtual const ColumnSegments & columnsEq() const { return allColumns(); }
 
   virtual std::string nameEq() const = 0;
   virtual std::string descEq(const std::vector<rbd::MultiBody> & mbs, int i) = 0;
@@ -228,8 +337,11 @@ public:
   virtual int maxInEq() const = 0;
   virtual int nrInEq() const { return maxInEq(); }
 
+  /// Constraint matrix, only hold the columnsInEq columns when they are not full.
   virtual const Eigen::MatrixXd & AInEq() const = 0;
   virtual const Eigen::VectorXd & bInEq() const = 0;
+  /// @see ColumnSegments
+  virtual const ColumnSegments & columnsInEq() const { return allColumns(); }
 
   virtual std::string nameInEq() const = 0;
   virtual std::string descInEq(const std::vector<rbd::MultiBody> & mbs, int i) = 0;
@@ -246,9 +358,12 @@ public:
   virtual int maxGenInEq() const = 0;
   virtual int nrGenInEq() const { return maxGenInEq(); }
 
+  /// Constraint matrix, only hold the columnsGenInEq columns when they are not full.
   virtual const Eigen::MatrixXd & AGenInEq() const = 0;
   virtual const Eigen::VectorXd & LowerGenInEq() const = 0;
   virtual const Eigen::VectorXd & UpperGenInEq() const = 0;
+  /// @see ColumnSegments
+  virtual const ColumnSegments & columnsGenInEq() const { return allColumns(); }
 
   virtual std::string nameGenInEq() const = 0;
   virtual std::string descGenInEq(const std::vector<rbd::MultiBody> & mbs, int i) = 0;
@@ -277,6 +392,16 @@ public:
 
 class TASKS_DLLAPI Task
 {
+public:
+  /// Sparsity structure of the Q matrix.
+  enum class QStructure
+  {
+    /// Q can be any matrix.
+    Dense,
+    /// Q is diagonal, only its diagonal is read by the solver.
+    Diagonal
+  };
+
 public:
   Task(double weight) : weight_(weight) {}
   virtual ~Task() {}
@@ -295,6 +420,20 @@ public:
   virtual const Eigen::MatrixXd & Q() const = 0;
   virtual const Eigen::VectorXd & C() const = 0;
 
+  /**
+   * Lines (and columns) of Q and C that can be non zero, relative to begin.
+   * Other lines and columns of Q and C must stay at zero.
+   * An empty list means that Q and C are dense.
+   */
+  virtual const std::vector<int> & nonZeroVars() const
+  {
+    static const std::vector<int> empty;
+    return empty;
+  }
+
+  /// @return Structure of Q, the solver only add the non zero part of Q.
+  virtual QStructure structure() const { return QStructure::Dense; }
+
 private:
   double weight_;
 };
@@ -302,6 +441,7 @@ private:
 class TASKS_DLLAPI HighLevelTask
 {
 public:
+  HighLevelTask() : lastEpoch_(0), lastTick_(0) {}
   virtual ~HighLevelTask() {}
 
   virtual int dim() = 0;
@@ -310,10 +450,50 @@ public:
                       const std::vector<rbd::MultiBodyConfig> & mbcs,
                       const SolverData & data) = 0;
 
+  /**
+   * Call update only once by solver update.
+   * A high level task shared by several tasks is then only computed once
+   * in a QPSolver::solve call.
+   * update is always called if data has not been updated by a solver
+   * (SolverData::tick is 0).
+   * The solver is identified by SolverData::epoch so a solver created at the
+   * address of a destroyed one is never mistaken for it.
+   */
+  void updateOnce(const std::vector<rbd::MultiBody> & mbs,
+                  const std::vector<rbd::MultiBodyConfig> & mbcs,
+                  const SolverData & data)
+  {
+    if(data.tick() == 0 || lastEpoch_ != data.epoch() || lastTick_ != data.tick())
+    {
+      update(mbs, mbcs, data);
+      lastEpoch_ = data.epoch();
+      lastTick_ = data.tick();
+    }
+  }
+
   virtual const Eigen::MatrixXd & jac() const = 0;
   virtual const Eigen::VectorXd & eval() const = 0;
   virtual const Eigen::VectorXd & speed() const = 0;
   virtual const Eigen::VectorXd & normalAcc() const = 0;
+
+  /**
+   * Jacobian restricted to the robot dof given by jacDofs.
+   * Only meaningful if jacDofs is not empty.
+   */
+  virtual const Eigen::MatrixXd & compactJac() const { return jac(); }
+  /**
+   * Robot dof index of each compactJac column, all the other jac columns
+   * are zero. An empty list means that only jac is available.
+   */
+  virtual const std::vector<int> & jacDofs() const
+  {
+    static const std::vector<int> empty;
+    return empty;
+  }
+
+private:
+  unsigned long long lastEpoch_;
+  unsigned long long lastTick_;
 };
 
 template<typename T>
@@ -328,6 +508,8 @@ struct constr_traits<Equality>
 
   static int nrLines(const Equality * constr) { return constr->nrEq(); }
 
+  static const ColumnSegments & columns(const Equality * constr) { return constr->columnsEq(); }
+
   static std::string name(const Equality * constr) { return constr->nameEq(); }
 
   static std::string desc(Equality * constr, const std::vector<rbd::MultiBody> & mbs, int i)
@@ -343,6 +525,8 @@ struct constr_traits<Inequality>
 
   static int nrLines(const Inequality * constr) { return constr->nrInEq(); }
 
+  static const ColumnSegments & columns(const Inequality * constr) { return constr->columnsInEq(); }
+
   static std::string name(const Inequality * constr) { return constr->nameInEq(); }
 
   static std::string desc(Inequality * constr, const std::vector<rbd::MultiBody> & mbs, int i)
@@ -358,6 +542,8 @@ struct constr_traits<GenInequality>
 
   static int nrLines(const GenInequality * constr) { return constr->nrGenInEq(); }
 
+  static const ColumnSegments & columns(const GenInequality * constr) { return constr->columnsGenInEq(); }
+
   static std::string name(const GenInequality * constr) { return constr->nameGenInEq(); }
 
   static std::string desc(GenInequality * constr, const std::vector<rbd::MultiBody> & mbs, int i)
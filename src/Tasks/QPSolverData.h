@@ -5,11 +5,15 @@
 #pragma once
 
 // includes
+// std
+#include <unordered_map>
+
 // SpaceVecAlg
 #include <SpaceVecAlg/SpaceVecAlg>
 
 // Tasks
 #include "QPContacts.h"
+#include "Tasks.h"
 
 // forward declaration
 namespace rbd
@@ -57,36 +61,147 @@ public:
 
   int bilateralBegin() const { return unilateralBegin() + nrUniLambda_; }
 
-  int nrContacts() const { return static_cast<int>(uniCont_.size() + biCont_.size()); }
+  int nrWrenchLambda() const { return nrWrenchLambda_; }
+
+  int wrenchBegin() const { return bilateralBegin() + nrBiLambda_; }
+
+  /// Number of contacts, wrench contacts index follow allContacts ones.
+  int nrContacts() const { return static_cast<int>(uniCont_.size() + biCont_.size() + wrenchCont_.size()); }
 
   const std::vector<UnilateralContact> & unilateralContacts() const { return uniCont_; }
 
   const std::vector<BilateralContact> & bilateralContacts() const { return biCont_; }
 
+  /// Unilateral and bilateral contacts.
   const std::vector<BilateralContact> & allContacts() const { return allCont_; }
 
+  const std::vector<WrenchContact> & wrenchContacts() const { return wrenchCont_; }
+
+  /**
+   * @return Index of the contact cId (as used by lambda and lambdaBegin)
+   * or -1 if cId is not a contact of the solver.
+   */
+  int contactIndex(const ContactId & cId) const
+  {
+    auto it = contactIndex_.find(cId);
+    return it != contactIndex_.end() ? it->second : -1;
+  }
+
+  /**
+   * Single pass over the joints of each mobile robot that compute the body
+   * normal accelerations (normalAccB) and the world frame motion subspace
+   * of each joint (motionSubspaceW).
+   * The robot state vectors (qVec, alphaVec, alphaDVec) are also filled.
+   * Forward kinematics and velocity must have been computed on mbcs.
+   */
+  void computeKinematics(const std::vector<rbd::MultiBody> & mbs, const std::vector<rbd::MultiBodyConfig> & mbcs);
+
+  /// Same as computeKinematics.
   void computeNormalAccB(const std::vector<rbd::MultiBody> & mbs, const std::vector<rbd::MultiBodyConfig> & mbcs);
 
   const std::vector<std::vector<sva::MotionVecd>> & normalAccB() const { return normalAccB_; }
 
   const std::vector<sva::MotionVecd> & normalAccB(int robotIndex) const { return normalAccB_[robotIndex]; }
 
+  /// Joint parameters of a robot flattened with rbd::paramToVector (nrParams).
+  const Eigen::VectorXd & qVec(int robotIndex) const { return qVec_[robotIndex]; }
+  /// Joint velocities of a robot flattened with rbd::paramToVector (nrDof).
+  const Eigen::VectorXd & alphaVec(int robotIndex) const { return alphaVec_[robotIndex]; }
+  /**
+   * Joint accelerations of a robot flattened with rbd::paramToVector (nrDof).
+   * At update time this is the acceleration computed by the previous solve.
+   */
+  const Eigen::VectorXd & alphaDVec(int robotIndex) const { return alphaDVec_[robotIndex]; }
+
+  /**
+   * Motion subspace of all the joints of a robot expressed in the world
+   * frame at the world origin (6 x nrDof).
+   * Joint j columns start at mb.jointPosInDof(j).
+   * Body jacobians can be sliced from it with tasks::jacobianFromSweep.
+   */
+  const Eigen::MatrixXd & motionSubspaceW(int robotIndex) const { return motionSubspaceW_[robotIndex]; }
+
+  /**
+   * CoM position, velocity, normal acceleration and jacobian of a robot.
+   * They are computed from the kinematics sweep on the first call following
+   * computeKinematics and then shared by all the tasks and constraints.
+   * Only the CoM fields of the result are up to date.
+   */
+  const CentroidalData & centroidalCoM(const std::vector<rbd::MultiBody> & mbs,
+                                       const std::vector<rbd::MultiBodyConfig> & mbcs,
+                                       int robotIndex) const;
+
+  /**
+   * Same as centroidalCoM but the centroidal momentum, the centroidal momentum
+   * matrix and its bias term are also computed.
+   */
+  const CentroidalData & centroidalMomentum(const std::vector<rbd::MultiBody> & mbs,
+                                            const std::vector<rbd::MultiBodyConfig> & mbcs,
+                                            int robotIndex) const;
+
+  /**
+   * Number of QP updates done by the solver, incremented before updating
+   * the constraints and tasks.
+   * 0 means that no update has been done yet.
+   */
+  unsigned long long tick() const { return tick_; }
+
+  /**
+   * Identifier unique to this SolverData instance (a copy get a new one),
+   * it's never 0. Unlike the address it's never reused by another instance.
+   */
+  unsigned long long epoch() const { return epoch_.value; }
+
+private:
+  /// Take a new value from a global counter at construction and copy.
+  struct Epoch
+  {
+    Epoch();
+    Epoch(const Epoch &);
+    Epoch & operator=(const Epoch &) { return *this; }
+
+    unsigned long long value;
+  };
+
+private:
+  void computeCentroidal(const rbd::MultiBody & mb,
+                         const rbd::MultiBodyConfig & mbc,
+                         int robotIndex,
+                         bool momentum) const;
+
 private:
   std::vector<int> alphaD_; //< each robot alphaD vector size
   std::vector<int> alphaDBegin_; //< each robot alphaD vector begin in x
   std::vector<int> lambda_; //< each contact lambda
   std::vector<int> lambdaBegin_; //< each contact lambda vector begin in x
   int totalAlphaD_, totalLambda_;
-  int nrUniLambda_, nrBiLambda_;
+  int nrUniLambda_, nrBiLambda_, nrWrenchLambda_;
   int nrVars_; //< total number of var
 
   std::vector<UnilateralContact> uniCont_;
   std::vector<BilateralContact> biCont_;
   std::vector<BilateralContact> allCont_;
+  std::vector<WrenchContact> wrenchCont_;
+  std::unordered_map<ContactId, int> contactIndex_; //< each contact index
 
   std::vector<int> mobileRobotIndex_; //< robot index with dof > 0
   /// normal acceleration of each body of each robot
   std::vector<std::vector<sva::MotionVecd>> normalAccB_;
+  /// flattened q, alpha and alphaD of each robot
+  std::vector<Eigen::VectorXd> qVec_, alphaVec_, alphaDVec_;
+  /// world frame motion subspace of each joint of each robot
+  std::vector<Eigen::MatrixXd> motionSubspaceW_;
+  /// incremented by computeKinematics, invalidate the centroidal cache
+  unsigned long long kinematicsStamp_;
+
+  /// centroidal quantities of each robot computed on demand
+  mutable std::vector<CentroidalData> centroidal_;
+  mutable std::vector<unsigned long long> comStamp_, momentumStamp_;
+  /// world frame inertia of each body subtree
+  mutable std::vector<sva::RBInertiad> subtreeInertia_;
+
+  unsigned long long tick_;
+  Epoch epoch_;
 };
 
 } // namespace qp
@@ -14,6 +14,7 @@
 // Tasks
 #include "QPMotionConstr.h"
 #include "QPSolver.h"
+#include "QPTrajectory.h"
 #include "Tasks.h"
 
 // forward declaration
@@ -50,23 +51,42 @@ public:
 
   virtual const Eigen::MatrixXd & Q() const override;
   virtual const Eigen::VectorXd & C() const override;
+  virtual const std::vector<int> & nonZeroVars() const override;
 
 protected:
+  /**
+   * Compute Q and C from the high level task.
+   * If the high level task provide a compact jacobian only the
+   * jacDofs x jacDofs block of Q is computed.
+   */
   void computeQC(Eigen::VectorXd & error);
 
 protected:
   HighLevelTask * hlTask_;
   Eigen::VectorXd error_;
 
+private:
+  /**
+   * computeQC specialized on the task dimension, Eigen can then unroll
+   * the dimWeight scaling and the Dim x n products.
+   * computeQC dispatch the 2, 3 and 6 dimensions tasks to it,
+   * Dim must be Eigen::Dynamic for the others.
+   */
+  template<int Dim>
+  void computeQCDim(Eigen::VectorXd & error);
+
 private:
   Eigen::VectorXd dimWeight_;
   int robotIndex_, alphaDBegin_;
 
   Eigen::MatrixXd Q_;
   Eigen::VectorXd C_;
+  std::vector<int> jacDofs_; ///< non zero lines and columns of Q_ (empty if dense)
   // cache
   Eigen::MatrixXd preQ_;
   Eigen::VectorXd preC_;
+  Eigen::MatrixXd compactQ_;
+  Eigen::VectorXd compactC_;
 };
 
 class TASKS_DLLAPI SetPointTask : public SetPointTaskCommon
@@ -162,6 +182,18 @@ public:
   void refAccel(const Eigen::VectorXd & refAccel);
   const Eigen::VectorXd & refAccel() const;
 
+  /**
+   * Sample refVel and refAccel from a preloaded trajectory at each update
+   * instead of setting them every tick.
+   * @param traj Trajectory of dimension hlTask->dim(), nullptr clear the trajectory.
+   * @param timeStep Time elapsed between two solver updates.
+   * @throw std::domain_error If the trajectory dimension mismatch.
+   */
+  void trajectory(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep);
+  /// Stop sampling the trajectory, refVel and refAccel keep their last value.
+  void clearTrajectory();
+  const TrajectoryPlayer & trajectoryPlayer() const { return trajPlayer_; }
+
   void update(const std::vector<rbd::MultiBody> & mbs,
               const std::vector<rbd::MultiBodyConfig> & mbcs,
               const SolverData & data) override;
@@ -169,6 +201,7 @@ public:
 private:
   Eigen::VectorXd stiffness_, damping_;
   Eigen::VectorXd refVel_, refAccel_;
+  TrajectoryPlayer trajPlayer_;
 };
 
 /// @deprecated Must be replace by TrackingTask
@@ -212,6 +245,93 @@ private:
   Eigen::VectorXd error_, errorD_, errorI_;
 };
 
+/**
+ * Fuse several high level tasks of the same robot in one task.
+ * Each high level task i follow the TrajectoryTask error
+ * \f[ e_i = K_i \epsilon_i + D_i (\dot{\epsilon}^{\text{ref}}_i - \dot{\epsilon}_i)
+ *     + \ddot{\epsilon}^{\text{ref}}_i - \dot{J}_i \dot{q} \f]
+ * All Jacobians and errors are stacked to compute
+ * \f$ Q = J^T W J \f$ and \f$ C = -J^T W e \f$ with only one matrix product
+ * instead of one by high level task.
+ * \f$ W \f$ is the diagonal matrix of the weight times the dimWeight of
+ * each high level task.
+ */
+class TASKS_DLLAPI StackedTask : public Task
+{
+public:
+  /**
+   * @param mbs Multi-robot system.
+   * @param robotIndex Robot index in mbs, all stacked tasks must be applied on it.
+   * @param weight Weight applied to all stacked tasks.
+   */
+  StackedTask(const std::vector<rbd::MultiBody> & mbs, int robotIndex, double weight);
+
+  /**
+   * Add a high level task with a set point behavior
+   * (critically damped, null reference velocity and acceleration).
+   */
+  void addTask(HighLevelTask * hlTask, double stiffness, double weight);
+  /**
+   * Add a high level task.
+   * @param hlTask High level task to stack, must not be already stacked.
+   * @param stiffness \f$ K_i \f$.
+   * @param damping \f$ D_i \f$.
+   * @param dimWeight Weight of each hlTask dimension.
+   * @param weight hlTask weight.
+   */
+  void addTask(HighLevelTask * hlTask,
+               double stiffness,
+               double damping,
+               const Eigen::VectorXd & dimWeight,
+               double weight);
+  /// @return false if hlTask was not stacked.
+  bool removeTask(HighLevelTask * hlTask);
+  void resetTasks();
+  std::size_t nrTasks() const { return tasks_.size(); }
+
+  /// @throw std::runtime_error If hlTask is not stacked.
+  void gains(HighLevelTask * hlTask, double stiffness, double damping);
+  /// @throw std::runtime_error If hlTask is not stacked.
+  void taskWeight(HighLevelTask * hlTask, double weight);
+  /// @throw std::runtime_error If hlTask is not stacked.
+  void refVel(HighLevelTask * hlTask, const Eigen::VectorXd & refVel);
+  /// @throw std::runtime_error If hlTask is not stacked.
+  void refAccel(HighLevelTask * hlTask, const Eigen::VectorXd & refAccel);
+
+  virtual std::pair<int, int> begin() const override { return std::make_pair(alphaDBegin_, alphaDBegin_); }
+
+  virtual void updateNrVars(const std::vector<rbd::MultiBody> & mbs, const SolverData & data) override;
+  virtual void update(const std::vector<rbd::MultiBody> & mbs,
+                      const std::vector<rbd::MultiBodyConfig> & mbcs,
+                      const SolverData & data) override;
+
+  virtual const Eigen::MatrixXd & Q() const override;
+  virtual const Eigen::VectorXd & C() const override;
+
+private:
+  struct StackedData
+  {
+    HighLevelTask * hlTask;
+    double stiffness, damping, weight;
+    Eigen::VectorXd dimWeight;
+    Eigen::VectorXd refVel, refAccel;
+  };
+
+private:
+  StackedData & stackedData(HighLevelTask * hlTask);
+  void updateNrRows();
+
+private:
+  std::vector<StackedData> tasks_;
+  int robotIndex_, alphaDBegin_, nrDof_;
+
+  Eigen::MatrixXd Q_;
+  Eigen::VectorXd C_;
+  // cache
+  Eigen::MatrixXd jac_, preQ_;
+  Eigen::VectorXd error_, rowWeight_;
+};
+
 class TASKS_DLLAPI TargetObjectiveTask : public Task
 {
 public:
@@ -445,6 +565,8 @@ public:
 
   virtual const Eigen::MatrixXd & Q() const override;
   virtual const Eigen::VectorXd & C() const override;
+  /// Q is the diagonal dimWeight matrix (zero on the free flyer).
+  virtual QStructure structure() const override { return QStructure::Diagonal; }
 
   const Eigen::VectorXd & eval() const;
 
@@ -457,6 +579,18 @@ public:
   }
   inline const Eigen::VectorXd & refAccel() const noexcept { return refAccel_; }
 
+  /**
+   * Sample refVel and refAccel from a preloaded trajectory at each update
+   * instead of setting them every tick.
+   * @param traj Trajectory of dimension mb.nrDof(), nullptr clear the trajectory.
+   * @param timeStep Time elapsed between two solver updates.
+   * @throw std::domain_error If the trajectory dimension mismatch.
+   */
+  void trajectory(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep);
+  /// Stop sampling the trajectory, refVel and refAccel keep their last value.
+  void clearTrajectory();
+  const TrajectoryPlayer & trajectoryPlayer() const { return trajPlayer_; }
+
   inline const Eigen::VectorXd & dimWeight() const noexcept { return dimWeight_; }
 
   inline void dimWeight(const Eigen::VectorXd & dimW) noexcept
@@ -483,9 +617,9 @@ private:
 
   Eigen::MatrixXd Q_;
   Eigen::VectorXd C_;
-  Eigen::VectorXd alphaVec_;
   Eigen::VectorXd refVel_, refAccel_;
   Eigen::VectorXd dimWeight_;
+  TrajectoryPlayer trajPlayer_;
 };
 
 class TASKS_DLLAPI PositionTask : public HighLevelTask
@@ -517,6 +651,9 @@ public:
   virtual const Eigen::VectorXd & speed() const override;
   virtual const Eigen::VectorXd & normalAcc() const override;
 
+  virtual const Eigen::MatrixXd & compactJac() const override;
+  virtual const std::vector<int> & jacDofs() const override;
+
 private:
   tasks::PositionTask pt_;
   int robotIndex_;
@@ -552,6 +689,9 @@ public:
   virtual const Eigen::VectorXd & speed() const override;
   virtual const Eigen::VectorXd & normalAcc() const override;
 
+  virtual const Eigen::MatrixXd & compactJac() const override;
+  virtual const std::vector<int> & jacDofs() const override;
+
 private:
   tasks::OrientationTask ot_;
   int robotIndex_;
@@ -590,6 +730,10 @@ public:
 
   virtual const Eigen::VectorXd & normalAcc() const override { return tt_.normalAcc(); }
 
+  virtual const Eigen::MatrixXd & compactJac() const override { return tt_.compactJac(); }
+
+  virtual const std::vector<int> & jacDofs() const override { return tt_.jacDofs(); }
+
 protected:
   transform_task_t tt_;
   int robotIndex_;
@@ -710,6 +854,67 @@ private:
   int robotIndex_;
 };
 
+/**
+ * @see tasks::MultiGazeTask
+ * The number of points must be set before creating the task using it
+ * since it define dim.
+ */
+class TASKS_DLLAPI MultiGazeTask : public HighLevelTask
+{
+public:
+  MultiGazeTask(const std::vector<rbd::MultiBody> & mbs,
+                int robotIndex,
+                const std::string & bodyName,
+                const Eigen::Matrix2Xd & points2d,
+                const Eigen::VectorXd & depthEstimates,
+                const sva::PTransformd & X_b_gaze,
+                const Eigen::Matrix2Xd & points2d_ref = Eigen::Matrix2Xd());
+  MultiGazeTask(const std::vector<rbd::MultiBody> & mbs,
+                int robotIndex,
+                const std::string & bodyName,
+                const Eigen::Matrix3Xd & points3d,
+                const sva::PTransformd & X_b_gaze,
+                const Eigen::Matrix2Xd & points2d_ref = Eigen::Matrix2Xd());
+
+  tasks::MultiGazeTask & task() { return gazet_; }
+
+  int nrPoints() const { return gazet_.nrPoints(); }
+
+  void error(int index,
+             const Eigen::Vector2d & point2d,
+             double depthEstimate,
+             const Eigen::Vector2d & point2d_ref = Eigen::Vector2d::Zero())
+  {
+    gazet_.error(index, point2d, depthEstimate, point2d_ref);
+  }
+
+  void error(int index, const Eigen::Vector3d & point3d, const Eigen::Vector2d & point2d_ref = Eigen::Vector2d::Zero())
+  {
+    gazet_.error(index, point3d, point2d_ref);
+  }
+
+  void error(const Eigen::Matrix2Xd & points2d,
+             const Eigen::VectorXd & depthEstimates,
+             const Eigen::Matrix2Xd & points2d_ref)
+  {
+    gazet_.error(points2d, depthEstimates, points2d_ref);
+  }
+
+  virtual int dim() override;
+  virtual void update(const std::vector<rbd::MultiBody> & mbs,
+                      const std::vector<rbd::MultiBodyConfig> & mbcs,
+                      const SolverData & data) override;
+
+  virtual const Eigen::MatrixXd & jac() const override;
+  virtual const Eigen::VectorXd & eval() const override;
+  virtual const Eigen::VectorXd & speed() const override;
+  virtual const Eigen::VectorXd & normalAcc() const override;
+
+private:
+  tasks::MultiGazeTask gazet_;
+  int robotIndex_;
+};
+
 class TASKS_DLLAPI PositionBasedVisServoTask : public HighLevelTask
 {
 public:
@@ -812,6 +1017,8 @@ public:
 private:
   tasks::CoMTask ct_;
   int robotIndex_;
+  /// per body weighted CoM can't use the SolverData centroidal cache
+  bool weighted_;
 };
 
 class TASKS_DLLAPI MultiCoMTask : public Task
@@ -872,6 +1079,7 @@ private:
   Eigen::Vector3d CSum_;
   // cache
   Eigen::MatrixXd preQ_;
+  std::vector<const CentroidalData *> centroidal_;
 };
 
 class TASKS_DLLAPI MultiRobotTransformTask : public Task
@@ -1089,7 +1297,6 @@ public:
 private:
   int robotIndex_;
   tasks::OrientationTrackingTask ott_;
-  Eigen::VectorXd alphaVec_;
   Eigen::VectorXd speed_, normalAcc_;
 };
 
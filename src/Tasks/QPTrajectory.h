@@ -0,0 +1,102 @@
+/*
+ * Copyright 2012-2019 CNRS-UM LIRMM, CNRS-AIST JRL
+ */
+
+#pragma once
+
+// includes
+// std
+#include <memory>
+
+// Eigen
+#include <Eigen/Core>
+
+#include <tasks/config.hh>
+
+namespace tasks
+{
+
+namespace qp
+{
+
+/**
+ * Reference velocity and acceleration trajectory sampled at a constant period.
+ * Samples are stored column by column in contiguous matrices.
+ * Between two samples the velocity is the cubic Hermite polynomial matching
+ * the sampled velocities and accelerations, the acceleration is its derivative.
+ */
+class TASKS_DLLAPI TrajectoryBuffer
+{
+public:
+  TrajectoryBuffer();
+  /**
+   * @param period Time between two samples.
+   * @param vel Reference velocity samples, one column by sample.
+   * @param accel Reference acceleration samples, one column by sample.
+   * @throw std::domain_error If period is not strictly positive, if there is
+   * no sample or if vel and accel size mismatch.
+   */
+  TrajectoryBuffer(double period, Eigen::MatrixXd vel, Eigen::MatrixXd accel);
+
+  /// @return Dimension of a sample.
+  int dim() const { return static_cast<int>(vel_.rows()); }
+  int nrSamples() const { return static_cast<int>(vel_.cols()); }
+  double period() const { return period_; }
+  /// @return Time of the last sample.
+  double duration() const { return period_ * (nrSamples() - 1); }
+
+  const Eigen::MatrixXd & vel() const { return vel_; }
+  const Eigen::MatrixXd & accel() const { return accel_; }
+
+  /**
+   * Evaluate the trajectory.
+   * The first sample is held before 0 and the last sample after duration().
+   * @param t Trajectory time.
+   * @param vel Reference velocity at t, must be of size dim().
+   * @param accel Reference acceleration at t, must be of size dim().
+   */
+  void eval(double t, Eigen::Ref<Eigen::VectorXd> vel, Eigen::Ref<Eigen::VectorXd> accel) const;
+
+private:
+  double period_;
+  Eigen::MatrixXd vel_, accel_;
+};
+
+/**
+ * Play a TrajectoryBuffer from the solver tick.
+ * The trajectory time start at 0 on the first sample call following load
+ * and is advanced by timeStep at each solver update.
+ */
+class TASKS_DLLAPI TrajectoryPlayer
+{
+public:
+  TrajectoryPlayer();
+
+  /**
+   * @param traj Trajectory to play, can be shared between several tasks.
+   * @param timeStep Time elapsed between two solver updates.
+   */
+  void load(std::shared_ptr<const TrajectoryBuffer> traj, double timeStep);
+  void clear();
+
+  bool loaded() const { return traj_ != nullptr; }
+  const std::shared_ptr<const TrajectoryBuffer> & trajectory() const { return traj_; }
+  /// @return Trajectory time of the last sample call.
+  double time() const { return time_; }
+
+  /**
+   * Evaluate the trajectory at the time of the solver tick.
+   * @param tick Solver tick (see SolverData::tick).
+   */
+  void sample(unsigned long long tick, Eigen::Ref<Eigen::VectorXd> vel, Eigen::Ref<Eigen::VectorXd> accel);
+
+private:
+  std::shared_ptr<const TrajectoryBuffer> traj_;
+  double timeStep_, time_;
+  bool started_;
+  unsigned long long startTick_;
+};
+
+} // namespace qp
+
+} // namespace tasks
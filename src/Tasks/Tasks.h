@@ -29,6 +29,45 @@ struct MultiBodyConfig;
 namespace tasks
 {
 
+/**
+ * Compute a body jacobian from the world frame motion subspace of all the
+ * robot joints (see qp::SolverData::motionSubspaceW).
+ * The result is the same than jac.jacobian(mb, mbc, X_0_p) but the
+ * kinematic path is not walked again and no transform is composed by joint.
+ * @param mb Robot.
+ * @param jac Body jacobian, only used for its joints path.
+ * @param motionSubspaceW World frame motion subspace of the robot joints
+ * (6 x mb.nrDof()).
+ * @param X_0_p Frame in which the jacobian is expressed.
+ * @param res Result (nrRows x jac.dof()).
+ * @param row First row of the 6D jacobian to compute.
+ * @param nrRows Number of rows of the 6D jacobian to compute.
+ */
+TASKS_DLLAPI void jacobianFromSweep(const rbd::MultiBody & mb,
+                                   const rbd::Jacobian & jac,
+                                   const Eigen::MatrixXd & motionSubspaceW,
+                                   const sva::PTransformd & X_0_p,
+                                   Eigen::Ref<Eigen::MatrixXd> res,
+                                   int row = 0,
+                                   int nrRows = 6);
+
+/**
+ * Centroidal quantities of a robot.
+ * See qp::SolverData::centroidalCoM and qp::SolverData::centroidalMomentum.
+ */
+struct TASKS_DLLAPI CentroidalData
+{
+  CentroidalData();
+
+  Eigen::Vector3d com; ///< CoM position in world frame
+  Eigen::Vector3d comVelocity;
+  Eigen::Vector3d comNormalAcc; ///< \f$ \dot{J}_{com} \alpha \f$
+  Eigen::MatrixXd comJac; ///< CoM jacobian (3 x nrDof)
+  sva::ForceVecd momentum; ///< Centroidal momentum expressed at the CoM
+  sva::ForceVecd normalMomentumDot; ///< \f$ \dot{A} \alpha \f$
+  Eigen::MatrixXd momentumMatrix; ///< Centroidal momentum matrix \f$ A \f$ (6 x nrDof)
+};
+
 class TASKS_DLLAPI PositionTask
 {
 public:
@@ -47,6 +86,11 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// Same as above but the jacobian is computed with jacobianFromSweep.
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB,
+              const Eigen::MatrixXd & motionSubspaceW);
   void updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc);
 
   const Eigen::VectorXd & eval() const;
@@ -55,6 +99,10 @@ public:
 
   const Eigen::MatrixXd & jac() const;
   const Eigen::MatrixXd & jacDot() const;
+  /// Jacobian restricted to the dof of the body kinematic path.
+  const Eigen::MatrixXd & compactJac() const;
+  /// Dof index of each compactJac column, empty if compactJac is not available.
+  const std::vector<int> & jacDofs() const;
 
 private:
   Eigen::Vector3d pos_;
@@ -65,8 +113,12 @@ private:
   Eigen::VectorXd eval_;
   Eigen::VectorXd speed_;
   Eigen::VectorXd normalAcc_;
+  Eigen::MatrixXd shortJacMat_;
   Eigen::MatrixXd jacMat_;
   Eigen::MatrixXd jacDotMat_;
+  std::vector<int> jacDofs_;
+  /// body normal acceleration along the jacobian path
+  std::vector<sva::MotionVecd> pathNormalAccB_;
 };
 
 class TASKS_DLLAPI OrientationTask
@@ -83,6 +135,11 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// @see PositionTask::update
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB,
+              const Eigen::MatrixXd & motionSubspaceW);
   void updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc);
 
   const Eigen::VectorXd & eval() const;
@@ -91,6 +148,10 @@ public:
 
   const Eigen::MatrixXd & jac() const;
   const Eigen::MatrixXd & jacDot() const;
+  /// @see PositionTask::compactJac
+  const Eigen::MatrixXd & compactJac() const;
+  /// @see PositionTask::jacDofs
+  const std::vector<int> & jacDofs() const;
 
 private:
   Eigen::Matrix3d ori_;
@@ -100,8 +161,12 @@ private:
   Eigen::VectorXd eval_;
   Eigen::VectorXd speed_;
   Eigen::VectorXd normalAcc_;
+  Eigen::MatrixXd shortJacMat_;
   Eigen::MatrixXd jacMat_;
   Eigen::MatrixXd jacDotMat_;
+  std::vector<int> jacDofs_;
+  /// body normal acceleration along the jacobian path
+  std::vector<sva::MotionVecd> pathNormalAccB_;
 };
 
 class TASKS_DLLAPI TransformTaskCommon
@@ -123,6 +188,10 @@ public:
   const Eigen::VectorXd & normalAcc() const;
 
   const Eigen::MatrixXd & jac() const;
+  /// @see PositionTask::compactJac
+  const Eigen::MatrixXd & compactJac() const;
+  /// @see PositionTask::jacDofs
+  const std::vector<int> & jacDofs() const;
 
 protected:
   sva::PTransformd X_0_t_;
@@ -133,7 +202,9 @@ protected:
   Eigen::VectorXd eval_;
   Eigen::VectorXd speed_;
   Eigen::VectorXd normalAcc_;
+  Eigen::MatrixXd shortJacMat_;
   Eigen::MatrixXd jacMat_;
+  std::vector<int> jacDofs_;
 };
 
 class TASKS_DLLAPI SurfaceTransformTask : public TransformTaskCommon
@@ -150,9 +221,18 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// @see PositionTask::update
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB,
+              const Eigen::MatrixXd & motionSubspaceW);
 
-protected:
-  Eigen::MatrixXd jacMatTmp_;
+private:
+  /// Jacobian is computed with jacobianFromSweep if motionSubspaceW is not null.
+  void updateTask(const rbd::MultiBody & mb,
+                  const rbd::MultiBodyConfig & mbc,
+                  const std::vector<sva::MotionVecd> & normalAccB,
+                  const Eigen::MatrixXd * motionSubspaceW);
 };
 
 class TASKS_DLLAPI TransformTask : public TransformTaskCommon
@@ -176,6 +256,18 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// @see PositionTask::update
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB,
+              const Eigen::MatrixXd & motionSubspaceW);
+
+private:
+  /// @see SurfaceTransformTask::updateTask
+  void updateTask(const rbd::MultiBody & mb,
+                  const rbd::MultiBodyConfig & mbc,
+                  const std::vector<sva::MotionVecd> & normalAccB,
+                  const Eigen::MatrixXd * motionSubspaceW);
 
 private:
   Eigen::Matrix3d E_0_c_;
@@ -244,6 +336,11 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// @see PositionTask::update
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB,
+              const Eigen::MatrixXd & motionSubspaceW);
   void updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc);
 
   const Eigen::VectorXd & eval() const;
@@ -262,8 +359,12 @@ private:
   Eigen::VectorXd eval_;
   Eigen::VectorXd speed_;
   Eigen::VectorXd normalAcc_;
+  Eigen::MatrixXd shortJacMat_;
   Eigen::MatrixXd jacMat_;
   Eigen::MatrixXd jacDotMat_;
+  std::vector<int> jacDofs_;
+  /// body normal acceleration along the jacobian path
+  std::vector<sva::MotionVecd> pathNormalAccB_;
 };
 
 class TASKS_DLLAPI GazeTask
@@ -322,6 +423,82 @@ private:
   Eigen::MatrixXd jacDotMat_;
 };
 
+/**
+ * Gaze task on several image points seen by the same camera.
+ * The camera body jacobian, velocity and normal acceleration are computed
+ * once and the interaction matrix of each point is stacked, point i
+ * use the rows 2i and 2i+1 of eval, speed, normalAcc and jac.
+ */
+class TASKS_DLLAPI MultiGazeTask
+{
+public:
+  /**
+   * @param mb Robot.
+   * @param bodyName Camera body.
+   * @param points2d Normalized image points (one by column).
+   * @param depthEstimates Depth estimate of each point.
+   * @param X_b_gaze Camera frame in body frame.
+   * @param points2d_ref Reference of each point, zero if empty.
+   * @throw std::domain_error If the arguments size doesn't match.
+   */
+  MultiGazeTask(const rbd::MultiBody & mb,
+                const std::string & bodyName,
+                const Eigen::Matrix2Xd & points2d,
+                const Eigen::VectorXd & depthEstimates,
+                const sva::PTransformd & X_b_gaze,
+                const Eigen::Matrix2Xd & points2d_ref = Eigen::Matrix2Xd());
+  /**
+   * @param points3d Points in the camera frame (one by column).
+   * @see MultiGazeTask
+   */
+  MultiGazeTask(const rbd::MultiBody & mb,
+                const std::string & bodyName,
+                const Eigen::Matrix3Xd & points3d,
+                const sva::PTransformd & X_b_gaze,
+                const Eigen::Matrix2Xd & points2d_ref = Eigen::Matrix2Xd());
+
+  int nrPoints() const { return static_cast<int>(points2d_.cols()); }
+
+  /// Change the error of point index.
+  void error(int index,
+             const Eigen::Vector2d & point2d,
+             double depthEstimate,
+             const Eigen::Vector2d & point2d_ref = Eigen::Vector2d::Zero());
+  void error(int index, const Eigen::Vector3d & point3d, const Eigen::Vector2d & point2d_ref = Eigen::Vector2d::Zero());
+  /**
+   * Change the error of all points, the number of points can't change.
+   * @throw std::domain_error If the arguments size doesn't match nrPoints.
+   */
+  void error(const Eigen::Matrix2Xd & points2d,
+             const Eigen::VectorXd & depthEstimates,
+             const Eigen::Matrix2Xd & points2d_ref);
+
+  void update(const rbd::MultiBody & mb,
+              const rbd::MultiBodyConfig & mbc,
+              const std::vector<sva::MotionVecd> & normalAccB);
+
+  const Eigen::VectorXd & eval() const;
+  const Eigen::VectorXd & speed() const;
+  const Eigen::VectorXd & normalAcc() const;
+
+  const Eigen::MatrixXd & jac() const;
+
+private:
+  Eigen::Matrix2Xd points2d_;
+  Eigen::Matrix2Xd points2d_ref_;
+  Eigen::VectorXd depthEstimates_;
+  int bodyIndex_;
+  rbd::Jacobian jac_;
+  sva::PTransformd X_b_gaze_;
+
+  Eigen::VectorXd eval_;
+  Eigen::VectorXd speed_;
+  Eigen::VectorXd normalAcc_;
+  Eigen::MatrixXd L_img_; ///< stacked interaction matrices
+  Eigen::MatrixXd shortJacMat_;
+  Eigen::MatrixXd jacMat_;
+};
+
 class TASKS_DLLAPI PositionBasedVisServoTask
 {
 public:
@@ -452,6 +629,11 @@ public:
               const rbd::MultiBodyConfig & mbc,
               const Eigen::Vector3d & com,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /**
+   * Update from precomputed CoM quantities.
+   * Per body weights are ignored.
+   */
+  void update(const CentroidalData & centroidal);
   void updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc);
 
   const Eigen::VectorXd & eval() const;
@@ -493,6 +675,11 @@ public:
               const std::vector<rbd::MultiBodyConfig> & mbcs,
               const std::vector<Eigen::Vector3d> & coms,
               const std::vector<std::vector<sva::MotionVecd>> & normalAccB);
+  /**
+   * Update from precomputed CoM quantities.
+   * @param centroidal CoM quantities of each robot, ordered like robotIndexes.
+   */
+  void update(const std::vector<const CentroidalData *> & centroidal);
 
   const Eigen::VectorXd & eval() const;
   const Eigen::VectorXd & speed() const;
@@ -532,6 +719,8 @@ public:
   void update(const rbd::MultiBody & mb,
               const rbd::MultiBodyConfig & mbc,
               const std::vector<sva::MotionVecd> & normalAccB);
+  /// Update from precomputed centroidal momentum quantities.
+  void update(const CentroidalData & centroidal);
   void updateDot(const rbd::MultiBody & mb, const rbd::MultiBodyConfig & mbc);
 
   const Eigen::VectorXd & eval() const;
@@ -478,6 +478,170 @@ BOOST_AUTO_TEST_CASE(MultiRobotTransformTest)
   solver.removeTask(&mrtt);
 }
 
+BOOST_AUTO_TEST_CASE(DecompositionTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb1, mb2;
+  MultiBodyConfig mbc1Init, mbc2Init;
+
+  std::tie(mb1, mbc1Init) =
+      makeZXZArm(true, sva::PTransformd(sva::RotZ(-cst::pi<double>() / 4.), Vector3d(-0.5, 0., 0.)));
+  forwardKinematics(mb1, mbc1Init);
+  forwardVelocity(mb1, mbc1Init);
+
+  std::tie(mb2, mbc2Init) =
+      makeZXZArm(false, sva::PTransformd(sva::RotZ(cst::pi<double>() / 2.), Vector3d(0.5, 0., 0.)));
+  forwardKinematics(mb2, mbc2Init);
+  forwardVelocity(mb2, mbc2Init);
+
+  std::vector<MultiBody> mbs = {mb1, mb2};
+  std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+  qp::QPSolver solver;
+  solver.solver("QLD");
+
+  qp::PostureTask posture1Task(mbs, 0, mbc1Init.q, 0.1, 10.);
+  qp::PostureTask posture2Task(mbs, 1, mbc2Init.q, 0.1, 10.);
+  qp::PositionTask pos1Task(mbs, 0, "b3", mbc1Init.bodyPosW.back().translation() + Vector3d(0., 0.1, 0.));
+  qp::SetPointTask pos1TaskSp(mbs, 0, &pos1Task, 10., 100.);
+  qp::MultiRobotTransformTask mrtt(mbs, 0, 1, "b3", "b3", sva::PTransformd(sva::RotZ(-cst::pi<double>() / 8.)),
+                                   sva::PTransformd::Identity(), 100., 1000.);
+  mrtt.dimWeight((Vector6d() << 0., 0., 1., 1., 1., 0.).finished());
+
+  solver.addTask(&posture1Task);
+  solver.addTask(&posture2Task);
+  solver.addTask(&pos1TaskSp);
+
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+
+  // the two robots are independent
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_EQUAL(solver.nrSubProblems(), 1);
+  VectorXd fullResult = solver.result();
+  solver.decomposition(true);
+  // the worker threads are reused by the following solves
+  for(int i = 0; i < 3; ++i)
+  {
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    BOOST_CHECK_EQUAL(solver.nrSubProblems(), 2);
+    BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-6);
+  }
+
+  // the two robots are coupled by the MultiRobotTransformTask
+  solver.addTask(&mrtt);
+  solver.decomposition(false);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  fullResult = solver.result();
+  solver.decomposition(true);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_EQUAL(solver.nrSubProblems(), 1);
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-6);
+
+  solver.removeTask(&posture1Task);
+  solver.removeTask(&posture2Task);
+  solver.removeTask(&pos1TaskSp);
+  solver.removeTask(&mrtt);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb1, mb2;
+  MultiBodyConfig mbc1Init, mbc2Init;
+
+  std::tie(mb1, mbc1Init) = makeZXZArm();
+  std::tie(mb2, mbc2Init) = makeZXZArm();
+
+  forwardKinematics(mb1, mbc1Init);
+  forwardVelocity(mb1, mbc1Init);
+  forwardKinematics(mb2, mbc2Init);
+  forwardVelocity(mb2, mbc2Init);
+
+  sva::PTransformd X_0_b1(mbc1Init.bodyPosW.back());
+  sva::PTransformd X_0_b2(mbc2Init.bodyPosW.back());
+  sva::PTransformd X_b1_b2(X_0_b2 * X_0_b1.inv());
+
+  std::vector<MultiBody> mbs = {mb1, mb2};
+  std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+  qp::QPSolver solver;
+  solver.solver("QLD");
+
+  // the two robots are only coupled by the contact constraint lines
+  std::vector<qp::UnilateralContact> contVec = {qp::UnilateralContact(0, 1, "b3", "b3", {Vector3d::Zero()},
+                                                                      RotX(cst::pi<double>() / 2.), X_b1_b2, 3,
+                                                                      std::tan(cst::pi<double>() / 4.))};
+
+  Vector3d posD(RotZ(cst::pi<double>() / 4.) * mbc2Init.bodyPosW.back().translation());
+  qp::PositionTask posTask(mbs, 1, "b3", posD);
+  qp::SetPointTask posTaskSp(mbs, 1, &posTask, 10., 1.);
+  qp::PostureTask posture1Task(mbs, 0, mbc1Init.q, 0.1, 1.);
+  qp::PostureTask posture2Task(mbs, 1, mbc2Init.q, 0.1, 1.);
+
+  qp::ContactAccConstr contCstrAcc;
+
+  contCstrAcc.addToSolver(solver);
+  solver.addTask(&posTaskSp);
+  solver.addTask(&posture1Task);
+  solver.addTask(&posture2Task);
+
+  solver.nrVars(mbs, contVec, {});
+  solver.updateConstrSize();
+
+  for(int i = 0; i < 10; ++i)
+  {
+    solver.consensus(false);
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    VectorXd fullResult = solver.result();
+    solver.consensus(true);
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    BOOST_CHECK_EQUAL(solver.nrSubProblems(), 2);
+    BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-4);
+    for(std::size_t r = 0; r < mbs.size(); ++r)
+    {
+      integration(mbs[r], mbcs[r], 0.001);
+
+      forwardKinematics(mbs[r], mbcs[r]);
+      forwardVelocity(mbs[r], mbcs[r]);
+    }
+  }
+
+  solver.consensus(false);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  VectorXd fullResult = solver.result();
+
+  // the robots are coupled so the decomposition leaves the problem to the consensus
+  solver.consensus(true);
+  solver.decomposition(true);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_EQUAL(solver.nrSubProblems(), 2);
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-4);
+  solver.decomposition(false);
+
+  // the full problem is solved when the consensus doesn't converge
+  solver.consensusParameters(1., 1e-14, 1);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_EQUAL(solver.nrSubProblems(), 1);
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-10);
+  solver.consensus(false);
+
+  contCstrAcc.removeFromSolver(solver);
+  solver.removeTask(&posTaskSp);
+  solver.removeTask(&posture1Task);
+  solver.removeTask(&posture2Task);
+}
+
 // Test the TorqueTask
 BOOST_AUTO_TEST_CASE(TorqueTaskTest)
 {
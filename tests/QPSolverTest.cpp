@@ -5,7 +5,10 @@
 // includes
 // std
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <tuple>
+#include <type_traits>
 
 // boost
 #define BOOST_TEST_MODULE QPSolverTest
@@ -19,6 +22,7 @@
 #include <SpaceVecAlg/SpaceVecAlg>
 
 // RBDyn
+#include <RBDyn/FD.h>
 #include <RBDyn/FK.h>
 #include <RBDyn/FV.h>
 #include <RBDyn/ID.h>
@@ -31,8 +35,10 @@
 
 // Tasks
 #include "Tasks/Bounds.h"
+#include "Tasks/QPCollisionPairs.h"
 #include "Tasks/QPConstr.h"
 #include "Tasks/QPContactConstr.h"
+#include "Tasks/QPContactJacobianPool.h"
 #include "Tasks/QPMotionConstr.h"
 #include "Tasks/QPSolver.h"
 #include "Tasks/QPTasks.h"
@@ -68,6 +74,37 @@ BOOST_AUTO_TEST_CASE(FrictionConeTest)
   }
 }
 
+BOOST_AUTO_TEST_CASE(ContactIdTest)
+{
+  using namespace tasks;
+
+  qp::ContactId c1(0, 1, "b1", "b0");
+  qp::ContactId c2(0, 1, std::string("b") + "1", "b0");
+  qp::ContactId c3(0, 1, "b1", "b0", 2);
+  BOOST_CHECK_EQUAL(c1.r1BodyId(), qp::ContactId::bodyId("b1"));
+  BOOST_CHECK(c1 == c2);
+  BOOST_CHECK(!(c1 < c2) && !(c2 < c1));
+  BOOST_CHECK_EQUAL(std::hash<qp::ContactId>()(c1), std::hash<qp::ContactId>()(c2));
+  BOOST_CHECK(c1 != c3);
+  BOOST_CHECK(c1 < c3);
+
+  // assigning a body name update its id
+  c2.r2BodyName = "b2";
+  BOOST_CHECK(c1 != c2);
+  BOOST_CHECK_EQUAL(c2.r2BodyName, "b2");
+  BOOST_CHECK_EQUAL(c2.r2BodyId(), qp::ContactId::bodyId("b2"));
+  const std::string & r2BodyName = c2.r2BodyName;
+  BOOST_CHECK_EQUAL(r2BodyName, std::string("b2"));
+
+  // ordering follow the body ids, contacts only differing by their body
+  // names are still strictly ordered
+  qp::ContactId c4(0, 1, "zz", "b0");
+  qp::ContactId c5(0, 1, "aa", "b0");
+  BOOST_CHECK((c4 < c5) != (c5 < c4));
+  BOOST_CHECK_EQUAL(c4 < c5, c4.r1BodyId() < c5.r1BodyId());
+  BOOST_CHECK(c1 < c3 && !(c3 < c1));
+}
+
 // TODO contacts Test
 
 BOOST_AUTO_TEST_CASE(QPTaskTest)
@@ -116,6 +153,20 @@ BOOST_AUTO_TEST_CASE(QPTaskTest)
   }
 
   BOOST_CHECK_SMALL(posTask.eval().norm(), 0.00001);
+  // Q is computed from the compact jacobian, must match the dense one
+  BOOST_CHECK_EQUAL(posTask.jacDofs().size(), 3);
+  BOOST_CHECK_SMALL((posTaskSp.Q() - posTask.jac().transpose() * posTask.jac()).norm(), 1e-10);
+  // jacobian sliced from the kinematics sweep must match the RBDyn one
+  solver.data().computeKinematics(mbs, mbcs);
+  posTask.update(mbs, mbcs, solver.data());
+  rbd::Jacobian jacB3(mb, "b3");
+  MatrixXd jacB3Full(3, mb.nrDof());
+  jacB3.fullJacobian(mb, jacB3.jacobian(mb, mbcs[0]).bottomRows(3), jacB3Full);
+  BOOST_CHECK_SMALL((posTask.jac() - jacB3Full).norm(), 1e-10);
+  // flattened state vectors are filled by the kinematics sweep
+  BOOST_CHECK_SMALL((solver.data().qVec(0) - rbd::paramToVector(mb, mbcs[0].q)).norm(), 1e-12);
+  BOOST_CHECK_SMALL((solver.data().alphaVec(0) - rbd::dofToVector(mb, mbcs[0].alpha)).norm(), 1e-12);
+  BOOST_CHECK_SMALL((solver.data().alphaDVec(0) - rbd::dofToVector(mb, mbcs[0].alphaD)).norm(), 1e-12);
 
   // test removeTask
   solver.removeTask(&posTaskSp);
@@ -181,6 +232,9 @@ BOOST_AUTO_TEST_CASE(QPTaskTest)
 
   BOOST_CHECK_SMALL(postureTask.task().eval().head(2).norm(), 0.00001);
   BOOST_CHECK_SMALL(postureTask.task().eval().tail(1).norm() - 0.8, 0.00001);
+  // only the diagonal of Q is filled
+  BOOST_CHECK(postureTask.structure() == qp::Task::QStructure::Diagonal);
+  BOOST_CHECK_SMALL((postureTask.Q() - Eigen::MatrixXd(postureDimW.asDiagonal())).norm(), 1e-12);
 
   solver.removeTask(&postureTask);
 
@@ -227,6 +281,88 @@ BOOST_AUTO_TEST_CASE(QPTaskTest)
   solver.removeTask(&linVelocityTaskSp);
 }
 
+/// PositionTask that count its update calls.
+class CountPositionTask : public tasks::qp::PositionTask
+{
+public:
+  using tasks::qp::PositionTask::PositionTask;
+
+  void update(const std::vector<rbd::MultiBody> & mbs,
+              const std::vector<rbd::MultiBodyConfig> & mbcs,
+              const tasks::qp::SolverData & data) override
+  {
+    ++nrUpdate;
+    tasks::qp::PositionTask::update(mbs, mbcs, data);
+  }
+
+  int nrUpdate = 0;
+};
+
+BOOST_AUTO_TEST_CASE(QPStackedTaskTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb;
+  MultiBodyConfig mbcInit;
+
+  std::tie(mb, mbcInit) = makeZXZArm();
+
+  std::vector<MultiBody> mbs = {mb};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+  forwardKinematics(mb, mbcs[0]);
+  forwardVelocity(mb, mbcs[0]);
+
+  qp::QPSolver solver;
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+
+  CountPositionTask posTask(mbs, 0, "b3", Vector3d(0.707106, 0.707106, 0.));
+  qp::OrientationTask oriTask(mbs, 0, "b3", RotZ(cst::pi<double>() / 2.));
+  qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+  qp::SetPointTask oriTaskSp(mbs, 0, &oriTask, 20., 2.);
+
+  qp::StackedTask stackedTask(mbs, 0, 1.);
+  stackedTask.addTask(&posTask, 10., 1.);
+  stackedTask.addTask(&oriTask, 20., 2.);
+  BOOST_CHECK_EQUAL(stackedTask.nrTasks(), 2);
+
+  solver.addTask(&posTaskSp);
+  solver.addTask(&oriTaskSp);
+  solver.addTask(&stackedTask);
+  solver.updateTasksNrVars(mbs);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  // posTask is shared by posTaskSp and stackedTask but must be updated once
+  BOOST_CHECK_EQUAL(posTask.nrUpdate, 1);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_EQUAL(posTask.nrUpdate, 2);
+
+  // the solver data are identified by their epoch, a copy at the same tick
+  // is another solver and must trigger an update
+  qp::SolverData dataCopy(solver.data());
+  BOOST_CHECK_NE(solver.data().epoch(), 0);
+  BOOST_CHECK_NE(dataCopy.epoch(), solver.data().epoch());
+  BOOST_CHECK_EQUAL(dataCopy.tick(), solver.data().tick());
+  posTask.updateOnce(mbs, mbcs, dataCopy);
+  BOOST_CHECK_EQUAL(posTask.nrUpdate, 3);
+  posTask.updateOnce(mbs, mbcs, dataCopy);
+  BOOST_CHECK_EQUAL(posTask.nrUpdate, 3);
+
+  // the stacked task must be the weighted sum of the separated tasks
+  MatrixXd Q = posTaskSp.weight() * posTaskSp.Q() + oriTaskSp.weight() * oriTaskSp.Q();
+  VectorXd C = posTaskSp.weight() * posTaskSp.C() + oriTaskSp.weight() * oriTaskSp.C();
+  BOOST_CHECK_SMALL((stackedTask.Q() - Q).norm(), 1e-8);
+  BOOST_CHECK_SMALL((stackedTask.C() - C).norm(), 1e-8);
+
+  BOOST_CHECK(stackedTask.removeTask(&oriTask));
+  BOOST_CHECK(!stackedTask.removeTask(&oriTask));
+  BOOST_CHECK_THROW(stackedTask.gains(&oriTask, 1., 1.), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(QPConstrTest)
 {
   using namespace Eigen;
@@ -300,6 +436,24 @@ BOOST_AUTO_TEST_CASE(QPConstrTest)
   BOOST_CHECK_SMALL((posTask.eval() - evalPos).norm(), 0.00001);
   BOOST_CHECK_SMALL((oriTask.eval() - evalOri).norm(), 0.00001);
 
+  // Test null space reduction give the same solution
+  std::string defaultSolver = solver.solver();
+  solver.solver("QLD");
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  VectorXd fullResult = solver.result();
+  solver.nullSpaceReduction(true);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-5);
+  solver.nullSpaceReduction(false);
+
+  // Test the sparse ADMM solver give the same solution, the second solve is warm started
+  solver.solver("ADMM");
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-3);
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  BOOST_CHECK_SMALL((solver.result() - fullResult).norm(), 1e-3);
+  solver.solver(defaultSolver);
+
   solver.removeTask(&posTaskSp);
   BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
   solver.removeTask(&oriTaskSp);
@@ -711,6 +865,16 @@ BOOST_AUTO_TEST_CASE(QPMimicJointTest)
   }
   BOOST_CHECK_SMALL(mbcs[0].q[1][0] - 0.2, 1e-4);
 
+  // the ADMM solver reduce the mimic joints in the same way
+  pt.posture(mbcInit.q);
+  BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+  VectorXd qldResult = solver.result();
+  solver.solver("ADMM");
+  BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+  BOOST_CHECK_SMALL((solver.result() - qldResult).norm(), 1e-3);
+  BOOST_CHECK_EQUAL(solver.result()(0), -solver.result()(1));
+  BOOST_CHECK_EQUAL(solver.result()(2), 0.);
+
   solver.removeTask(&pt);
   BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
 }
@@ -872,6 +1036,105 @@ BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
   BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(QPADMMTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb;
+  MultiBodyConfig mbcInit;
+
+  std::tie(mb, mbcInit) = makeZXZArm();
+
+  forwardKinematics(mb, mbcInit);
+  forwardVelocity(mb, mbcInit);
+
+  std::vector<rbd::MultiBody> mbs = {mb};
+  std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+  qp::QPSolver solver;
+
+  int bodyI = mb.bodyIndexByName("b3");
+  qp::PositionTask posTask(mbs, 0, "b3",
+                           RotZ(cst::pi<double>() / 2.) * mbcInit.bodyPosW[static_cast<size_t>(bodyI)].translation());
+  qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+  solver.addTask(&posTaskSp);
+
+  // tight torque limits to activate the general inequality lines
+  std::vector<std::vector<double>> lBound = {{}, {-1.}, {-1.}, {-1.}};
+  std::vector<std::vector<double>> uBound = {{}, {1.}, {1.}, {1.}};
+  qp::MotionConstr motionCstr(mbs, 0, {lBound, uBound});
+  motionCstr.addToSolver(solver);
+
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+
+  auto compareToQLD = [&](double tol) {
+    solver.solver("QLD");
+    BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+    VectorXd qldResult = solver.result();
+    solver.solver("ADMM");
+    BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+    BOOST_CHECK_SMALL((solver.result() - qldResult).norm(), tol);
+  };
+
+  // general inequalities
+  for(int i = 0; i < 10; ++i)
+  {
+    compareToQLD(1e-3);
+    motionCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+    for(int j = 0; j < 3; ++j)
+    {
+      BOOST_CHECK_GT(motionCstr.torque()(j), lBound[static_cast<size_t>(j) + 1][0] - 1e-3);
+      BOOST_CHECK_LT(motionCstr.torque()(j), uBound[static_cast<size_t>(j) + 1][0] + 1e-3);
+    }
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    integration(mbs[0], mbcs[0], 0.001);
+
+    forwardKinematics(mbs[0], mbcs[0]);
+    forwardVelocity(mbs[0], mbcs[0]);
+  }
+
+  // equal bound lines fix the torque
+  std::vector<std::vector<double>> torque = {{}, {0.5}, {-0.5}, {0.2}};
+  motionCstr.removeFromSolver(solver);
+  qp::MotionConstr motionEqCstr(mbs, 0, {torque, torque});
+  motionEqCstr.addToSolver(solver);
+  solver.updateConstrSize();
+  compareToQLD(1e-3);
+  motionEqCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+  for(int j = 0; j < 3; ++j)
+  {
+    BOOST_CHECK_SMALL(motionEqCstr.torque()(j) - torque[static_cast<size_t>(j) + 1][0], 1e-4);
+  }
+
+  // the solve fail when the iterations limit is reached
+  solver.admmParameters(1e-14, 0., 1);
+  BOOST_CHECK(!solver.solveNoMbcUpdate(mbs, mbcs));
+  BOOST_CHECK_EQUAL(solver.nrIterations(), 1);
+  solver.admmParameters(1e-6, 1e-6, 4000);
+
+  // two constraints fixing the torque to different values are certified
+  // infeasible before the iterations limit
+  std::vector<std::vector<double>> otherTorque = {{}, {1.}, {-0.5}, {0.2}};
+  qp::MotionConstr motionOtherCstr(mbs, 0, {otherTorque, otherTorque});
+  motionOtherCstr.addToSolver(solver);
+  solver.updateConstrSize();
+  BOOST_CHECK(!solver.solveNoMbcUpdate(mbs, mbcs));
+  BOOST_CHECK_LT(solver.nrIterations(), 4000);
+
+  // the next solve start from scratch
+  motionOtherCstr.removeFromSolver(solver);
+  solver.updateConstrSize();
+  BOOST_CHECK(solver.solveNoMbcUpdate(mbs, mbcs));
+
+  motionEqCstr.removeFromSolver(solver);
+  solver.removeTask(&posTaskSp);
+}
+
 BOOST_AUTO_TEST_CASE(QPAutoCollTest)
 {
   using namespace Eigen;
@@ -904,6 +1167,9 @@ BOOST_AUTO_TEST_CASE(QPAutoCollTest)
   int collId1 = 10;
   autoCollConstr.addCollision(mbs, collId1, 0, "b0", &b0, I, 0, "b3", &b3, I, 0.01, 0.005, 1.);
   BOOST_CHECK_EQUAL(autoCollConstr.nrCollisions(), 1);
+  // the columns are unknown until updateNrVars, AInEq and its segments must agree
+  BOOST_CHECK_EQUAL(autoCollConstr.AInEq().cols(), 0);
+  BOOST_CHECK_EQUAL(autoCollConstr.columnsInEq().size(), 0);
 
   // Test addInequalityConstraint
   solver.addInequalityConstraint(&autoCollConstr);
@@ -913,6 +1179,9 @@ BOOST_AUTO_TEST_CASE(QPAutoCollTest)
 
   solver.nrVars(mbs, {}, {});
   solver.updateConstrSize();
+  BOOST_CHECK_EQUAL(autoCollConstr.AInEq().cols(), mb.nrDof());
+  BOOST_REQUIRE_EQUAL(autoCollConstr.columnsInEq().size(), 1);
+  BOOST_CHECK_EQUAL(autoCollConstr.columnsInEq()[0].second, mb.nrDof());
 
   solver.addTask(&posTaskSp);
   BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
@@ -1089,6 +1358,191 @@ BOOST_AUTO_TEST_CASE(QPStaticEnvCollTest)
   BOOST_CHECK_EQUAL(solver.nrConstraints(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(CollisionPrimitivesTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace tasks;
+
+  Vector3d p1, p2;
+
+  // sphere-sphere must match sch-core
+  sch::S_Sphere s1(0.25), s2(0.1);
+  sch::CD_Pair pair(&s1, &s2);
+  PTransformd X_0_s1(RotZ(0.3), Vector3d(0.1, 0.2, 0.3));
+  PTransformd X_0_s2(RotX(1.2), Vector3d(0.5, -0.4, 0.2));
+  s1.setTransformation(qp::tosch(X_0_s1));
+  s2.setTransformation(qp::tosch(X_0_s2));
+  sch::Point3 pb1, pb2;
+  double schDist = std::sqrt(pair.getClosestPoints(pb1, pb2));
+  double dist = qp::primitiveDistance(qp::CollisionPrimitive::sphere(0.25), X_0_s1,
+                                      qp::CollisionPrimitive::sphere(0.1), X_0_s2, p1, p2);
+  BOOST_CHECK_SMALL(dist - schDist, 1e-6);
+  BOOST_CHECK_SMALL((p1 - Vector3d(pb1[0], pb1[1], pb1[2])).norm(), 1e-6);
+  BOOST_CHECK_SMALL((p2 - Vector3d(pb2[0], pb2[1], pb2[2])).norm(), 1e-6);
+
+  // crossed capsules
+  qp::CollisionPrimitive cap = qp::CollisionPrimitive::capsule(1., 0.1);
+  PTransformd X_0_c1(Vector3d(0., 0., 0.));
+  PTransformd X_0_c2(RotY(boost::math::constants::pi<double>() / 2.), Vector3d(0.3, 0.5, 0.1));
+  dist = qp::primitiveDistance(cap, X_0_c1, cap, X_0_c2, p1, p2);
+  BOOST_CHECK_SMALL(dist - 0.3, 1e-8);
+  BOOST_CHECK_SMALL((p1 - p2 - dist * Vector3d(0., -1., 0.)).norm(), 1e-8);
+
+  // capsule over a box face, then sinking in it
+  qp::CollisionPrimitive box = qp::CollisionPrimitive::box(Vector3d(1., 1., 0.2));
+  PTransformd X_0_b(Vector3d(0., 0., 0.));
+  PTransformd X_0_c(RotX(boost::math::constants::pi<double>() / 2.), Vector3d(0.2, 0., 0.5));
+  dist = qp::primitiveDistance(cap, X_0_c, box, X_0_b, p1, p2);
+  BOOST_CHECK_SMALL(dist - 0.3, 1e-8);
+  BOOST_CHECK_SMALL(p2.z() - 0.1, 1e-8);
+  double swapDist = qp::primitiveDistance(box, X_0_b, cap, X_0_c, p2, p1);
+  BOOST_CHECK_SMALL(dist - swapDist, 1e-8);
+
+  X_0_c = PTransformd(RotX(boost::math::constants::pi<double>() / 2.), Vector3d(0.2, 0., 0.05));
+  dist = qp::primitiveDistance(cap, X_0_c, box, X_0_b, p1, p2);
+  BOOST_CHECK_SMALL(dist + 0.15, 1e-8);
+  BOOST_CHECK_SMALL((p1 - p2 - dist * Vector3d::UnitZ()).norm(), 1e-8);
+
+  // slanted capsule inside the box, the deepest point (0.2, 0, -0.2) is where the x and z depths cross
+  qp::CollisionPrimitive bigBox = qp::CollisionPrimitive::box(Vector3d(2., 2., 2.));
+  X_0_c = PTransformd(RotY(boost::math::constants::pi<double>() / 4.), Vector3d(0.5, 0., 0.1));
+  dist = qp::primitiveDistance(cap, X_0_c, bigBox, X_0_b, p1, p2);
+  BOOST_CHECK_SMALL(dist + 0.9, 1e-8);
+  BOOST_CHECK_SMALL((p1 - p2 - dist * Vector3d::UnitX()).norm(), 1e-8);
+
+  BOOST_CHECK_THROW(qp::primitiveDistance(box, X_0_b, box, X_0_b, p1, p2), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(QPPrimitiveCollTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb;
+  MultiBodyConfig mbcInit;
+
+  std::tie(mb, mbcInit) = makeZXZArm();
+
+  forwardKinematics(mb, mbcInit);
+  forwardVelocity(mb, mbcInit);
+
+  std::vector<MultiBody> mbs = {mb};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+  qp::QPSolver solver;
+
+  int b0I = mb.bodyIndexByName("b0");
+  int bodyI = mb.bodyIndexByName("b3");
+  qp::PositionTask posTask(mbs, 0, "b3", mbcInit.bodyPosW[static_cast<size_t>(bodyI)].translation());
+  qp::SetPointTask posTaskSp(mbs, 0, &posTask, 50., 1.);
+
+  // same setup than QPAutoCollTest with a box around b0 and a capsule around b3
+  qp::CollisionPrimitive b0 = qp::CollisionPrimitive::box(Vector3d(0.4, 0.4, 0.4));
+  qp::CollisionPrimitive b3 = qp::CollisionPrimitive::capsule(0.1, 0.2);
+
+  PTransformd I = PTransformd::Identity();
+  qp::CollisionConstr collConstr(mbs, 0.001);
+  collConstr.addCollision(mbs, 10, 0, "b0", b0, I, 0, "b3", b3, I, 0.01, 0.005, 1.);
+  BOOST_CHECK_EQUAL(collConstr.nrCollisions(), 1);
+
+  solver.addInequalityConstraint(&collConstr);
+  solver.addConstraint(&collConstr);
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+  solver.addTask(&posTaskSp);
+
+  Vector3d p1, p2;
+  for(int i = 0; i < 1000; ++i)
+  {
+    posTask.position(RotX(0.01) * posTask.position());
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    integration(mbs[0], mbcs[0], 0.001);
+
+    forwardKinematics(mbs[0], mbcs[0]);
+    forwardVelocity(mbs[0], mbcs[0]);
+
+    double dist = qp::primitiveDistance(b0, mbcs[0].bodyPosW[static_cast<size_t>(b0I)], b3,
+                                        mbcs[0].bodyPosW[static_cast<size_t>(bodyI)], p1, p2);
+    BOOST_REQUIRE_GT(dist, 0.001);
+  }
+
+  solver.removeTask(&posTaskSp);
+  solver.removeInequalityConstraint(&collConstr);
+  solver.removeConstraint(&collConstr);
+}
+
+BOOST_AUTO_TEST_CASE(SelfCollisionPairsTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb;
+  MultiBodyConfig mbcInit;
+
+  std::tie(mb, mbcInit) = makeZXZArm();
+  std::vector<MultiBody> mbs = {mb};
+
+  qp::CollisionPrimitive sphere = qp::CollisionPrimitive::sphere(0.1);
+  qp::SelfCollisionPairs builder(mb, {{"b0", sphere}, {"b1", sphere}, {"b2", sphere}, {"b3", sphere}});
+  BOOST_CHECK_THROW(qp::SelfCollisionPairs(mb, {{"b0", sphere}, {"b0", sphere}}), std::domain_error);
+
+  // adjacent bodies are removed
+  builder.generate();
+  BOOST_REQUIRE_EQUAL(builder.pairs().size(), 3);
+  BOOST_CHECK(builder.pairs()[0] == qp::SelfCollisionPair("b0", "b2"));
+  BOOST_CHECK(builder.pairs()[1] == qp::SelfCollisionPair("b0", "b3"));
+  BOOST_CHECK(builder.pairs()[2] == qp::SelfCollisionPair("b1", "b3"));
+
+  // b2 always stay 0.5 away from b0, b3 can only come back near b0 and b1
+  // if j1 can fold the arm
+  double pi = boost::math::constants::pi<double>();
+  double inf = std::numeric_limits<double>::infinity();
+  QBound fullBound({{}, {-inf}, {-pi}, {-inf}}, {{}, {inf}, {pi}, {inf}});
+  builder.filterUnreachable(mb, mbcInit, fullBound, 1000, 0.05);
+  BOOST_REQUIRE_EQUAL(builder.pairs().size(), 2);
+  BOOST_CHECK(builder.pairs()[0] == qp::SelfCollisionPair("b0", "b3"));
+  BOOST_CHECK(builder.pairs()[1] == qp::SelfCollisionPair("b1", "b3"));
+
+  builder.save("selfCollisionPairs.txt");
+
+  QBound smallBound({{}, {-inf}, {-1.}, {-inf}}, {{}, {inf}, {1.}, {inf}});
+  builder.filterUnreachable(mb, mbcInit, smallBound, 1000, 0.05);
+  BOOST_CHECK_EQUAL(builder.pairs().size(), 0);
+
+  builder.load("selfCollisionPairs.txt");
+  BOOST_CHECK_EQUAL(builder.pairs().size(), 2);
+
+  qp::CollisionConstr collConstr(mbs, 0.001);
+  BOOST_CHECK_EQUAL(builder.addToConstraint(collConstr, mbs, 0, 10, 0.1, 0.01, 0., 0.1), 12);
+  BOOST_CHECK_EQUAL(collConstr.nrCollisions(), 2);
+
+  // box-box pairs have no analytic distance, they are reported to the caller
+  // and must never reach the constraint
+  qp::CollisionPrimitive box = qp::CollisionPrimitive::box(Vector3d(0.2, 0.2, 0.2));
+  qp::SelfCollisionPairs boxBuilder(mb, {{"b0", box}, {"b2", sphere}, {"b3", box}});
+  const std::vector<qp::SelfCollisionPair> & unsupported = boxBuilder.generate();
+  BOOST_REQUIRE_EQUAL(boxBuilder.pairs().size(), 1);
+  BOOST_CHECK(boxBuilder.pairs()[0] == qp::SelfCollisionPair("b0", "b2"));
+  BOOST_REQUIRE_EQUAL(unsupported.size(), 1);
+  BOOST_CHECK(unsupported[0] == qp::SelfCollisionPair("b0", "b3"));
+  BOOST_CHECK_EQUAL(boxBuilder.unsupportedPairs().size(), 1);
+
+  std::ofstream boxPairs("boxCollisionPairs.txt");
+  boxPairs << "b0 b2\nb0 b3\n";
+  boxPairs.close();
+  BOOST_CHECK_THROW(boxBuilder.load("boxCollisionPairs.txt"), std::runtime_error);
+  BOOST_CHECK_EQUAL(boxBuilder.pairs().size(), 1);
+
+  qp::CollisionConstr boxCollConstr(mbs, 0.001);
+  BOOST_CHECK_EQUAL(boxBuilder.addToConstraint(boxCollConstr, mbs, 0, 10, 0.1, 0.01, 0., 0.1), 11);
+  BOOST_CHECK_EQUAL(boxCollConstr.nrCollisions(), 1);
+}
+
 BOOST_AUTO_TEST_CASE(QPBilatContactTest)
 {
   using namespace Eigen;
@@ -1180,6 +1634,369 @@ BOOST_AUTO_TEST_CASE(QPBilatContactTest)
   solver.removeGenInequalityConstraint(&motionCstr);
 }
 
+BOOST_AUTO_TEST_CASE(QPWrenchContactTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb, mbEnv;
+  MultiBodyConfig mbcInit, mbcEnv;
+
+  std::tie(mb, mbcInit) = makeZXZArm(false);
+  std::tie(mbEnv, mbcEnv) = makeEnv();
+
+  forwardKinematics(mb, mbcInit);
+  forwardVelocity(mb, mbcInit);
+  forwardKinematics(mbEnv, mbcEnv);
+  forwardVelocity(mbEnv, mbcEnv);
+
+  std::vector<MultiBody> mbs = {mb, mbEnv};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+  qp::QPSolver solver;
+
+  double Inf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.}, {-Inf}, {-Inf}, {-Inf}};
+  std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.}, {Inf}, {Inf}, {Inf}};
+  qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+  qp::PositiveLambda plCstr;
+  qp::ContactWrenchConeConstr cwcCstr;
+  qp::ContactAccConstr contCstrAcc;
+
+  motionCstr.addToSolver(solver);
+  plCstr.addToSolver(solver);
+  cwcCstr.addToSolver(solver);
+  contCstrAcc.addToSolver(solver);
+
+  qp::ContactId cId(0, 1, "b0", "b0");
+  // surface normal along the Y axis, the gravity come from the Y axis
+  std::vector<qp::WrenchContact> wrench = {qp::WrenchContact(cId, PTransformd(RotX(-cst::pi<double>() / 2.)), 0.1,
+                                                             0.1, 0.7, PTransformd::Identity())};
+
+  // one wrench instead of 4 points with 4 generators
+  solver.nrVars(mbs, {}, {}, wrench);
+  solver.updateConstrSize();
+  BOOST_CHECK_EQUAL(solver.nrVars(), 9 + 6);
+  BOOST_CHECK_EQUAL(solver.contactLambdaPosition(cId), 0);
+  BOOST_CHECK_EQUAL(cwcCstr.maxInEq(), 16);
+
+  mbcs[0] = mbcInit;
+  for(int i = 0; i < 10; ++i)
+  {
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    BOOST_CHECK_LE((wrench[0].cone * solver.lambdaVec(0)).maxCoeff(), 1e-6);
+    integration(mbs[0], mbcs[0], 0.001);
+
+    forwardKinematics(mbs[0], mbcs[0]);
+    forwardVelocity(mbs[0], mbcs[0]);
+  }
+
+  // wrench of the corners of the surface lie in the cone
+  ForceVecd w(Vector6d::Zero());
+  for(double x : {-0.1, 0.1})
+  {
+    for(double y : {-0.1, 0.1})
+    {
+      w += PTransformd(Vector3d(x, y, 0.)).transMul(ForceVecd(Vector3d::Zero(), Vector3d(0.7, -0.7, 1.)));
+    }
+  }
+  BOOST_CHECK_LE((wrench[0].cone * w.vector()).maxCoeff(), 1e-10);
+  BOOST_CHECK_GT((wrench[0].cone * (w + ForceVecd(Vector3d(0., 0., 0.1), Vector3d::Zero())).vector()).maxCoeff(), 0.);
+
+  contCstrAcc.removeFromSolver(solver);
+  cwcCstr.removeFromSolver(solver);
+  plCstr.removeFromSolver(solver);
+  motionCstr.removeFromSolver(solver);
+}
+
+BOOST_AUTO_TEST_CASE(QPEqualBoundGenInEqTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+  namespace cst = boost::math::constants;
+
+  MultiBody mb, mbEnv;
+  MultiBodyConfig mbcInit, mbcEnv;
+
+  std::tie(mb, mbcInit) = makeZXZArm(false);
+  std::tie(mbEnv, mbcEnv) = makeEnv();
+
+  forwardKinematics(mb, mbcInit);
+  forwardVelocity(mb, mbcInit);
+  forwardKinematics(mbEnv, mbcEnv);
+  forwardVelocity(mbEnv, mbcEnv);
+
+  std::vector<MultiBody> mbs = {mb, mbEnv};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+  qp::QPSolver solver;
+  solver.solver("QLD");
+
+  // every motion line has equal bounds and must be written in the QLD
+  // equality block along with the contact acceleration equalities
+  std::vector<std::vector<double>> torque = {{0., 0., 0., 0., 0., 0.}, {0.1}, {-0.2}, {0.3}};
+  qp::MotionConstr motionCstr(mbs, 0, {torque, torque});
+  qp::ContactAccConstr contCstrAcc;
+
+  motionCstr.addToSolver(solver);
+  contCstrAcc.addToSolver(solver);
+
+  qp::ContactId cId(0, 1, "b0", "b0");
+  std::vector<qp::WrenchContact> wrench = {qp::WrenchContact(cId, PTransformd(RotX(-cst::pi<double>() / 2.)), 0.1,
+                                                             0.1, 0.7, PTransformd::Identity())};
+
+  solver.nrVars(mbs, {}, {}, wrench);
+  solver.updateConstrSize();
+  BOOST_CHECK_EQUAL(solver.nrVars(), 9 + 6);
+  BOOST_CHECK_EQUAL(motionCstr.maxGenInEq(), 9);
+  BOOST_CHECK_EQUAL(contCstrAcc.maxEq(), 6);
+
+  for(int i = 0; i < 10; ++i)
+  {
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    BOOST_CHECK_SMALL(solver.alphaDVec(0).head<6>().norm(), 1e-8);
+
+    motionCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+    BOOST_CHECK_SMALL(motionCstr.torque().head<6>().norm(), 1e-8);
+    BOOST_CHECK_SMALL(motionCstr.torque()(6) - 0.1, 1e-8);
+    BOOST_CHECK_SMALL(motionCstr.torque()(7) + 0.2, 1e-8);
+    BOOST_CHECK_SMALL(motionCstr.torque()(8) - 0.3, 1e-8);
+
+    integration(mbs[0], mbcs[0], 0.001);
+    forwardKinematics(mbs[0], mbcs[0]);
+    forwardVelocity(mbs[0], mbcs[0]);
+  }
+
+  contCstrAcc.removeFromSolver(solver);
+  motionCstr.removeFromSolver(solver);
+}
+
+BOOST_AUTO_TEST_CASE(ContactJacobianPoolTest)
+{
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb, mbFree;
+  MultiBodyConfig mbc, mbcFree;
+  std::tie(mb, mbc) = makeZXZArm();
+  std::tie(mbFree, mbcFree) = makeZXZArm(false);
+  std::vector<MultiBody> mbs = {mb, mbFree};
+
+  qp::ContactJacobianPool pool;
+  int j3 = pool.index(mbs, 0, "b3");
+  BOOST_CHECK_EQUAL(pool.size(), 1);
+  BOOST_CHECK_EQUAL(pool[j3].dof(), 3);
+  BOOST_CHECK_EQUAL(pool.index(mbs, 0, "b3"), j3);
+
+  // adding other bodies must not change the existing indices
+  BOOST_CHECK_EQUAL(pool[pool.index(mbs, 0, "b1")].dof(), 1);
+  BOOST_CHECK_EQUAL(pool[pool.index(mbs, 1, "b3")].dof(), 9);
+  BOOST_CHECK_EQUAL(pool.size(), 3);
+  BOOST_CHECK_EQUAL(pool.index(mbs, 0, "b3"), j3);
+
+  // a jacobian that no longer match its robot is rebuilt
+  mbs[1] = mb;
+  BOOST_CHECK_EQUAL(pool[pool.index(mbs, 1, "b3")].dof(), 3);
+  BOOST_CHECK_EQUAL(pool.size(), 3);
+
+  // b3 keep its index and its dof but is now supported by b1
+  MultiBodyGraph mbg;
+  sva::RBInertiad rbi(1., Eigen::Vector3d::Zero(), Eigen::Matrix3d::Identity());
+  for(const std::string & b : {"b0", "b1", "b2", "b3"}) { mbg.addBody(Body(rbi, b)); }
+  mbg.addJoint(Joint(Joint::RevZ, true, "j0"));
+  mbg.addJoint(Joint(Joint::RevX, true, "j1"));
+  mbg.addJoint(Joint(Joint::Cylindrical, Eigen::Vector3d::UnitZ(), true, "j2"));
+  mbg.linkBodies("b0", sva::PTransformd::Identity(), "b1", sva::PTransformd::Identity(), "j0");
+  mbg.linkBodies("b1", sva::PTransformd::Identity(), "b2", sva::PTransformd::Identity(), "j1");
+  mbg.linkBodies("b1", sva::PTransformd::Identity(), "b3", sva::PTransformd::Identity(), "j2");
+  mbs[0] = mbg.makeMultiBody("b0", true);
+  BOOST_REQUIRE_EQUAL(mbs[0].bodyIndexByName("b3"), 3);
+  BOOST_CHECK_EQUAL(pool.index(mbs, 0, "b3"), j3);
+  BOOST_CHECK_EQUAL(pool[j3].dof(), 3);
+  BOOST_CHECK(pool[j3].jointsPath() == std::vector<int>({0, 1, 3}));
+
+  // a copy own its jacobians
+  qp::ContactJacobianPool poolCopy(pool);
+  BOOST_CHECK_EQUAL(poolCopy.size(), pool.size());
+  BOOST_CHECK(&poolCopy[j3] != &pool[j3]);
+  BOOST_CHECK(poolCopy[j3].jointsPath() == pool[j3].jointsPath());
+
+  pool.clear();
+  BOOST_CHECK_EQUAL(pool.size(), 0);
+  BOOST_CHECK_EQUAL(poolCopy.size(), 3);
+
+  // constraints holding pool jacobians stay copyable
+  BOOST_CHECK(std::is_copy_constructible<qp::ContactAccConstr>::value);
+  BOOST_CHECK(std::is_copy_assignable<qp::ContactAccConstr>::value);
+  BOOST_CHECK(std::is_copy_constructible<qp::MotionConstr>::value);
+  BOOST_CHECK(std::is_copy_assignable<qp::MotionConstr>::value);
+}
+
+BOOST_AUTO_TEST_CASE(SelfContactMotionTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb;
+  MultiBodyConfig mbc;
+
+  std::tie(mb, mbc) = makeZXZArm(false);
+  mbc.q[1] = {0.4};
+  mbc.q[2] = {-0.7};
+  mbc.q[3] = {0.2};
+  forwardKinematics(mb, mbc);
+  forwardVelocity(mb, mbc);
+
+  std::vector<MultiBody> mbs = {mb};
+  std::vector<MultiBodyConfig> mbcs = {mbc};
+
+  qp::QPSolver solver;
+
+  double Inf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.}, {-Inf}, {-Inf}, {-Inf}};
+  std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.}, {Inf}, {Inf}, {Inf}};
+  qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+  motionCstr.addToSolver(solver);
+
+  // b3 touch b1, the same lambda push on b3 and on b1
+  qp::UnilateralContact selfCont(0, 0, "b3", "b1", {Vector3d(0.1, 0., 0.), Vector3d(0., 0.1, 0.)}, RotX(0.3),
+                                 PTransformd(Vector3d(0.1, 0.2, 0.)), 3, 0.7);
+  solver.nrVars(mbs, {selfCont}, {});
+  solver.updateConstrSize();
+  motionCstr.update(mbs, mbcs, solver.data());
+
+  // the lambda columns must be the sum of the point jacobians of both bodies
+  const qp::BilateralContact & c = solver.data().allContacts()[0];
+  MatrixXd ref = MatrixXd::Zero(mb.nrDof(), c.nrLambda());
+  MatrixXd fullJac(6, mb.nrDof());
+  auto addBody = [&](const std::string & bName, const std::vector<Vector3d> & points,
+                     const std::vector<qp::FrictionCone> & cones) {
+    Matrix3d E_0_b = mbc.bodyPosW[static_cast<size_t>(mb.bodyIndexByName(bName))].rotation().transpose();
+    int col = 0;
+    for(std::size_t i = 0; i < points.size(); ++i)
+    {
+      Jacobian jac(mb, bName, points[i]);
+      jac.fullJacobian(mb, jac.jacobian(mb, mbc), fullJac);
+      for(const Vector3d & g : cones[i].generators)
+      {
+        ref.col(col) -= fullJac.bottomRows<3>().transpose() * (E_0_b * g);
+        ++col;
+      }
+    }
+  };
+  addBody("b3", c.r1Points, c.r1Cones);
+  addBody("b1", c.r2Points, c.r2Cones);
+
+  BOOST_CHECK_GT(ref.norm(), 1e-3);
+  BOOST_CHECK_SMALL((motionCstr.contactMatrix() - ref).norm(), 1e-10);
+
+  motionCstr.removeFromSolver(solver);
+}
+
+BOOST_AUTO_TEST_CASE(QPProjectedMotionTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb, mbEnv;
+  MultiBodyConfig mbcInit, mbcEnv;
+
+  std::tie(mb, mbcInit) = makeZXZArm(false);
+  std::tie(mbEnv, mbcEnv) = makeEnv();
+
+  forwardKinematics(mb, mbcInit);
+  forwardVelocity(mb, mbcInit);
+  forwardKinematics(mbEnv, mbcEnv);
+  forwardVelocity(mbEnv, mbcEnv);
+
+  std::vector<MultiBody> mbs = {mb, mbEnv};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+  qp::QPSolver solver;
+
+  double Inf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.}, {-Inf}, {-Inf}, {-Inf}};
+  std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.}, {Inf}, {Inf}, {Inf}};
+  // the base is fixed to the environment
+  qp::BilateralContact rigid(0, 1, "b0", "b0", {Vector3d::Zero()}, {Matrix3d::Identity()}, PTransformd::Identity(), 3,
+                             0.7);
+  qp::ProjectedMotionConstr projCstr(mbs, 0, {torqueMin, torqueMax}, {rigid});
+  projCstr.addToSolver(solver);
+
+  std::vector<std::vector<double>> qTarget = mbcInit.q;
+  qTarget[1][0] = 0.5;
+  qp::PostureTask postureTask(mbs, 0, qTarget, 10., 1.);
+  solver.addTask(&postureTask);
+
+  // the rigid contact add no lambda
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+  BOOST_CHECK_EQUAL(solver.nrVars(), 9);
+
+  ForwardDynamics fd(mbs[0]);
+  Jacobian jac(mbs[0], "b0");
+  MatrixXd fullJac(6, mbs[0].nrDof());
+  // computeTorque must also recover the rigid contact wrenches when called
+  // through the MotionConstrCommon interface
+  qp::MotionConstrCommon & motionCommon = projCstr;
+  mbcs[0] = mbcInit;
+  for(int i = 0; i < 100; ++i)
+  {
+    BOOST_REQUIRE(solver.solve(mbs, mbcs));
+    motionCommon.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+
+    // H alphaD + C = tau + J^T f with the contact frame at the body origin
+    fd.computeH(mbs[0], mbcs[0]);
+    fd.computeC(mbs[0], mbcs[0]);
+    jac.fullJacobian(mbs[0], jac.bodyJacobian(mbs[0], mbcs[0]), fullJac);
+    VectorXd res = fd.H() * solver.alphaDVec(0) + fd.C() - projCstr.torque()
+                   - fullJac.transpose() * projCstr.rigidContactWrench(0).vector();
+    BOOST_CHECK_SMALL(res.norm(), 1e-6);
+    BOOST_CHECK_SMALL(projCstr.torque().head<6>().norm(), 1e-10);
+
+    integration(mbs[0], mbcs[0], 0.001);
+
+    forwardKinematics(mbs[0], mbcs[0]);
+    forwardVelocity(mbs[0], mbcs[0]);
+  }
+
+  BOOST_CHECK_SMALL(mbcs[0].bodyVelB[0].vector().norm(), 1e-6);
+  BOOST_CHECK_GT(std::abs(mbcs[0].q[1][0] - mbcInit.q[1][0]), 1e-3);
+
+  projCstr.removeFromSolver(solver);
+
+  // two rigid contacts on the same body make J_c rank deficient, the
+  // minimum norm solution split the wrench between them
+  qp::ProjectedMotionConstr projCstr2(mbs, 0, {torqueMin, torqueMax}, {rigid, rigid});
+  projCstr2.addToSolver(solver);
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+  BOOST_REQUIRE(solver.solve(mbs, mbcs));
+  projCstr2.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+
+  fd.computeH(mbs[0], mbcs[0]);
+  fd.computeC(mbs[0], mbcs[0]);
+  jac.fullJacobian(mbs[0], jac.bodyJacobian(mbs[0], mbcs[0]), fullJac);
+  Vector6d w0 = projCstr2.rigidContactWrench(0).vector();
+  Vector6d w1 = projCstr2.rigidContactWrench(1).vector();
+  VectorXd res = fd.H() * solver.alphaDVec(0) + fd.C() - projCstr2.torque() - fullJac.transpose() * (w0 + w1);
+  BOOST_CHECK_SMALL(res.norm(), 1e-6);
+  BOOST_CHECK_GT(w0.norm(), 1e-3);
+  BOOST_CHECK_SMALL((w0 - w1).norm(), 1e-8);
+
+  solver.removeTask(&postureTask);
+  projCstr2.removeFromSolver(solver);
+}
+
 Eigen::Vector6d compute6dError(const sva::PTransformd & b1, const sva::PTransformd & b2)
 {
   Eigen::Vector6d error;
@@ -1462,6 +2279,56 @@ BOOST_AUTO_TEST_CASE(MomentumTask)
   BOOST_REQUIRE(solver.solve(mbs, mbcs));
 }
 
+BOOST_AUTO_TEST_CASE(CentroidalCacheTest)
+{
+  using namespace Eigen;
+  using namespace sva;
+  using namespace rbd;
+  using namespace tasks;
+
+  MultiBody mb;
+  MultiBodyConfig mbc;
+
+  std::tie(mb, mbc) = makeZXZArm(false);
+
+  Quaterniond qRoot(Vector4d::Random().normalized());
+  mbc.q[0] = {qRoot.w(), qRoot.x(), qRoot.y(), qRoot.z(), 0.2, -0.1, 0.4};
+  mbc.alpha[0] = {0.3, -0.2, 0.5, 0.1, 0.4, -0.6};
+  for(int i = 1; i < mb.nrJoints(); ++i)
+  {
+    mbc.q[i] = {0.3 * i};
+    mbc.alpha[i] = {0.5 - 0.4 * i};
+  }
+  forwardKinematics(mb, mbc);
+  forwardVelocity(mb, mbc);
+
+  std::vector<MultiBody> mbs = {mb};
+  std::vector<MultiBodyConfig> mbcs = {mbc};
+
+  qp::QPSolver solver;
+  solver.nrVars(mbs, {}, {});
+  solver.data().computeKinematics(mbs, mbcs);
+  const CentroidalData & cd = solver.data().centroidalMomentum(mbs, mbcs, 0);
+  const std::vector<MotionVecd> & normalAccB = solver.data().normalAccB(0);
+
+  // must match the RBDyn CoM and centroidal momentum computation
+  Vector3d com = computeCoM(mb, mbc);
+  Vector3d comVel = computeCoMVelocity(mb, mbc);
+  CoMJacobian comJac(mb);
+  BOOST_CHECK_SMALL((cd.com - com).norm(), 1e-10);
+  BOOST_CHECK_SMALL((cd.comVelocity - comVel).norm(), 1e-10);
+  BOOST_CHECK_SMALL((cd.comJac - comJac.jacobian(mb, mbc)).norm(), 1e-10);
+  BOOST_CHECK_SMALL((cd.comNormalAcc - comJac.normalAcceleration(mb, mbc, normalAccB)).norm(), 1e-10);
+
+  CentroidalMomentumMatrix cmm(mb);
+  cmm.computeMatrix(mb, mbc, com);
+  BOOST_CHECK_SMALL((cd.momentumMatrix - cmm.matrix()).norm(), 1e-10);
+  BOOST_CHECK_SMALL((cd.momentum.vector() - computeCentroidalMomentum(mb, mbc, com).vector()).norm(), 1e-10);
+  BOOST_CHECK_SMALL(
+      (cd.normalMomentumDot.vector() - cmm.normalMomentumDot(mb, mbc, com, comVel, normalAccB).vector()).norm(),
+      1e-10);
+}
+
 BOOST_AUTO_TEST_CASE(SurfaceOrientationTask)
 {
   using namespace Eigen;
@@ -1736,3 +2603,63 @@ BOOST_AUTO_TEST_CASE(QPTransformTaskTest)
   solver.removeTask(&postureTask);
   BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
 }
+
+BOOST_AUTO_TEST_CASE(TrajectoryBufferTest)
+{
+  using namespace Eigen;
+  using namespace rbd;
+  using namespace tasks;
+
+  // v(t) = t^2 is a cubic so the Hermite interpolation must be exact
+  const double period = 0.1;
+  MatrixXd vel(1, 4), accel(1, 4);
+  for(int i = 0; i < 4; ++i)
+  {
+    double t = i * period;
+    vel(0, i) = t * t;
+    accel(0, i) = 2. * t;
+  }
+  auto traj = std::make_shared<const qp::TrajectoryBuffer>(period, vel, accel);
+  BOOST_CHECK_SMALL(traj->duration() - 0.3, 1e-12);
+
+  VectorXd v(1), a(1);
+  traj->eval(0.25, v, a);
+  BOOST_CHECK_SMALL(v(0) - 0.25 * 0.25, 1e-12);
+  BOOST_CHECK_SMALL(a(0) - 0.5, 1e-12);
+  // last sample is held
+  traj->eval(1., v, a);
+  BOOST_CHECK_SMALL(v(0) - 0.09, 1e-12);
+  BOOST_CHECK_SMALL(a(0) - 0.6, 1e-12);
+
+  BOOST_CHECK_THROW(qp::TrajectoryBuffer(0., vel, accel), std::domain_error);
+  BOOST_CHECK_THROW(qp::TrajectoryBuffer(period, vel, MatrixXd(2, 4)), std::domain_error);
+
+  // the posture task trajectory must advance with the solver tick
+  MultiBody mb;
+  MultiBodyConfig mbcInit;
+  std::tie(mb, mbcInit) = makeZXZArm();
+  std::vector<MultiBody> mbs = {mb};
+  std::vector<MultiBodyConfig> mbcs = {mbcInit};
+  forwardKinematics(mb, mbcs[0]);
+  forwardVelocity(mb, mbcs[0]);
+
+  qp::QPSolver solver;
+  solver.nrVars(mbs, {}, {});
+  solver.updateConstrSize();
+
+  qp::PostureTask postureTask(mbs, 0, {{}, {0.}, {0.}, {0.}}, 1., 1.);
+  BOOST_CHECK_THROW(postureTask.trajectory(traj, 0.05), std::domain_error);
+  auto postureTraj = std::make_shared<const qp::TrajectoryBuffer>(period, vel.replicate(3, 1), accel.replicate(3, 1));
+  postureTask.trajectory(postureTraj, 0.05);
+  solver.addTask(&postureTask);
+  solver.updateTasksNrVars(mbs);
+
+  for(int i = 0; i < 3; ++i) { BOOST_REQUIRE(solver.solve(mbs, mbcs)); }
+  BOOST_CHECK_SMALL(postureTask.trajectoryPlayer().time() - 0.1, 1e-12);
+  BOOST_CHECK_SMALL((postureTask.refVel() - VectorXd::Constant(3, 0.01)).norm(), 1e-12);
+  BOOST_CHECK_SMALL((postureTask.refAccel() - VectorXd::Constant(3, 0.2)).norm(), 1e-12);
+
+  // a null trajectory stop the sampling
+  postureTask.trajectory(nullptr, 0.05);
+  BOOST_CHECK(!postureTask.trajectoryPlayer().loaded());
+}
@@ -535,3 +535,41 @@ BOOST_AUTO_TEST_CASE(VectorOrientationTaskTest)
 
   testTaskNumDiff(mb, mbc, vot, NormalAccUpdater<tasks::VectorOrientationTask>(mb), VectOriTester());
 }
+
+BOOST_AUTO_TEST_CASE(MultiGazeTaskTest)
+{
+  using namespace Eigen;
+  using namespace rbd;
+
+  MultiBody mb;
+  MultiBodyConfig mbc;
+
+  std::tie(mb, mbc) = makeZXZArm();
+  forwardKinematics(mb, mbc);
+  forwardVelocity(mb, mbc);
+
+  sva::PTransformd X_b_gaze(Quaterniond(Vector4d::Random().normalized()), Vector3d::Random());
+  Matrix3Xd points3d(3, 3);
+  points3d << 0.1, -0.2, 0.3, 0.2, 0.1, -0.1, 1., 2., 1.5;
+  Matrix2Xd points2d_ref = Matrix2Xd::Random(2, 3);
+
+  tasks::MultiGazeTask mgt(mb, "b3", points3d, X_b_gaze, points2d_ref);
+  BOOST_CHECK_EQUAL(mgt.nrPoints(), 3);
+
+  std::vector<sva::MotionVecd> normalAccB(static_cast<size_t>(mb.nrBodies()));
+  computeNormalAccB(mb, mbc, normalAccB);
+  mgt.update(mb, mbc, normalAccB);
+
+  // each point must match a single point GazeTask
+  for(int i = 0; i < 3; ++i)
+  {
+    tasks::GazeTask gt(mb, "b3", Vector3d(points3d.col(i)), X_b_gaze, points2d_ref.col(i));
+    gt.update(mb, mbc, normalAccB);
+    BOOST_CHECK_SMALL((mgt.eval().segment<2>(2 * i) - gt.eval()).norm(), 1e-10);
+    BOOST_CHECK_SMALL((mgt.speed().segment<2>(2 * i) - gt.speed()).norm(), 1e-10);
+    BOOST_CHECK_SMALL((mgt.normalAcc().segment<2>(2 * i) - gt.normalAcc()).norm(), 1e-10);
+    BOOST_CHECK_SMALL((mgt.jac().middleRows<2>(2 * i) - gt.jac()).norm(), 1e-10);
+  }
+
+  BOOST_CHECK_THROW(mgt.error(Matrix2Xd::Zero(2, 2), VectorXd::Ones(2), Matrix2Xd::Zero(2, 2)), std::domain_error);
+}